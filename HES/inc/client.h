@@ -4,17 +4,24 @@
 // #include <filesystem>
 #include <cstdint>
 #include <iostream>
+#include <list>
 #include <memory>
+#include <new>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <system_error>
 #include <unistd.h>
 
 #include "database.h"
+#include "gateway_io.h"
 #include "mqtt.h"
+#include "odm_scheduler.h"
+#include "ping_series.h"
+#include "profile_cache.h"
 #include "pull.h"
 #include "push.h"
 #include "server.h"
+#include "slab_pool.h"
 #include "utility.h"
 
 #include "fuota.h"
@@ -34,6 +41,7 @@
 #define PING_METER             0x0E
 #define POLL_TIMEOUT           0xFF
 #define PMESH_ERROR            0x0F
+#define PULL_SKIPPED           0x03 /* profile already present, nothing pulled */
 #define SECONDS_5H30M          0x4D58 /* 5 hours 30 minutes in seconds */
 
 #define MAX_CLIENT_RX_BUFFER 4096
@@ -422,21 +430,6 @@ struct DBparameters
     uint8_t push_alaram; // Pull = 0 && Push = 1
 };
 
-struct Pingnode_details
-{
-    std::string gateway_id;
-    std::string meter_serial_no;
-    std::string target_mac_address;
-    std::vector<uint8_t> gateway_type;
-    std::vector<uint8_t> download_data_type;
-    std::string req_command;
-    size_t ping_count; // single counter for pings
-    std::vector<size_t> request_id;
-    std::chrono::time_point<std::chrono::steady_clock> Time_tx;
-    std::chrono::time_point<std::chrono::steady_clock> Time_rx;
-    uint64_t time_duration; // duration in milliseconds
-};
-
 // Main ODMProfiles class
 class ODMProfiles
 {
@@ -471,8 +464,6 @@ class ODMProfiles
     ODM_SingleObisData singleObisData;
     // structure for DB parameters
     DBparameters DB_parameter;
-    // structure for ping node details
-    Pingnode_details pingnode_detail;
 };
 
 struct DLMSValue
@@ -875,6 +866,48 @@ struct HesCycleState
     uint8_t done_mask = 0;
 };
 
+// What an ODM response is parsed into: the ODMProfiles and the nameplate Client keeps beside them
+struct OdmResponseState
+{
+    ODMProfiles profiles;
+    ODM_NamePlateProfile name_plate;
+};
+
+#define ODM_PIPELINE_DEFAULT_DEPTH 4 // ODM requests kept on the air per gateway, to distinct meters
+#define ODM_PIPELINE_MAX_DEPTH 16
+
+/*
+ * One ODM request or ping series on the air while others to other meters
+ * under the same gateway are too. What a request needs across frames lives
+ * here and is swapped into the Client only while a frame from this meter is
+ * being handled.
+ */
+struct OdmExchange
+{
+    std::unique_ptr<QueuedCommand> cmd;
+    FrameBuffer frame;        // resent as is, rewritten in place for the next page
+    FrameBuffer pmesh_header; // DLMS enable goes out behind it on reconnect
+    uint8_t target[4] = {0};           // source address the meter answers from
+    uint8_t tx_page_index = 0;
+    uint8_t page_index = 1;
+    uint8_t retry = 1;
+    uint8_t poll_retry = 1;
+    uint8_t dlms_checksum_error_retry = 1;
+    bool once = true;
+    bool gateway_heard = false; // any frame arrived while in flight, the gateway itself is alive
+    bool reconnecting = false;  // DLMS enable sent, waiting for DLMS_SUCCESS
+    uint32_t pp_write_payload_tail = 0;
+    OdmResponseState state;
+    std::chrono::steady_clock::time_point expires_at;
+
+    // Ping series only
+    bool ping = false;
+    uint8_t pings_left = 0;
+    uint8_t ping_failure = 0; // status written when no ping was answered
+    std::chrono::seconds ping_interval{0};
+    RttSeries rtt;
+};
+
 class Client : public MQTTClient, public virtual BaseLogger, public ODMProfiles, public virtual PushData, public virtual PullData
 {
  private:
@@ -884,15 +917,27 @@ class Client : public MQTTClient, public virtual BaseLogger, public ODMProfiles,
     bool gatewayid_logging_enabled = true;
 
     int current_ip_cycle = -1;
+    int nms_lease_fd = -1; // eventfd written by NmsLeaseManager when NMS releases this gateway
     //==============================Added by LHK===================//
-    std::unique_ptr<MySqlDatabase> db;
-    std::unique_ptr<Fuota> fuota;
+    std::unique_ptr<MySqlDatabase> db; // FUOTA's own connection, created with fuota
+    std::unique_ptr<Fuota> fuota;      // created when a FUOTA command or resume first needs it
+
+    MySqlDatabase &fuota_db(void);
+    Fuota &fuota_session(void);
 
  public:
     Client();
     ~Client();
 
+    // Sessions come from a slab pool instead of one large heap allocation each
+    static void *operator new(size_t size);
+    static void *operator new(size_t size, std::align_val_t align);
+    static void operator delete(void *ptr, size_t size);
+    static void operator delete(void *ptr, size_t size, std::align_val_t align);
+    static SlabPool &session_pool(void);
+
     pollfd pfd[3];
+    GatewayIo gateway_io; // every read, write and wait on client_socket goes through it
     int polltimeout = 0;
     char gateway_id[17] = {0};
     unsigned char rx_buffer[BUFFER_SIZE] = {0};
@@ -903,8 +948,11 @@ class Client : public MQTTClient, public virtual BaseLogger, public ODMProfiles,
     bool duplicate_gateway = false;
     uint8_t tx_page_index = 0;          // to track page index of received packet
     uint32_t pp_write_payload_tail = 0; // last 4 bytes of programmable-parameter write frame
-
-    ODMProfiles odmProfiles; // access all ODM profiles
+    OdmScheduler odm_schedule;                // ODM commands drained from the ring, in run order
+    QueuedCommand *odm_in_flight = nullptr;   // ODM command while its RF exchange runs
+    std::vector<QueuedCommand *> odm_waiting; // identical reads still pending
+    std::list<OdmExchange> odm_exchanges;     // ODM requests on the air, one per meter
+    std::unordered_map<unsigned int, nlohmann::json> odm_result_values; // decoded values sent with the completion event
 
     uint8_t src_addr_check_buffer[4]; // Buffer to hold source address for validation(added by Amith KN)
     bool need_to_validate_src_addr;
@@ -934,7 +982,7 @@ class Client : public MQTTClient, public virtual BaseLogger, public ODMProfiles,
         uint8_t source_address[4];
         uint8_t router_index;
         uint8_t hop_count;
-        std::vector<uint8_t> dest_address; // hop_count * 4 bytes
+        uint8_t dest_address[COMMAND_PATH_MAX / 2]; // hop_count * 4 bytes, last 4 of every 8 path bytes
     };
 
     // Added by Supritha K P
@@ -970,12 +1018,19 @@ class Client : public MQTTClient, public virtual BaseLogger, public ODMProfiles,
     int set_recv_timeout_for_client(uint32_t time_in_sec);
     void set_poll_timeout(int timeout_in_sec);
     int initCommunication(uint8_t *buffer, ssize_t length);
+    void apply_pgwid(const char *str, int val1, int val2, int val3);
+    void start_session(bool resumed);
+    nlohmann::json session_snapshot(void) const;
+    bool resume_session(const nlohmann::json &snapshot);
+    bool ready_for_handoff(void);
+    int release_client_socket(void);
     void create_mqtt_client(void);
     void create_gateway_log_file(void);
     ssize_t receive_data(uint8_t *buff, size_t buffSize);
     int client_received_data(uint8_t *buffer, ssize_t length);
     void poll_timeout_handler(void);
     void process_ondemand_request(void);
+    int wait_for_nms_release(int timeout_ms);
     int receive_data_and_validate_response(void);
     int validate_received_data(uint8_t *buffer, ssize_t length);
     int is_valid_packet(uint8_t *buff, int length);
@@ -984,17 +1039,15 @@ class Client : public MQTTClient, public virtual BaseLogger, public ODMProfiles,
     int write_to_client(uint8_t *buf, size_t length);                                                                   // Write data to client socket(added by Amith KN)
     static void client_get_time(std::string &time_str, int format_type);                                                // Get current time as string(added by Amith KN)
                                                                                                                         // Function to frame PMESH packet
-    std::vector<uint8_t> build_odm_pmesh_packet(const PMeshHeader &header, const uint8_t *command, size_t command_len); //(added by Amith KN)
-    std::vector<uint8_t> build_pmesh_frame(const std::vector<std::string> &parts);                                      //(added by Amith KN)
+    FrameBuffer build_odm_pmesh_packet(const PMeshHeader &header, const uint8_t *command, size_t command_len); //(added by Amith KN)
+    FrameBuffer build_pmesh_frame(const QueuedCommand &cmd);                                                   //(added by Amith KN)
     bool has_pending_cancel();                                                                                          //(added by Amith KN)
     void get_destination_address(uint8_t *buf);                                                                         //(added by Amith KN)
     void print_data_in_hex(const uint8_t *data, uint32_t length);                                                       //(added by Amith KN)
     int validate_source_address(uint8_t *data);                                                                         //(added by Amith KN)
-    void Process_ODM_request(uint8_t *buf, size_t length, int request_id, uint8_t command);
     int log_dlms_data_type(uint8_t data_type, uint8_t *offset, uint8_t *data_offset, uint8_t *field_length, const uint8_t *data); //(added by Amith KN)
     bool handle_success(int request_id, uint8_t command, uint8_t *buf);                                                           //(added by Amith KN)
     bool resend_packet(uint8_t *buf, size_t length, int request_id);                                                              //(added by Amith KN)
-    bool handle_connection_failed(int request_id);                                                                                //(added by Amith KN)
     bool handle_next_page(uint8_t *buf, size_t &length, int request_id, uint8_t command, uint8_t &page_index);                    //(added by Amith KN)
     void parse_nameplate_profile(const uint8_t *data, size_t length);                                                             //(added by Amith KN)
     void parse_instantaneous_profile(const uint8_t *data, size_t length);                                                         //(added by Amith KN)
@@ -1013,9 +1066,26 @@ class Client : public MQTTClient, public virtual BaseLogger, public ODMProfiles,
     bool update_odm_db(uint8_t download_data_type);                                                                               //(added by Amith KN)
     void recalculate_dlms_checksum(uint8_t *buf, size_t total_length);                                                            //(added by Amith KN)
     void clear_profile_for_type(uint8_t download_data_type);
+    int insert_odm_ip_record(const InstantaneousRecord &record, uint8_t err_code);
+    bool answer_ip_from_cache(const QueuedCommand &cmd);
+    void drain_odm_ring(void);
+    bool prepare_odm_command(QueuedCommand &cmd);
+    bool odm_target_busy(const QueuedCommand &cmd) const;
+    void start_odm_exchanges(size_t depth, size_t ping_depth);
+    void start_odm_exchange(std::unique_ptr<QueuedCommand> cmd);
+    void start_ping_series(std::unique_ptr<QueuedCommand> cmd);
+    bool send_ping(OdmExchange &ex);
+    bool advance_ping_series(OdmExchange &ex, int ret);
+    void update_ping_summary(const OdmExchange &ex);
+    void service_odm_exchanges(void);
+    bool advance_odm_exchange(OdmExchange &ex, int ret);
+    bool reconnect_odm_exchange(OdmExchange &ex);
+    void swap_odm_exchange(OdmExchange &ex, bool entering);
+    void finish_odm_exchange(std::list<OdmExchange>::iterator it);
+    size_t collect_waiting_reads(uint8_t download_data_type);
+    void fan_out_odm_result(uint8_t download_data_type, const OdmResponseState &response);
+    void report_status_batches(const std::vector<StatusBatch> &batches);
     void Insert_receive_data_offset();                                                         //(added by Amith KN)
-    void Update_Insert_Ping_request(uint8_t download_type, uint8_t status);                    //(added by Amith KN)
-    void ping_node_details(const std::vector<std::string> &parts, DBparameters &DB_parameter); //(added by Amith KN)
     void validate_NP_for_db();                                                                 //(added by Amith KN)
     void validate_IP_for_db();                                                                 //(added by Amith KN)
     void validate_DLP_for_db();                                                                //(added by Amith KN)
@@ -1043,6 +1113,9 @@ class Client : public MQTTClient, public virtual BaseLogger, public ODMProfiles,
     bool process_AllEvents_case(uint8_t download_data_type);
     //(added by Supritha K P)
     int init_connection(int val1, int val2, int val3);
+    void record_gateway_connection(int val1, int val2, int val3);
+    void admit_and_init_connection(void);
+    bool init_reusable(void) const;
     uint8_t *frame_NP_cmd_to_pull_data(uint8_t *path_record, uint8_t hop_count);
     int transmit_command_and_validate_response(uint8_t *buf, size_t length, uint32_t maxRetries);
     int pull_NP_at_init_con();
@@ -1062,26 +1135,35 @@ class Client : public MQTTClient, public virtual BaseLogger, public ODMProfiles,
     /* PULL */ // Added by Puneeth
     NodeInfo *currentNode = nullptr;
     HesCycleState hes_state{};
+    NodeTable node_table{};
 
     void mark_hes_cycle_done(void);
     int get_cycle_id_from_minute(int minute);
     int client_hes_cycle_schedule(void);
-    int write_to_client_vector(std::vector<uint8_t> &buff);
-    int transmit_command_and_validate_response(std::vector<uint8_t> &buff, uint8_t maxRetries);
+    int write_to_client_vector(FrameBuffer &buff);
+    int transmit_command_and_validate_response(FrameBuffer &buff, uint8_t maxRetries);
     int hes_start_cycle_activiy(const char *gateway_id);
     void update_gateway_details(const char *gateway_id);
-    void build_node_list_from_db(std::map<std::array<uint8_t, 8>, NodeInfo> &nodes_info, const char *gateway_id);
-    void add_gateway_node_to_map_list(std::map<std::array<uint8_t, 8>, NodeInfo> &nodes_info, const char *gateway_id);
-    void get_alternate_path_for_all_nodes(std::map<std::array<uint8_t, 8>, NodeInfo> &nodes_info, const char *gateway_id);
-    void get_missing_info_for_all_nodes(std::map<std::array<uint8_t, 8>, NodeInfo> &nodes_info, const char *gateway_id);
-    int pull_missing_info_for_all_nodes(std::map<std::array<uint8_t, 8>, NodeInfo> &nodes_info);
-    int try_paths_for_profile_pull(NodeInfo &node, std::vector<uint8_t> (Client::*frame_fn)(uint8_t), uint8_t &page_index, const char *profile_name);
-    int pull_profile_pages_on_path(const PathInfo &path, std::vector<uint8_t> (Client::*frame_fn)(uint8_t), uint8_t &page_index, NodeInfo &node);
+    void build_node_list_from_db(NodeMap &nodes_info, const char *gateway_id);
+    int refresh_node_table(const char *gateway_id);
+    void add_gateway_node_to_map_list(NodeMap &nodes_info, const char *gateway_id);
+    void get_alternate_path_for_all_nodes(NodeMap &nodes_info, const char *gateway_id);
+    void get_missing_info_for_all_nodes(NodeMap &nodes_info, const char *gateway_id);
+    int pull_missing_info_for_all_nodes(NodeMap &nodes_info);
+    int pull_missing_info_profile_major(NodeMap &nodes_info);
+    int pull_missing_info_node_major(NodeMap &nodes_info);
+    int pull_missing_info_for_a_node(NodeInfo &node);
+    int run_pull_stage(NodeInfo &node, PullStage stage);
+    void begin_pull_cycle_report(NodeMap &nodes_info);
+    void end_pull_cycle_report(NodeMap &nodes_info);
+    int try_paths_for_profile_pull(NodeInfo &node, FrameBuffer (Client::*frame_fn)(uint8_t), uint8_t &page_index, const char *profile_name);
+    int pull_profile_pages_on_path(const PathInfo &path, FrameBuffer (Client::*frame_fn)(uint8_t), uint8_t &page_index, NodeInfo &node);
     void load_scalar_values_from_db(std::array<uint8_t, 8> meter_sl_number);
-    void load_scalar_for_all_nodes(std::map<std::array<uint8_t, 8>, NodeInfo> &nodes_info);
+    void load_scalar_for_all_nodes(NodeMap &nodes_info);
+    void load_scalar_for_a_node(NodeInfo &node);
 
-    std::vector<uint8_t> frame_pmesh_command_packet(uint8_t packet_type, PathInfo const &path_info, const std::vector<uint8_t> &cmd);
-    int transmit_command_on_path_pmesh(uint8_t packet_type, const std::vector<uint8_t> &cmd, PathInfo const &path, int timeout_retries);
+    FrameBuffer frame_pmesh_command_packet(uint8_t packet_type, PathInfo const &path_info, ByteSpan cmd);
+    int transmit_command_on_path_pmesh(uint8_t packet_type, ByteSpan cmd, PathInfo const &path, int timeout_retries);
     int flash_save(NodeInfo &node, PathInfo const &path);
     int soft_reset(NodeInfo &node, PathInfo const &path);
     int perform_flash_and_reset(NodeInfo &node, PathInfo const &path);
@@ -1090,39 +1172,45 @@ class Client : public MQTTClient, public virtual BaseLogger, public ODMProfiles,
     int attempt_dlms_reconnect_all_paths(NodeInfo &node, const PathInfo &failed_path);
 
     // Unsilence / Fuota status and disable
-    int unsilence_all_nodes(std::map<std::array<uint8_t, 8>, NodeInfo> &nodes_info);
+    int unsilence_all_nodes(NodeMap &nodes_info);
+    int unsilence_node(NodeInfo &node);
     int check_fuota_status(NodeInfo &node);
     int fuota_disable_for_a_node(NodeInfo &node);
 
     // Nameplate pull
-    std::vector<uint8_t> frame_dlms_nameplate_command_packet(uint8_t page_index);
-    int pull_missing_nameplate_for_all_nodes(std::map<std::array<uint8_t, 8>, NodeInfo> &nodes_info);
+    FrameBuffer frame_dlms_nameplate_command_packet(uint8_t page_index);
+    int pull_missing_nameplate_for_all_nodes(NodeMap &nodes_info);
+    int pull_missing_nameplate_for_a_node(NodeInfo &node);
     int pull_nameplate_for_a_node(NodeInfo &node);
 
     // IFV
     int pull_internal_firmware_version_for_a_node(NodeInfo &node);
-    int pull_missing_internal_firmware_version_for_all_nodes(std::map<std::array<uint8_t, 8>, NodeInfo> &nodes_info);
+    int pull_missing_internal_firmware_version_for_all_nodes(NodeMap &nodes_info);
+    int pull_missing_internal_firmware_version_for_a_node(NodeInfo &node);
 
     // IP
-    std::vector<uint8_t> frame_dlms_ip_command_packet(uint8_t page_index);
+    FrameBuffer frame_dlms_ip_command_packet(uint8_t page_index);
     int pull_instantaneous_profile_for_cycle(NodeInfo &node, int cycle);
     int pull_missing_instantaneous_for_a_node(NodeInfo &node);
-    int pull_missing_ip_profile_for_all_nodes(std::map<std::array<uint8_t, 8>, NodeInfo> &nodes_info);
+    int pull_missing_ip_profile_for_all_nodes(NodeMap &nodes_info);
 
     // DLP pull
-    std::vector<uint8_t> frame_dlms_dlp_command_packet(uint8_t page_index);
+    FrameBuffer frame_dlms_dlp_command_packet(uint8_t page_index);
     int pull_daily_load_profile_for_a_node(NodeInfo &node);
-    int pull_missing_daily_load_for_all_nodes(std::map<std::array<uint8_t, 8>, NodeInfo> &nodes_info);
+    int pull_missing_daily_load_for_all_nodes(NodeMap &nodes_info);
+    int pull_missing_daily_load_for_a_node(NodeInfo &node);
 
     // BLP pull
-    std::vector<uint8_t> frame_dlms_blp_command_packet(uint8_t page_index);
+    FrameBuffer frame_dlms_blp_command_packet(uint8_t page_index);
     int pull_block_load_profile_for_a_node(NodeInfo &node);
-    int pull_missing_block_load_for_all_nodes(std::map<std::array<uint8_t, 8>, NodeInfo> &nodes_info);
+    int pull_missing_block_load_for_all_nodes(NodeMap &nodes_info);
+    int pull_missing_block_load_for_a_node(NodeInfo &node);
 
     // BHP
-    std::vector<uint8_t> frame_dlms_bhp_command_packet(uint8_t page_index);
+    FrameBuffer frame_dlms_bhp_command_packet(uint8_t page_index);
     int pull_billing_history_profile_for_a_node(NodeInfo &node);
-    int pull_missing_billing_history_for_all_nodes(std::map<std::array<uint8_t, 8>, NodeInfo> &nodes_info);
+    int pull_missing_billing_history_for_all_nodes(NodeMap &nodes_info);
+    int pull_missing_billing_history_for_a_node(NodeInfo &node);
 };
 
 #endif // __CLIENT_H__
\ No newline at end of file
@@ -0,0 +1,225 @@
+#ifndef __COMMAND_QUEUE_H__
+#define __COMMAND_QUEUE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#define COMMAND_TEXT_MAX    800 // request:gateway:hops:path(200):type:command(512):...
+#define COMMAND_FIELDS_MAX  8
+#define COMMAND_PATH_MAX    100 // decoded path bytes, up to 11 hops
+#define COMMAND_PAYLOAD_MAX 256 // decoded command bytes
+
+// Power of two at or above MQTTClient::MAX_QUEUE_SIZE, one MQTT message may carry a whole group
+#define ODM_QUEUE_CAPACITY    512
+#define FAILED_QUEUE_CAPACITY 512
+#define FUOTA_QUEUE_CAPACITY  512
+
+/*
+ * MQTT command tokenized in a single pass at receive time. The ':'
+ * separators of text are replaced by '\0' so every field can be used in
+ * place as a C string, the numeric fields are decoded up front and the hex
+ * fields (gateway, path, command) are decoded once into fixed buffers that
+ * validation and PMESH framing read directly.
+ */
+struct QueuedCommand
+{
+    int request_id = -1;
+    int hop_count = 0;
+    int download_data_type = -1;
+    uint16_t length = 0;
+    uint16_t part_count = 0; // every ':' field, may exceed COMMAND_FIELDS_MAX
+    uint8_t field_count = 0; // fields addressable through field()
+    uint16_t field_offset[COMMAND_FIELDS_MAX] = {0};
+    uint16_t field_length[COMMAND_FIELDS_MAX] = {0};
+    std::chrono::steady_clock::time_point enqueued_at{};
+
+    bool gateway_ok = false; // each flag: field present, even length, hex only and fits
+    bool path_ok = false;
+    bool payload_ok = false;
+    uint8_t gateway[8] = {0};
+    uint8_t path_len = 0;
+    uint8_t path[COMMAND_PATH_MAX] = {0};
+    uint16_t payload_len = 0;
+    uint8_t payload[COMMAND_PAYLOAD_MAX] = {0};
+
+    char text[COMMAND_TEXT_MAX] = {0};
+
+    bool answered = false; // status already written by a coalesced read, skip on dequeue
+
+    // Returns false when the command did not fit and was truncated
+    bool parse(std::string_view cmd);
+
+    const char *field(int index) const { return (index < this->field_count) ? this->text + this->field_offset[index] : ""; }
+    size_t field_size(int index) const { return (index < this->field_count) ? this->field_length[index] : 0; }
+    std::string_view view(int index) const { return std::string_view(this->field(index), this->field_size(index)); }
+    int number(int index, int fallback) const;
+
+    std::string raw(void) const;
+    std::vector<uint8_t> bytes(void) const;
+
+    // Same download type on the same route with the same command bytes
+    bool same_read_as(const QueuedCommand &other) const;
+
+    // Decodes an ASCII hex field, -1 on odd length, non-hex digit or overflow
+    static int decode_hex(std::string_view hex, uint8_t *out, size_t out_size);
+};
+
+// Only what the Failed queue consumer reports back to the DB
+struct FailedCommand
+{
+    int request_id = -1;
+    int download_data_type = -1;
+};
+
+/*
+ * Bounded lock-free ring for many producers (the mosquitto callback thread)
+ * and a single consumer (the gateway thread). Each slot carries a sequence
+ * number telling whose turn it is, so neither side ever blocks the other.
+ * The consumer may look at front() in place and pop() it once done.
+ *
+ * Slots are allocated ChunkSize at a time by the first push that reaches
+ * them and kept until the ring goes away, so a gateway that never gets a
+ * command pays for the chunk table only.
+ */
+template <typename T, size_t Capacity, size_t ChunkSize = 16>
+class MpscRing
+{
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "MpscRing capacity must be a power of two");
+    static_assert(ChunkSize >= 1 && ChunkSize <= Capacity && (ChunkSize & (ChunkSize - 1)) == 0, "MpscRing chunk size must be a power of two up to the capacity");
+
+ public:
+    MpscRing()
+    {
+        for (auto &chunk : this->chunks)
+            chunk.store(nullptr, std::memory_order_relaxed);
+    }
+
+    ~MpscRing()
+    {
+        for (auto &chunk : this->chunks)
+            delete[] chunk.load(std::memory_order_relaxed);
+    }
+
+    MpscRing(const MpscRing &) = delete;
+    MpscRing &operator=(const MpscRing &) = delete;
+
+    // Any thread. Returns false when the ring is full.
+    bool push(const T &item)
+    {
+        size_t pos = this->enqueue_pos.load(std::memory_order_relaxed);
+        Slot *slot;
+
+        while (true)
+        {
+            slot = this->slot_at(pos, true);
+            size_t sequence = slot->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+
+            if (diff == 0)
+            {
+                if (this->enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (diff < 0)
+            {
+                return false;
+            }
+            else
+            {
+                pos = this->enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+
+        slot->item = item;
+        slot->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer thread only. The slot stays owned by the consumer until pop().
+    T *front(void)
+    {
+        size_t pos = this->dequeue_pos.load(std::memory_order_relaxed);
+        Slot *slot = this->slot_at(pos, false);
+
+        if (slot == nullptr || slot->sequence.load(std::memory_order_acquire) != pos + 1)
+            return nullptr;
+
+        return &slot->item;
+    }
+
+    // Consumer thread only, after front() returned an item
+    void pop(void)
+    {
+        size_t pos = this->dequeue_pos.load(std::memory_order_relaxed);
+        this->slot_at(pos, false)->sequence.store(pos + Capacity, std::memory_order_release);
+        this->dequeue_pos.store(pos + 1, std::memory_order_relaxed);
+    }
+
+    bool empty(void) { return this->front() == nullptr; }
+
+    // Approximate when called concurrently with push/pop
+    size_t size(void) const
+    {
+        size_t head = this->dequeue_pos.load(std::memory_order_relaxed);
+        size_t tail = this->enqueue_pos.load(std::memory_order_relaxed);
+        return (tail > head) ? (tail - head) : 0;
+    }
+
+    static constexpr size_t capacity(void) { return Capacity; }
+
+    // Bytes of slots allocated so far
+    size_t allocated(void) const
+    {
+        size_t chunks_in_use = 0;
+        for (const auto &chunk : this->chunks)
+            chunks_in_use += (chunk.load(std::memory_order_relaxed) != nullptr);
+        return chunks_in_use * ChunkSize * sizeof(Slot);
+    }
+
+ private:
+    struct Slot
+    {
+        std::atomic<size_t> sequence{0};
+        T item;
+    };
+
+    // Slot of pos, its chunk allocated first when allocate is set (producers)
+    Slot *slot_at(size_t pos, bool allocate)
+    {
+        size_t index = pos & (Capacity - 1);
+        std::atomic<Slot *> &chunk = this->chunks[index / ChunkSize];
+        Slot *slots = chunk.load(std::memory_order_acquire);
+
+        if (slots == nullptr)
+        {
+            if (!allocate)
+                return nullptr;
+
+            // Untouched chunk: still on the first lap, each slot waits for its own index
+            Slot *fresh = new Slot[ChunkSize];
+            size_t base = index & ~(ChunkSize - 1);
+            for (size_t i = 0; i < ChunkSize; i++)
+                fresh[i].sequence.store(base + i, std::memory_order_relaxed);
+
+            if (chunk.compare_exchange_strong(slots, fresh, std::memory_order_acq_rel, std::memory_order_acquire))
+                slots = fresh;
+            else
+                delete[] fresh; // Another producer won, slots holds its chunk
+        }
+
+        return &slots[index & (ChunkSize - 1)];
+    }
+
+    std::atomic<Slot *> chunks[Capacity / ChunkSize];
+    alignas(64) std::atomic<size_t> enqueue_pos{0};
+    alignas(64) std::atomic<size_t> dequeue_pos{0};
+};
+
+#endif // __COMMAND_QUEUE_H__
@@ -0,0 +1,122 @@
+#ifndef __COVERAGE_INDEX_H__
+#define __COVERAGE_INDEX_H__
+
+#include <stdint.h>
+
+#include <array>
+#include <bitset>
+#include <ctime>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#define COVERAGE_CYCLES_PER_DAY 96
+#define COVERAGE_IP_WINDOW      (2 * COVERAGE_CYCLES_PER_DAY) // today + previous day
+#define COVERAGE_BLP_WINDOW     (2 * COVERAGE_CYCLES_PER_DAY)
+#define COVERAGE_DLP_WINDOW     64 // days
+#define COVERAGE_BHP_WINDOW     24 // months
+
+/*
+ * Fixed-size bitmap over a sliding range of absolute slot numbers
+ * (15-minute cycles, days or months). Marking a slot newer than the
+ * head advances the window and clears the slots that rolled out.
+ */
+template <size_t N>
+class RollingBitmap
+{
+ public:
+    void mark(int64_t slot)
+    {
+        if (slot < 0)
+            return;
+
+        if (this->head < 0 || slot > this->head)
+        {
+            if (this->head < 0 || slot - this->head >= static_cast<int64_t>(N))
+            {
+                this->bits.reset();
+            }
+            else
+            {
+                for (int64_t s = this->head + 1; s <= slot; s++)
+                    this->bits.reset(static_cast<size_t>(s % N));
+            }
+            this->head = slot;
+        }
+        else if (slot <= this->head - static_cast<int64_t>(N))
+        {
+            return; // older than the window
+        }
+
+        this->bits.set(static_cast<size_t>(slot % N));
+    }
+
+    bool test(int64_t slot) const
+    {
+        if (this->head < 0 || slot < 0 || slot > this->head || slot <= this->head - static_cast<int64_t>(N))
+            return false;
+
+        return this->bits.test(static_cast<size_t>(slot % N));
+    }
+
+ private:
+    int64_t head = -1;
+    std::bitset<N> bits;
+};
+
+struct NodeCoverage
+{
+    RollingBitmap<COVERAGE_IP_WINDOW> ip_cycles;   // absolute 15-minute cycle of each IP insert
+    RollingBitmap<COVERAGE_BLP_WINDOW> blp_slots;  // 15-minute slot in which a block load was stored
+    RollingBitmap<COVERAGE_DLP_WINDOW> dlp_days;   // meter RTC day of each daily load entry
+    RollingBitmap<COVERAGE_BHP_WINDOW> bhp_months; // billing month of each billing history entry
+};
+
+/*
+ * Process-wide record of which profiles the HES has stored per meter.
+ * Updated from the insert_* success paths and seeded from the database
+ * once per gateway, so the pull cycle can work out what is missing for a
+ * node without querying back rows it has just written.
+ */
+class CoverageIndex
+{
+ public:
+    static CoverageIndex &instance();
+
+    static int64_t day_number(std::time_t t);
+    static int64_t cycle_number(std::time_t t);
+    static int64_t month_number(int year, int month);
+
+    bool is_gateway_loaded(const char *gateway_id);
+    void set_gateway_loaded(const char *gateway_id);
+
+    void mark_ip_cycle(const char *gateway_id, const std::array<uint8_t, 8> &mac, int cycle_id, std::time_t at);
+    void mark_blp(const char *gateway_id, const std::array<uint8_t, 8> &mac, std::time_t at);
+    void mark_dlp_day(const char *gateway_id, const std::array<uint8_t, 8> &mac, std::time_t rtc);
+    void mark_bhp_month(const char *gateway_id, const std::array<uint8_t, 8> &mac, int year, int month);
+
+    // Drops the nodes of gateway_id that are no longer in its node list
+    void retain_nodes(const char *gateway_id, const std::set<std::array<uint8_t, 8>> &macs);
+
+    // Same answers as the corresponding MySqlDatabase checks, without SQL
+    std::vector<int> get_last_hour_missing_ip_cycles(const char *gateway_id, const std::array<uint8_t, 8> &mac);
+    bool is_blp_available_last_hour(const char *gateway_id, const std::array<uint8_t, 8> &mac);
+    bool is_dlp_available_previous_day(const char *gateway_id, const std::array<uint8_t, 8> &mac);
+    bool is_bhp_available_previous_month(const char *gateway_id, const std::array<uint8_t, 8> &mac);
+
+ private:
+    CoverageIndex() = default;
+    CoverageIndex(const CoverageIndex &) = delete;
+    CoverageIndex &operator=(const CoverageIndex &) = delete;
+
+    NodeCoverage *find_node(const char *gateway_id, const std::array<uint8_t, 8> &mac);
+
+    std::mutex coverage_mutex;
+    std::unordered_map<std::string, std::map<std::array<uint8_t, 8>, NodeCoverage>> gateways;
+    std::set<std::string> loaded_gateways;
+};
+
+#endif // __COVERAGE_INDEX_H__
@@ -0,0 +1,52 @@
+#ifndef __EVENT_CODE_DICTIONARY_H__
+#define __EVENT_CODE_DICTIONARY_H__
+
+#include <stdint.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#define EVENT_CODE_TABLE_SIZE          65536
+#define EVENT_CODE_DEFAULT_REFRESH_SEC 3600
+#define EVENT_CODE_RETRY_SEC           60 // after a failed load, no reload before this
+
+/*
+ * dlms_event_codes loaded once into a dense table indexed by the 16-bit
+ * event code and shared by every gateway thread. A refresh builds a new
+ * table and swaps it in, readers keep the snapshot they already hold.
+ * Edits to dlms_event_codes are picked up by the periodic refresh.
+ */
+class EventCodeDictionary
+{
+ public:
+    using Table = std::vector<std::string>;
+
+    static EventCodeDictionary &instance();
+
+    bool is_loaded() const;
+    bool needs_refresh() const;
+
+    // Only one caller gets true until finish_refresh() is called
+    bool begin_refresh();
+    void finish_refresh(std::shared_ptr<const Table> table); // nullptr: load failed, retried after EVENT_CODE_RETRY_SEC
+
+    std::string lookup(uint16_t event_code) const;
+
+    void set_refresh_interval(int seconds);
+
+ private:
+    EventCodeDictionary() = default;
+    EventCodeDictionary(const EventCodeDictionary &) = delete;
+    EventCodeDictionary &operator=(const EventCodeDictionary &) = delete;
+
+    std::shared_ptr<const Table> table;
+    std::atomic<bool> refreshing{false};
+    std::atomic<int64_t> loaded_at_sec{0};
+    std::atomic<int64_t> failed_at_sec{0}; // 0 while the last load succeeded
+    std::atomic<int> refresh_interval_sec{EVENT_CODE_DEFAULT_REFRESH_SEC};
+};
+
+#endif // __EVENT_CODE_DICTIONARY_H__
@@ -0,0 +1,93 @@
+#ifndef __FRAME_BUFFER_H__
+#define __FRAME_BUFFER_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#define FRAME_BUFFER_SIZE    512 // largest PMESH frame: 13 byte header, 100 path bytes, 256 payload bytes
+#define FRAME_POOL_MAX_SPARE 32  // free buffers a thread keeps before handing them back to the heap
+
+/*
+ * Read-only view of bytes owned by someone else: an RX buffer, a pooled
+ * frame or a vector. Parsers take one instead of copying the frame into a
+ * vector of their own.
+ */
+class ByteSpan
+{
+ public:
+    ByteSpan(const uint8_t *data, size_t length) : bytes(data), count(length) {}
+    ByteSpan(const std::vector<uint8_t> &v) : bytes(v.data()), count(v.size()) {}
+
+    const uint8_t *data(void) const { return this->bytes; }
+    size_t size(void) const { return this->count; }
+    bool empty(void) const { return this->count == 0; }
+    const uint8_t &operator[](size_t i) const { return this->bytes[i]; }
+    const uint8_t *begin(void) const { return this->bytes; }
+    const uint8_t *end(void) const { return this->bytes + this->count; }
+
+ private:
+    const uint8_t *bytes;
+    size_t count;
+};
+
+/*
+ * Per-thread free list of FRAME_BUFFER_SIZE byte buffers. Each gateway
+ * thread builds and parses its frames from its own pool, so no lock is
+ * taken and, once warmed up, the global allocator is not touched.
+ */
+class FramePool
+{
+ public:
+    static FramePool &local(void);
+
+    uint8_t *acquire(void);
+    void release(uint8_t *buf);
+
+    ~FramePool();
+
+ private:
+    std::vector<uint8_t *> spare;
+};
+
+/*
+ * One outgoing frame in pooled memory. PMESH headers and DLMS payloads are
+ * appended straight into it; the buffer goes back to the thread's pool when
+ * the frame is destroyed. Appends past FRAME_BUFFER_SIZE are dropped and
+ * reported by overflowed().
+ */
+class FrameBuffer
+{
+ public:
+    FrameBuffer(void) = default;
+    FrameBuffer(FrameBuffer &&other) noexcept;
+    FrameBuffer &operator=(FrameBuffer &&other) noexcept;
+    FrameBuffer(const FrameBuffer &) = delete;
+    FrameBuffer &operator=(const FrameBuffer &) = delete;
+    ~FrameBuffer();
+
+    void push(uint8_t value);
+    void push(const void *src, size_t length);
+    void assign(const uint8_t *src, size_t length);
+    void resize(size_t length); // new bytes are zero
+    void clear(void) { this->length = 0; }
+
+    uint8_t *data(void);
+    const uint8_t *data(void) const { return this->buf; }
+    size_t size(void) const { return this->length; }
+    bool empty(void) const { return this->length == 0; }
+    bool overflowed(void) const { return this->overflow; }
+    uint8_t &operator[](size_t i) { return this->buf[i]; }
+    const uint8_t &operator[](size_t i) const { return this->buf[i]; }
+    operator ByteSpan(void) const { return ByteSpan(this->buf, this->length); }
+
+ private:
+    uint8_t *buf = nullptr;
+    size_t length = 0;
+    bool overflow = false;
+
+    bool reserve(size_t length);
+};
+
+#endif // __FRAME_BUFFER_H__
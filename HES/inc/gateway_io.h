@@ -0,0 +1,72 @@
+#ifndef __GATEWAY_IO_H__
+#define __GATEWAY_IO_H__
+
+#include <poll.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <memory>
+#include <vector>
+
+#define GATEWAY_IO_RING_ENTRIES   32   // submission queue entries per gateway
+#define GATEWAY_IO_RX_BUFFERS     8    // provided receive buffers per gateway, a power of two
+#define GATEWAY_IO_RX_BUFFER_SIZE 2048 // several coalesced PMESH frames fit in one buffer
+
+/*
+ * Socket I/O of one gateway session, always used from its gateway thread.
+ *
+ * Built with HES_WITH_IO_URING against Linux 6.0+ uapi headers and enabled
+ * by HES.io_uring (off unless set to true), the session gets its own ring:
+ * a multishot receive keeps filling provided buffers, the eventfds waited
+ * on next to the socket get multishot polls, and one io_uring_enter both
+ * submits the queued sends and waits for the next completion. Where
+ * io_uring is missing or refuses the setup (old kernel, seccomp) the calls
+ * map onto poll/recv/send as before.
+ *
+ * recv, send and poll keep the semantics of the syscalls they replace,
+ * including the SO_RCVTIMEO timeout, so callers only change the call.
+ */
+class GatewayIo
+{
+ public:
+    GatewayIo();
+    ~GatewayIo();
+    GatewayIo(const GatewayIo &) = delete;
+    GatewayIo &operator=(const GatewayIo &) = delete;
+
+    void attach(int socket_fd); // the ring is created by the first call on the gateway thread
+    void detach(void);          // sends what is queued and stops reading, read-ahead bytes stay in pending()
+
+    void preload(const uint8_t *data, size_t length); // returned by recv before anything read from the socket
+    const std::vector<uint8_t> &pending(void) const { return this->preloaded; }
+
+    int set_recv_timeout(uint32_t time_in_sec);
+    ssize_t recv(uint8_t *buf, size_t length);
+    ssize_t send(const uint8_t *buf, size_t length);
+    int poll(pollfd *fds, nfds_t nfds, int timeout_ms);
+
+    // Holds the following sends until the next recv or poll, which submits them together with its wait
+    void cork(void) { this->corked = true; }
+    void uncork(void); // submits now what cork held back
+
+    bool uring_active(void) const;
+
+ private:
+    struct Uring;
+
+    int fd = -1;
+    uint32_t recv_timeout_sec = 0; // 0 waits forever, as SO_RCVTIMEO
+    bool recv_timeout_set = false;  // recv_timeout_sec is what the socket has
+    bool corked = false;
+    bool direct = false; // the ring could not be set up for this socket
+    std::vector<uint8_t> preloaded;
+    std::unique_ptr<Uring> uring;
+
+    bool use_uring(void);
+    bool wait(int timeout_ms);
+    void submit(void);
+    void close_uring(void);
+};
+
+#endif // __GATEWAY_IO_H__
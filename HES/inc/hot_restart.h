@@ -0,0 +1,75 @@
+#ifndef __HOT_RESTART_H__
+#define __HOT_RESTART_H__
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "nlohmann/json.hpp"
+
+#define HOT_RESTART_DEFAULT_PATH      "/tmp/pmesh_hes.handoff"
+#define HOT_RESTART_DEFAULT_DRAIN_SEC 30   // how long the old process waits for gateway threads to park
+#define HOT_RESTART_ABANDON_SEC       15   // then how long busy gateway threads get to end their sessions
+#define HOT_RESTART_MAX_MESSAGE       4096 // one snapshot per SOCK_SEQPACKET message
+
+// A gateway socket passed between processes with the state needed to resume it
+struct HandedSession
+{
+    int fd = -1;
+    nlohmann::json snapshot;
+};
+
+/*
+ * Zero-downtime restart. The running process listens on a Unix socket;
+ * a new binary started with --takeover connects to it. The old process then
+ * stops accepting, lets every idle gateway thread park its session, and
+ * sends the listening sockets and the parked gateway sockets over
+ * SCM_RIGHTS, each session with its JSON snapshot. It exits without
+ * shutting those sockets down, and the new process resumes the sessions
+ * without the gateways reconnecting. Gateways that were busy until the
+ * drain timeout end their session as on a disconnect (GW_DISCONNECTED for
+ * what they had queued or on the air) before the old process exits, and
+ * reconnect as on a normal restart.
+ */
+class HotRestart
+{
+ public:
+    static HotRestart &instance();
+
+    /* ---- old process ---- */
+
+    // live_sessions counts registered gateways, wake_sessions pokes every gateway thread
+    void start_listener(int server_fd, int metrics_fd, std::function<size_t(void)> live_sessions, std::function<void(void)> wake_sessions);
+    bool handoff_pending(void) const { return this->pending.load(std::memory_order_acquire); }
+    bool abandoning(void) const { return this->abandon.load(std::memory_order_acquire); } // busy sessions end now
+    bool park(int fd, nlohmann::json snapshot); // false once the drain gave up, the caller keeps the socket
+
+    /* ---- new process ---- */
+
+    // False when no running process answered, the caller starts cold
+    bool take_over(int &server_fd, int &metrics_fd, std::vector<HandedSession> &sessions);
+
+ private:
+    HotRestart();
+    HotRestart(const HotRestart &) = delete;
+    HotRestart &operator=(const HotRestart &) = delete;
+
+    void serve(int listen_fd, int server_fd, int metrics_fd);
+    void hand_off(int conn, int server_fd, int metrics_fd);
+
+    std::string path;
+    int drain_sec = HOT_RESTART_DEFAULT_DRAIN_SEC;
+    std::atomic<bool> pending{false};
+    std::atomic<bool> abandon{false};
+    std::function<size_t(void)> live_sessions;
+    std::function<void(void)> wake_sessions;
+
+    std::mutex park_mutex;
+    std::condition_variable parked_cv;
+    std::vector<HandedSession> parked;
+};
+
+#endif // __HOT_RESTART_H__
@@ -0,0 +1,87 @@
+#ifndef __INIT_ADMISSION_H__
+#define __INIT_ADMISSION_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <set>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+
+#define INIT_ADMISSION_DEFAULT_CONCURRENT 8    // gateways in init_connection at once
+#define INIT_ADMISSION_DEFAULT_RATE       2.0  // init_connection starts per second, sustained
+#define INIT_ADMISSION_DEFAULT_BURST      8    // starts allowed back to back after a quiet period
+#define INIT_ADMISSION_DEFAULT_VALID_SEC  1800 // a completed init is reused by a reconnect within this time
+#define INIT_ADMISSION_RECHECK_MS         500  // longest wait before a queued gateway is asked whether it still wants in
+
+/*
+ * Admission control for the heavy part of a new session (init_connection:
+ * FUOTA resume check, unsilence, NP and scalar pulls). A start takes a token
+ * from a bucket refilled at a fixed rate and a slot out of a fixed number of
+ * concurrent inits, so recovery after an outage runs at the rate MySQL and
+ * the RF network can take instead of all gateways at once.
+ *
+ * Waiting gateways are served most recently seen first; gateways this
+ * process has never seen come after them, in arrival order. A gateway whose
+ * last init completed within the validity window and whose session ended
+ * cleanly skips the queue and the heavy init altogether. A queued gateway
+ * that disconnects, or is told to give up by a hot restart, leaves the
+ * queue without taking a token or a slot.
+ */
+class InitAdmission
+{
+ public:
+    static InitAdmission &instance();
+
+    bool init_still_valid(const char *gateway_id);
+
+    // Blocks until this gateway may run init_connection (true) or give_up() says it no longer wants to (false)
+    bool acquire(const char *gateway_id, const std::function<bool(void)> &give_up);
+    void release(const char *gateway_id, bool completed);
+    void wake_waiters(void); // each waiter calls its give_up() now
+
+    // reusable is false when the session ended in a state the next init has to redo (FUOTA in progress)
+    void session_ended(const char *gateway_id, bool reusable);
+
+    size_t waiting(void);
+    size_t running(void);
+
+ private:
+    InitAdmission();
+    InitAdmission(const InitAdmission &) = delete;
+    InitAdmission &operator=(const InitAdmission &) = delete;
+
+    struct History
+    {
+        std::chrono::steady_clock::time_point init_done_at{};
+        std::chrono::steady_clock::time_point last_seen{};
+        bool init_done = false;
+        bool reusable = false;
+    };
+
+    // (never seen, -last seen in ms, arrival sequence): begin() is served next
+    using Key = std::tuple<bool, int64_t, uint64_t>;
+
+    void refill(std::chrono::steady_clock::time_point now);
+
+    std::mutex admission_mutex;
+    std::condition_variable admission_cv;
+    std::unordered_map<std::string, History> history;
+    std::set<Key> queue;
+    uint64_t sequence = 0;
+    size_t in_init = 0;
+
+    size_t max_concurrent = INIT_ADMISSION_DEFAULT_CONCURRENT;
+    double rate = INIT_ADMISSION_DEFAULT_RATE;
+    double burst = INIT_ADMISSION_DEFAULT_BURST;
+    std::chrono::seconds valid_for{INIT_ADMISSION_DEFAULT_VALID_SEC};
+    double tokens = INIT_ADMISSION_DEFAULT_BURST;
+    std::chrono::steady_clock::time_point refilled_at = std::chrono::steady_clock::now();
+};
+
+#endif // __INIT_ADMISSION_H__
@@ -0,0 +1,128 @@
+#ifndef __METRICS_H__
+#define __METRICS_H__
+
+#include <stdint.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <utility>
+
+#define METRICS_DEFAULT_PORT 9105
+
+/*
+ * Log-linear (HDR style) latency histogram in microseconds. Every power of
+ * two is split into 8 sub-buckets, so a recorded value lands in a bucket at
+ * most 12.5% wider than itself. Recording is a couple of relaxed atomic
+ * adds, the Prometheus buckets are folded from the fine buckets on scrape.
+ */
+class LatencyHistogram
+{
+ public:
+    static constexpr int SUB_BUCKET_BITS = 3;
+    static constexpr int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static constexpr int MAX_EXPONENT = 40; // ~12.7 days in microseconds
+    static constexpr int BUCKETS = (MAX_EXPONENT - SUB_BUCKET_BITS + 2) * SUB_BUCKETS;
+
+    void observe_us(uint64_t value_us);
+    void observe_since(std::chrono::steady_clock::time_point start);
+
+    uint64_t count(void) const { return this->total_count.load(std::memory_order_relaxed); }
+    uint64_t sum_us(void) const { return this->total_sum_us.load(std::memory_order_relaxed); }
+    uint64_t cumulative_count_le(uint64_t bound_us) const;
+
+ private:
+    static int bucket_index(uint64_t value_us);
+    static uint64_t bucket_upper_bound(int index);
+
+    std::array<std::atomic<uint64_t>, BUCKETS> buckets{};
+    std::atomic<uint64_t> total_count{0};
+    std::atomic<uint64_t> total_sum_us{0};
+};
+
+using MetricCounter = std::atomic<uint64_t>;
+using MetricGauge = std::atomic<int64_t>;
+
+/*
+ * Process-wide metric registry. Series are created on first use and never
+ * removed, so callers may keep the returned reference and update it without
+ * touching the registry again. render() produces the Prometheus text format
+ * served by the built-in HTTP endpoint.
+ */
+class Metrics
+{
+ public:
+    static Metrics &instance();
+
+    MetricCounter &counter(const std::string &name, const std::string &labels = "");
+    MetricGauge &gauge(const std::string &name, const std::string &labels = "");
+    LatencyHistogram &histogram(const std::string &name, const std::string &labels = "");
+    void gauge_callback(const std::string &name, std::function<int64_t(void)> read);
+
+    static std::string label(const char *key, const std::string &value);
+    static std::string statement_label(const char *query);
+
+    std::string render(void);
+    void start_http_server(int port);
+    void adopt_http_server(int listen_fd); // listener handed over by the process this one replaced
+    int http_socket(void) const { return this->http_fd.load(); }
+
+ private:
+    Metrics();
+    Metrics(const Metrics &) = delete;
+    Metrics &operator=(const Metrics &) = delete;
+
+    using SeriesKey = std::pair<std::string, std::string>; // name, labels
+
+    void serve_http(int listen_fd);
+
+    std::shared_timed_mutex registry_mutex;
+    std::map<std::string, std::pair<std::string, std::string>> help; // name -> (type, help)
+    std::map<SeriesKey, std::unique_ptr<MetricCounter>> counters;
+    std::map<SeriesKey, std::unique_ptr<MetricGauge>> gauges;
+    std::map<SeriesKey, std::unique_ptr<LatencyHistogram>> histograms;
+    std::map<std::string, std::function<int64_t(void)>> callbacks;
+    std::atomic<bool> http_started{false};
+    std::atomic<int> http_fd{-1};
+};
+
+/*
+ * Series of one gateway, bound once the gateway id is known. Unbound
+ * (default) instances ignore updates.
+ */
+struct GatewayMetrics
+{
+    LatencyHistogram *rf_rtt = nullptr;
+    MetricCounter *rf_transmits = nullptr;
+    MetricCounter *rf_retries = nullptr;
+    MetricCounter *rf_timeouts = nullptr;
+    MetricGauge *odm_queue_depth = nullptr;
+    LatencyHistogram *odm_wait = nullptr;
+    MetricCounter *odm_coalesced = nullptr;
+
+    void bind(const char *gateway_id);
+
+    void add(MetricCounter *counter) const
+    {
+        if (counter)
+            counter->fetch_add(1, std::memory_order_relaxed);
+    }
+    void set(MetricGauge *gauge, int64_t value) const
+    {
+        if (gauge)
+            gauge->store(value, std::memory_order_relaxed);
+    }
+    void observe_since(LatencyHistogram *histogram, std::chrono::steady_clock::time_point start) const
+    {
+        if (histogram)
+            histogram->observe_since(start);
+    }
+};
+
+#endif // __METRICS_H__
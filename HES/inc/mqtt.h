@@ -4,15 +4,20 @@
 #include <mosquitto.h>
 #include <sys/eventfd.h>
 
+#include <atomic>
 #include <cstdint>
 #include <deque>
 #include <iostream>
 #include <queue>
 #include <set>
 #include <string>
+#include <string_view>
 #include <unordered_set>
 #include <vector>
 
+#include "command_queue.h"
+#include "metrics.h"
+#include "request_index.h"
 #include "utility.h"
 
 #define REQUEST_ID         0
@@ -23,9 +28,13 @@
 #define COMMAND            5
 #define PING_COUNT         6
 #define PING_INTERVAL      7
+#define MAX_STALENESS      6 // optional on ODM reads: seconds the cached profile may be old
+#define DEADLINE           7 // optional on non-ping ODM: seconds to schedule against, per-class default otherwise
 
 #define FIRMWARE_PATH      5
 #define FIRMWARE_FILE_NAME 6
+
+#define ODM_RESULTS_PER_MESSAGE 200 // completion events batched into one ONDEMAND_RESPONSE publish
 /*
 ------------------------
 Class Description:
@@ -43,6 +52,11 @@ class MQTTClient : public virtual BaseLogger
     int mqtt_socket;
     char MqttTopic[64] = {0};
     char ClientID[64] = {0};
+    char ResponseTopic[64] = {0};
+
+    // Completion events waiting for the next publish_odm_results(), gateway thread only
+    bool results_enabled = true;
+    nlohmann::json pending_results = nlohmann::json::array();
 
     //(added by hari)
     // External ODM related members
@@ -52,6 +66,9 @@ class MQTTClient : public virtual BaseLogger
     std::string allowed_cmds;
     std::string g_previous_group_id;
     std::mutex fuota_queue_mtx;
+    std::deque<FailedCommand> failed_overflow; // Failed entries that did not fit the ring, never dropped
+    std::mutex failed_overflow_mtx;
+    std::atomic<bool> ondemand_wakeup_pending{false}; // eventfd already written, not yet read by the gateway thread
 
     //(added by hari ends here)
  protected:
@@ -66,15 +83,19 @@ class MQTTClient : public virtual BaseLogger
     std::string gatewayIdStr; //(added by Amith KN)
     uint8_t ODM_Flag = 0;     // to identify ODM in progress
 
-    // Queues for each processing type
-    std::queue<std::vector<uint8_t>> ODM;            // On-demand commands
-    std::queue<std::vector<uint8_t>> Failed;         // Failed commands
-    std::queue<std::vector<uint8_t>> RF_Meter_FUOTA; // FUOTA commands
+    // Queues for each processing type, filled by the mosquitto thread and drained by the gateway thread
+    MpscRing<QueuedCommand, ODM_QUEUE_CAPACITY> ODM;              // On-demand commands
+    MpscRing<FailedCommand, FAILED_QUEUE_CAPACITY> Failed;        // Failed commands
+    MpscRing<QueuedCommand, FUOTA_QUEUE_CAPACITY> RF_Meter_FUOTA; // FUOTA commands
     std::queue<std::vector<uint8_t>> RFMeterFUOTA;
     std::queue<std::string> cancelled_requests; // Cancelled request IDs
     std::mutex cancelled_mutex;                 // Mutex for thread-safe access to cancelled_requests
 
+    GatewayMetrics gateway_metrics; // Bound to this gateway in initCommunication
+
     static const size_t MAX_QUEUE_SIZE = 500;
+    static_assert(ODM_QUEUE_CAPACITY >= MAX_QUEUE_SIZE && FAILED_QUEUE_CAPACITY >= MAX_QUEUE_SIZE && FUOTA_QUEUE_CAPACITY >= MAX_QUEUE_SIZE,
+                  "command rings must hold MAX_QUEUE_SIZE commands");
     MQTTClient();
     ~MQTTClient();
 
@@ -87,18 +108,21 @@ class MQTTClient : public virtual BaseLogger
     static void on_connect(struct mosquitto *mosq, void *obj, int rc);
     static void on_disconnect(struct mosquitto *mosq, void *obj, int rc);
     //(added by Amith KN)
-    void enqueue_odm(const std::string &cmd);
-    void enqueue_failed(const std::string &cmd);
-    void enqueue_fuota(const std::string &cmd);
+    void enqueue_odm(const QueuedCommand &cmd);
+    void enqueue_failed(const QueuedCommand &cmd);
+    bool take_failed_overflow(std::deque<FailedCommand> &out);
+    void enqueue_fuota(const QueuedCommand &cmd);
+    void signal_ondemand(void);
+    void ack_ondemand_signal(void);
+    bool take_cancelled(int request_id);
     void validate_request_ids(const char *message, const char *gateway_id, MQTTClient *client);
-    void remove_commands_by_req_id(std::queue<std::vector<uint8_t>> &queue,
-                                   const std::unordered_set<std::string> &cancel_req_ids);
-    bool hex_to_bytes(const std::string &hex, std::vector<uint8_t> &out);
-    bool Validate_command(const std::vector<std::string> &parts);
-    bool contains(const std::deque<std::string> &dq, const std::string &id);
+    bool Validate_command(const QueuedCommand &cmd);
+    void add_odm_result(bool ping, unsigned int req_id, int status, uint16_t err_code, const nlohmann::json &values);
+    void publish_odm_results(void);
 
     //(added by Hari)
     bool check_rf_fuota_queue_empty();
+    bool dequeue_fuota(QueuedCommand &out_cmd);
     bool dequeue_fuota(std::vector<uint8_t> &out_cmd);
     void resume_fuota(const std::string &cmd);
     bool dequeue_pending_fuota(std::vector<uint8_t> &out_cmd);
@@ -109,10 +133,7 @@ class MQTTClient : public virtual BaseLogger
     std::string firmware_filename;
     std::string firmware_path;
     std::string dcuIdStr;
-    std::mutex global_id_mutex;
-    std::deque<std::string> global_seen_req_ids;
-    std::deque<std::string> special_req_ids; // For download types 13,14
-    std::deque<std::string> FUOTA_req_ids;   // For download type 27: FUOTA
+    RequestIndex request_index; // Queued / cancelled / recently seen request IDs of this gateway
 };
 
 #endif // __MQTT_H__
\ No newline at end of file
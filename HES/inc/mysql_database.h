@@ -7,18 +7,22 @@
 
 #include <array>
 #include <chrono>
+#include <functional>
 #include <iostream>
 #include <map>
 #include <mutex>
 #include <queue>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include "String_functions.h"
+#include "command_queue.h"
 // #include "fuota.h"
 #include "helper.h"
 #include "packet_buffer.h"
+#include "status_journal.h"
 #include "utility.h"
 
 class Fuota;
@@ -107,6 +111,9 @@ struct NodeInfo;
 class PacketBufferBlockLoad;
 struct ODM_NamePlateProfile;
 
+// Pull node table keyed by the 64-bit node MAC (see PullData::mac_to_key)
+using NodeMap = std::unordered_map<uint64_t, NodeInfo>;
+
 struct ManufacturerScalarData
 {
     std::map<std::pair<std::string, uint8_t>, int32_t> scalar_values; // (attribute_id, index) -> signed scalar_value
@@ -126,6 +133,7 @@ class MySqlDatabase : public virtual BaseLogger
     // Protects access to the MYSQL* handle - mysql client is not safe for
     // concurrent use from multiple threads using the same connection.
     std::mutex mysql_mutex;
+    StatusJournal status_journal; // request status transitions not yet written
 
  public:
     MySqlDatabase();
@@ -151,10 +159,14 @@ class MySqlDatabase : public virtual BaseLogger
     bool connect_to_mysql();
     bool check_and_reconnect();
     int execute_query(char *query);
+    int query_each_row(char *query, const std::function<void(MYSQL_ROW row)> &on_row);
 
     int Update_dlms_on_demand_request_status(unsigned int req_id, RequestStatus status, uint16_t err_code); //(added by Amith KN)
     int Update_dlms_on_demand_Ping_request_status(unsigned int req_id, RequestStatus status);               //(added by Amith KN)
-    bool check_path_in_source_route_network(const std::vector<std::string> &parts, int request_id);         //(added by Amith KN)
+    int flush_status_journal(void);
+    std::function<void(const std::vector<StatusBatch> &)> on_status_flushed; // sees the request IDs flush_status_journal wrote, never failed ones
+    void flush_status_journal_if_due(void);
+    bool check_path_in_source_route_network(const QueuedCommand &cmd, int request_id);                     //(added by Amith KN)
     float convertScalar(int32_t raw);                                                                       //(added by Amith KN)
 
     //(added by Supritha K P)
@@ -166,6 +178,7 @@ class MySqlDatabase : public virtual BaseLogger
     int check_for_scalar_profile(char *gateway_id);
     bool enqueue_info(uint8_t *meter_manufacture_name, uint16_t attribute_id, uint8_t *meter_mac_address, uint8_t meter_phase, char *gateway_id, uint8_t *meter_fw_version);
     int check_for_unsilenced_nodes(char *gateway_id);
+    void snapshot_source_routes(std::unordered_map<std::string, silenceND> &routes);
     int check_for_fuota_resume(char *gateway_id);
     int compare_schedule_time(const char *schedule_time_str, std::string current_time_str);
     int delete_node_from_db(uint8_t *meter_mac_address, char *gateway_id);
@@ -180,7 +193,8 @@ class MySqlDatabase : public virtual BaseLogger
     //(added by Supritha K P)
 
     /* PULL */ // Added by Puneeth
-    int get_nodes_info_from_src_route_network_db(std::map<std::array<uint8_t, 8>, NodeInfo> &nodes_info, const char *gateway_id);
+    int get_nodes_info_from_src_route_network_db(NodeMap &nodes_info, const char *gateway_id);
+    int get_topology_fingerprint(const char *gateway_id, std::string &fingerprint);
     int get_alternate_path_for_node(NodeInfo &node, const char *gateway_id);
     std::vector<int> get_last_hour_missing_ip_cycles_for_node(std::array<uint8_t, 8> node_mac_address, const char *gateway_id);
     bool is_blp_available_last_hour(std::array<uint8_t, 8> node_mac_address, const char *gateway_id);
@@ -191,13 +205,18 @@ class MySqlDatabase : public virtual BaseLogger
     bool is_node_silenced(std::array<uint8_t, 8> node_mac_address, const char *gateway_id);
     int is_ifv_available_for_node(std::array<uint8_t, 8> node_mac_address, const char *gateway_id);
     int delete_node_from_unsilence_nodes_from_fuota(std::array<uint8_t, 8> node_mac_address, const char *gateway_id);
+    int load_coverage_index_from_db(const char *gateway_id);
     int insert_update_hes_nms_sync_time(const char *gateway_mac, int status);
+    int get_nms_released_gateways(const std::vector<std::string> &gateway_ids, std::vector<std::string> &released);
 
     int calculate_cycle_id(int subtract_cycles = 0);
     int calculate_cycle_id_for_block_load(void);
     std::string format_timestamp(uint32_t hex_timestamp);
     std::string parse_dlms_date_time(const uint8_t *data, size_t len);
     std::string get_event_code_string_from_event_code(uint16_t event_code);
+    int load_event_code_dictionary(void);
+    int detect_ping_summary_schema(void);
+    bool has_ping_rtt_columns(void) const;
 
     int insert_name_plate_data(std::array<uint8_t, 8> node_mac_address, const char *gateway_id, PacketBuffer<DlmsRecordMap> *name_plate_data);
     int update_internal_firmware_version_in_meter_details(std::array<uint8_t, 8> node_mac_address, const char *gateway_id, uint8_t *internal_firmware_version);
@@ -0,0 +1,71 @@
+#ifndef __NMS_LEASE_H__
+#define __NMS_LEASE_H__
+
+#include <stdint.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#define NMS_LEASE_DEFAULT_POLL_MS  250
+#define NMS_LEASE_RETRY_BACKOFF_MS 30000 // next acquire after one that failed for any reason other than NMS
+
+enum class NmsLeaseState : uint8_t
+{
+    UNKNOWN = 0,
+    FREE,
+    HELD_BY_HES,
+    HELD_BY_NMS
+};
+
+/*
+ * In-memory view of hes_nms_sync_time shared by every gateway thread.
+ * insert_update_hes_nms_sync_time() records the outcome of each acquire
+ * and release here. While NMS holds any gateway, one watcher thread polls
+ * hes_nms_sync_time for all of them with a single query and writes to the
+ * eventfd of each gateway thread waiting for the release.
+ */
+class NmsLeaseManager
+{
+ public:
+    static NmsLeaseManager &instance();
+
+    NmsLeaseState get_state(const char *gateway_id);
+    void set_state(const char *gateway_id, NmsLeaseState state);
+
+    // True only while the watcher is keeping the cached NMS hold up to date
+    bool is_held_by_nms(const char *gateway_id);
+
+    // Returns false when NMS no longer holds the gateway, nothing to wait for
+    bool add_waiter(const char *gateway_id, int event_fd);
+    void remove_waiter(const char *gateway_id, int event_fd);
+
+    void set_poll_interval(int milliseconds);
+
+ private:
+    NmsLeaseManager() = default;
+    NmsLeaseManager(const NmsLeaseManager &) = delete;
+    NmsLeaseManager &operator=(const NmsLeaseManager &) = delete;
+
+    struct Lease
+    {
+        NmsLeaseState state = NmsLeaseState::UNKNOWN;
+        std::vector<int> waiters;                          // eventfds of gateway threads waiting for NMS to release
+        std::chrono::steady_clock::time_point observed_at{}; // last time the DB showed the NMS hold
+    };
+
+    bool any_held_by_nms(void) const;
+    std::chrono::milliseconds max_hold_age(void) const;
+    void watch_nms_releases(void);
+
+    std::mutex lease_mutex;
+    std::condition_variable watch_cv;
+    std::unordered_map<std::string, Lease> leases;
+    bool watcher_started = false;
+    int poll_interval_ms = NMS_LEASE_DEFAULT_POLL_MS;
+};
+
+#endif // __NMS_LEASE_H__
@@ -0,0 +1,81 @@
+#ifndef __ODM_SCHEDULER_H__
+#define __ODM_SCHEDULER_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <chrono>
+#include <map>
+#include <memory>
+#include <tuple>
+
+#include "command_queue.h"
+
+#define ODM_SCHEDULE_CAPACITY 500 // commands held per gateway once drained from the ODM ring
+
+enum class OdmPriority : uint8_t
+{
+    URGENT = 0,  // load limit and load connect/disconnect writes
+    INTERACTIVE, // single value reads, other writes, MD reset
+    BULK,        // profile and event reads
+    PING,        // ping node / ping meter
+    COUNT
+};
+
+/*
+ * Gateway-thread view of the pending ODM commands. The mosquitto thread
+ * still pushes into the lock-free ODM ring; the gateway thread moves them
+ * here and always runs the highest priority class first, earliest deadline
+ * first within a class, arrival order on ties.
+ *
+ * When full, the command that sorts last (lowest class, latest deadline) is
+ * handed back to the caller to be rejected, so a backlog of bulk reads never
+ * keeps a disconnect command out.
+ */
+class OdmScheduler
+{
+ public:
+    static OdmPriority priority_of(int download_data_type);
+    static std::chrono::seconds default_deadline(OdmPriority priority);
+
+    // Returns the command that did not fit, nullptr when cmd was admitted without eviction
+    std::unique_ptr<QueuedCommand> admit(const QueuedCommand &cmd, int deadline_sec);
+
+    // Removes and returns the command to run next, nullptr when empty
+    std::unique_ptr<QueuedCommand> next(void);
+
+    // Removes and returns the first command in run order that pred accepts, nullptr when none does
+    template <typename P>
+    std::unique_ptr<QueuedCommand> next_if(P pred)
+    {
+        for (auto it = this->pending.begin(); it != this->pending.end(); ++it)
+        {
+            if (!pred(static_cast<const QueuedCommand &>(*it->second)))
+                continue;
+
+            std::unique_ptr<QueuedCommand> cmd = std::move(it->second);
+            this->pending.erase(it);
+            return cmd;
+        }
+        return nullptr;
+    }
+
+    template <typename F>
+    void for_each(F f)
+    {
+        for (auto &entry : this->pending)
+            f(*entry.second);
+    }
+
+    size_t size(void) const { return this->pending.size(); }
+    bool empty(void) const { return this->pending.empty(); }
+
+ private:
+    // (class, deadline, arrival sequence)
+    using Key = std::tuple<uint8_t, std::chrono::steady_clock::time_point, uint64_t>;
+
+    std::map<Key, std::unique_ptr<QueuedCommand>> pending;
+    uint64_t sequence = 0;
+};
+
+#endif // __ODM_SCHEDULER_H__
@@ -0,0 +1,47 @@
+#ifndef __PING_SERIES_H__
+#define __PING_SERIES_H__
+
+#include <stdint.h>
+
+#include <chrono>
+#include <vector>
+
+#define PING_SERIES_DEFAULT_PARALLEL 16 // ping series kept running per gateway, beside the ODM pipeline
+#define PING_SERIES_MAX_PARALLEL 64
+
+// What one ping series leaves in dlms_on_demand_ping_request
+struct PingSummary
+{
+    uint16_t sent = 0;
+    uint16_t received = 0;
+    uint32_t rtt_min_ms = 0;
+    uint32_t rtt_avg_ms = 0;
+    uint32_t rtt_p95_ms = 0;
+    uint8_t loss_percent = 0;
+};
+
+/*
+ * Round trip times of the pings sent to one target. At most one ping is
+ * outstanding at a time; each is either answered or lost before the next
+ * goes out. Samples stay in memory until the series is summarized.
+ */
+class RttSeries
+{
+ public:
+    void sent(std::chrono::steady_clock::time_point now);
+
+    // Records the answer to the outstanding ping, returns its RTT in ms
+    uint32_t answered(std::chrono::steady_clock::time_point now);
+    void lost(void);
+
+    bool outstanding(void) const { return this->waiting; }
+    PingSummary summary(void) const;
+
+ private:
+    std::vector<uint32_t> rtt_ms;
+    uint16_t sent_count = 0;
+    bool waiting = false;
+    std::chrono::steady_clock::time_point sent_at{};
+};
+
+#endif // __PING_SERIES_H__
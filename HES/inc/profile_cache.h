@@ -0,0 +1,82 @@
+#ifndef __PROFILE_CACHE_H__
+#define __PROFILE_CACHE_H__
+
+#include <stdint.h>
+
+#include <array>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+
+// error_code stored with SUCCESS_STATUS when an ODM read is answered from the
+// cache, above the DLMS data-access-result codes an RF answer can carry
+#define ODM_CACHE_ERROR_CODE_BASE 0x0F00
+
+enum class ProfileSource : uint8_t
+{
+    PULL = 0, // HES 15-minute cycle
+    PUSH,     // meter push
+    ODM       // on-demand read over RF
+};
+
+// One instantaneous profile row, scaled, as inserted into dlms_ip_push_data
+struct InstantaneousRecord
+{
+    std::string meter_rtc_time;
+    float voltage = 0.0f;
+    float phase_current = 0.0f;
+    float neutral_current = 0.0f;
+    float signed_powerfactor = 0.0f;
+    float frequency = 0.0f;
+    float apparent_power_kva = 0.0f;
+    float active_power_kw = 0.0f;
+    float cum_energy_kwh_import = 0.0f;
+    float cum_energy_kvah_import = 0.0f;
+    float maximum_demand_kw = 0.0f;
+    std::string md_kw_datetime;
+    float maximum_demand_kva = 0.0f;
+    std::string md_kva_datetime;
+    float cum_power_on_duration = 0.0f;
+    float cum_tamper_count = 0.0f;
+    float cum_billing_count = 0.0f;
+    float cum_programming_count = 0.0f;
+    float cum_energy_kwh_export = 0.0f;
+    float cum_energy_kvah_export = 0.0f;
+    int loadlimit_function_sts = 0;
+    float loadlimit_value_kw = 0.0f;
+    std::string last_download_time; // when the meter was read
+};
+
+/*
+ * Process-wide last value of the decoded profiles per meter, filled by the
+ * pull cycle, push and ODM insert paths. An ODM read that accepts data up to
+ * a given age is answered from here instead of going over RF.
+ */
+class ProfileCache
+{
+ public:
+    static ProfileCache &instance();
+
+    void store_ip(const std::array<uint8_t, 8> &mac, const InstantaneousRecord &record, ProfileSource source);
+
+    // False when nothing is cached for the meter or it is older than max_age_sec
+    bool lookup_ip(const std::array<uint8_t, 8> &mac, int max_age_sec, InstantaneousRecord &record, ProfileSource &source);
+
+ private:
+    struct CachedInstantaneous
+    {
+        InstantaneousRecord record;
+        ProfileSource source = ProfileSource::PULL;
+        std::chrono::steady_clock::time_point stored_at;
+    };
+
+    ProfileCache() = default;
+    ProfileCache(const ProfileCache &) = delete;
+    ProfileCache &operator=(const ProfileCache &) = delete;
+
+    std::mutex cache_mutex;
+    std::map<std::array<uint8_t, 8>, CachedInstantaneous> instantaneous;
+};
+
+#endif // __PROFILE_CACHE_H__
@@ -1,6 +1,8 @@
 #ifndef __PULL_H__
 #define __PULL_H__
 
+#include <ctime>
+
 #include "database.h"
 #include "push.h"
 #include "utility.h"
@@ -83,6 +85,48 @@ struct NodeProfileData
     PacketBuffer<DlmsRecordMap> billing_history{};
 };
 
+enum PullStage
+{
+    PULL_STAGE_UNSILENCE = 0,
+    PULL_STAGE_IFV,
+    PULL_STAGE_NAMEPLATE,
+    PULL_STAGE_IP,
+    PULL_STAGE_DLP,
+    PULL_STAGE_BLP,
+    PULL_STAGE_BHP,
+    PULL_STAGE_COUNT
+};
+
+#define PULL_DEFAULT_STAGE_RETRIES     1 // extra attempts for a stage once the node has answered
+#define PULL_DEFAULT_QUARANTINE_AFTER  3 // consecutive cycles without any answer
+#define PULL_DEFAULT_QUARANTINE_CYCLES 4 // cycles a quarantined node is left out
+
+struct NodePullHealth
+{
+    uint8_t stage_failures[PULL_STAGE_COUNT]{}; // consecutive failed cycles per stage
+    int failed_cycles = 0;                      // consecutive cycles with failures and no answer
+    int quarantine_cycles = 0;                  // remaining cycles in quarantine
+    bool answered = false;                      // node answered in the current cycle
+    bool failed = false;                        // a stage failed in the current cycle
+};
+
+struct PullStageCount
+{
+    int completed = 0;
+    int skipped = 0;
+    int failed = 0;
+};
+
+struct PullCycleReport
+{
+    PullStageCount stages[PULL_STAGE_COUNT]{};
+    size_t nodes = 0;
+    int quarantined = 0;
+    int unreachable = 0;
+    std::time_t started = 0;
+    std::time_t finished = 0;
+};
+
 struct NodeInfo
 {
     std::array<uint8_t, 8> node_mac_address{};
@@ -90,6 +134,39 @@ struct NodeInfo
     PathInfo primary_path{};
     std::vector<PathInfo> alternate_paths{};
     NodeProfileData profile_data{};
+    bool scalar_loaded = false;
+    NodePullHealth health{};
+};
+
+#define NODE_TABLE_DEFAULT_TTL_SEC 3600
+
+/*
+ * Per-gateway node list kept across pull cycles. Paths, alternate paths
+ * and loaded scalers are reused until the routing tables change or the
+ * TTL expires; only the missing-info flags are refreshed every cycle.
+ */
+struct NodeTable
+{
+    NodeMap nodes{};
+    std::string topology_fingerprint{};
+    std::chrono::steady_clock::time_point loaded_at{};
+    int ttl_sec = NODE_TABLE_DEFAULT_TTL_SEC;
+    bool valid = false;
+
+    int stage_retries = PULL_DEFAULT_STAGE_RETRIES;
+    int quarantine_after = PULL_DEFAULT_QUARANTINE_AFTER;
+    int quarantine_cycles = PULL_DEFAULT_QUARANTINE_CYCLES;
+    PullCycleReport last_report{};
+
+    void invalidate()
+    {
+        this->valid = false;
+    }
+
+    bool is_expired() const
+    {
+        return std::chrono::steady_clock::now() - this->loaded_at >= std::chrono::seconds(this->ttl_sec);
+    }
 };
 
 struct GatewayDetails
@@ -105,6 +182,7 @@ class PullData : public virtual BaseLogger, public virtual MySqlDatabase, public
 
     static std::array<uint8_t, 8> mac_from_hex(const char *hex);
     static void mac_to_hex(const std::array<uint8_t, 8> &mac, char *out16);
+    static uint64_t mac_to_key(const std::array<uint8_t, 8> &mac);
     static bool extract_path(const std::string &hex_path, int hop_count, std::vector<uint8_t> &out);
 
     uint8_t calculate_checksum(const uint8_t *buff, size_t length);
@@ -1,6 +1,7 @@
 #ifndef __PUSH_H__
 #define __PUSH_H__
 
+#include "frame_buffer.h"
 #include "mysql_database.h"
 #include "packet_buffer.h"
 #include "utility.h"
@@ -278,7 +279,7 @@ class DLMSParser : public virtual BaseLogger
     }
 
     // Parse value based on data type
-    bool parseByType(const std::vector<uint8_t> &data, size_t &offset, DLMSDataType dataType, DLMSValueStruct &value)
+    bool parseByType(ByteSpan data, size_t &offset, DLMSDataType dataType, DLMSValueStruct &value)
     {
         if (offset >= data.size())
         {
@@ -496,8 +497,8 @@ class PushData : public virtual MySqlDatabase, public virtual BaseLogger, public
     uint8_t calculate_checksum(const uint8_t *buff, size_t length);
     void cleanup_push_profiles(void);
     void process_push_data(uint8_t *buff, ssize_t length, const char *gateway_id);
-    int parseDLMSRecords(const std::vector<uint8_t> &data, const uint8_t &number_of_records, PacketBuffer<DlmsRecordMap> &records);
-    int parseBlockLoadDLMSRecords(const std::vector<uint8_t> &data, const uint8_t &number_of_records, PacketBufferBlockLoad &records);
+    int parseDLMSRecords(ByteSpan data, const uint8_t &number_of_records, PacketBuffer<DlmsRecordMap> &records);
+    int parseBlockLoadDLMSRecords(ByteSpan data, const uint8_t &number_of_records, PacketBufferBlockLoad &records);
 
     void process_IP_push_data(uint8_t *buff, ssize_t length, const char *gateway_id);
     void process_DLP_push_data(uint8_t *buff, ssize_t length, const char *gateway_id);
@@ -0,0 +1,73 @@
+#ifndef __REQUEST_INDEX_H__
+#define __REQUEST_INDEX_H__
+
+#include <stdint.h>
+
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#define REQUEST_ID_DEFAULT_TTL_SEC 900
+
+enum class RequestCategory : uint8_t
+{
+    ODM = 0, // every other download type
+    PING,    // download types 13, 14
+    FUOTA,   // download type 27
+    COUNT
+};
+
+/*
+ * Per-gateway index of on-demand request IDs, shared by the mosquitto thread
+ * and the gateway thread.
+ *
+ * Queued commands are tracked by request ID so a CANCEL only flips the entry
+ * to a tombstone, the gateway thread drops tombstoned commands when it
+ * dequeues them. IDs seen in the last ttl seconds are kept per category to
+ * reject duplicates; expiry runs in arrival order so every call is O(1)
+ * amortized however full the queues are.
+ */
+class RequestIndex
+{
+ public:
+    // False when the ID was already seen in this category within the TTL
+    bool remember(RequestCategory category, std::string_view request_id);
+    size_t seen_count(void);
+    void set_seen_ttl(int seconds);
+
+    void queued(int request_id);
+    void unqueued(int request_id);
+
+    // True when the ID is waiting in a queue, it is skipped once dequeued
+    bool cancel(int request_id);
+
+    // Gateway thread on dequeue: forgets the ID, true when it was cancelled
+    bool take(int request_id);
+
+ private:
+    enum class QueueState : uint8_t
+    {
+        QUEUED,
+        CANCELLED
+    };
+
+    struct SeenEntry
+    {
+        std::chrono::steady_clock::time_point expires_at;
+        RequestCategory category;
+        std::string request_id;
+    };
+
+    void expire_seen(std::chrono::steady_clock::time_point now);
+
+    std::mutex index_mutex;
+    std::unordered_map<int, QueueState> queue_states;
+    std::unordered_map<std::string, std::chrono::steady_clock::time_point> seen[static_cast<int>(RequestCategory::COUNT)];
+    std::deque<SeenEntry> seen_order; // oldest first
+    std::chrono::seconds seen_ttl{REQUEST_ID_DEFAULT_TTL_SEC};
+};
+
+#endif // __REQUEST_INDEX_H__
@@ -5,6 +5,7 @@
 #include <chrono>
 #include <cmath>
 #include <csignal>
+#include <fcntl.h>
 #include <cstdio>
 #include <cstring>
 #include <ctime>
@@ -36,8 +37,12 @@
 #include <vector>
 
 #include "client.h"
+#include "hot_restart.h"
 #include "utility.h"
 
+#define LISTEN_DEFAULT_BACKLOG 256
+#define ACCEPT_SHARDS_MAX 64
+
 class Client;
 class MQTTClient;
 class MySqlDatabase;
@@ -47,10 +52,15 @@ class Server
 {
  private:
     int server_socket, server_port;
-    sockaddr_in server_addr, client_addr;
+    int accept_shards = 1, listen_backlog = LISTEN_DEFAULT_BACKLOG;
+    std::vector<int> shard_sockets;             // extra SO_REUSEPORT listeners on the gateway port, one acceptor thread each
+    std::vector<HandedSession> handed_sessions; // gateways taken over from the previous process
+
+    int open_listening_socket(bool reuse_port);
+    void accept_loop(int listen_fd, int shard);
 
  public:
-    Server();
+    Server(bool takeover = false);
     ~Server();
 
     static std::mutex clients_mutex;
@@ -59,6 +69,7 @@ class Server
     void accept_and_dispatch(void);
     bool configure_socket_options(int socket_fd);
     static void handle_client(std::unique_ptr<Client> client);
+    static void resume_client(std::unique_ptr<Client> client, nlohmann::json snapshot);
 };
 
 #endif // __SERVER_H__
@@ -0,0 +1,55 @@
+#ifndef __SLAB_POOL_H__
+#define __SLAB_POOL_H__
+
+#include <stddef.h>
+
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+#define CLIENT_SLAB_OBJECTS 16 // Client sessions carved out of one slab
+
+/*
+ * Fixed size blocks carved out of slabs of objects_per_slab blocks, every
+ * block aligned to alignment. Freed blocks go on a free list and are reused
+ * by the next allocation; slabs are only returned to the heap when the pool
+ * is destroyed. Safe to use from several threads.
+ */
+class SlabPool
+{
+ public:
+    SlabPool(size_t block_size, size_t objects_per_slab, size_t alignment = alignof(std::max_align_t));
+    ~SlabPool();
+
+    SlabPool(const SlabPool &) = delete;
+    SlabPool &operator=(const SlabPool &) = delete;
+
+    // False when the caller has to fall back to the heap for an object of this size
+    bool fits(size_t size) const { return size <= this->block_size; }
+    size_t alignment(void) const { return this->block_align; }
+
+    // nullptr when size does not fit a block
+    void *allocate(size_t size);
+    void release(void *ptr);
+
+    size_t in_use(void) const;
+    size_t capacity(void) const;
+
+ private:
+    struct FreeBlock
+    {
+        FreeBlock *next;
+    };
+
+    size_t block_size;
+    size_t block_align;
+    size_t objects_per_slab;
+    std::vector<unsigned char *> slabs;
+    FreeBlock *free_list = nullptr;
+    size_t used = 0;
+    mutable std::mutex pool_mutex;
+
+    void add_slab(void);
+};
+
+#endif // __SLAB_POOL_H__
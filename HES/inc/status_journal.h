@@ -0,0 +1,74 @@
+#ifndef __STATUS_JOURNAL_H__
+#define __STATUS_JOURNAL_H__
+
+#include <stdint.h>
+
+#include <chrono>
+#include <ctime>
+#include <map>
+#include <mutex>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#define STATUS_JOURNAL_DEFAULT_WINDOW_MS 250
+#define STATUS_JOURNAL_MAX_PENDING 256    // flushed at once when this many requests are waiting
+#define STATUS_JOURNAL_IDS_PER_QUERY 500 // request IDs in one UPDATE ... WHERE request_id IN (...)
+
+enum class StatusTable : uint8_t
+{
+    ODM = 0, // dlms_on_demand_request
+    PING,    // dlms_on_demand_ping_request
+    COUNT
+};
+
+// Requests of one table moving to the same status and error code
+struct StatusBatch
+{
+    StatusTable table = StatusTable::ODM;
+    int status = 0;
+    uint16_t err_code = 0;
+    std::time_t at = 0; // latest transition in the batch
+    std::vector<unsigned int> request_ids;
+};
+
+/*
+ * Request status transitions waiting to be written. Only the latest status
+ * per request ID is kept, so IN_PROGRESS followed by SUCCESS inside one
+ * window costs nothing extra. take() groups what is pending by table,
+ * status and error code, one UPDATE per group however many requests it
+ * covers: a gateway disconnect or a mass cancel is a single statement.
+ */
+class StatusJournal
+{
+ public:
+    // True when the journal should be flushed now (window elapsed or full)
+    bool record(StatusTable table, unsigned int req_id, int status, uint16_t err_code);
+    bool due(void);
+    bool empty(void);
+    void set_window(int ms);
+
+    // Empties the journal, handing back its transitions grouped
+    std::vector<StatusBatch> take(void);
+
+    // Puts back transitions take() handed out that could not be written, newer ones recorded since win
+    void restore(const StatusBatch &batch, size_t first, size_t last);
+
+ private:
+    struct Pending
+    {
+        int status;
+        uint16_t err_code;
+        std::time_t at;
+    };
+
+    bool due_locked(std::chrono::steady_clock::time_point now) const;
+
+    std::mutex journal_mutex;
+    std::unordered_map<unsigned int, Pending> pending[static_cast<int>(StatusTable::COUNT)];
+    size_t pending_count = 0;
+    std::chrono::steady_clock::time_point oldest{}; // first transition since the last flush
+    std::chrono::milliseconds window{STATUS_JOURNAL_DEFAULT_WINDOW_MS};
+};
+
+#endif // __STATUS_JOURNAL_H__
@@ -5,6 +5,7 @@
 #include <stdint.h>
 
 #include <cstdio>
+#include <ctime>
 #include <fstream>
 #include <iostream>
 #include <mutex>
@@ -63,6 +64,23 @@ class Utility
     static std::once_flag configFlag;
 };
 
+/*
+ * Wall-clock source shared by logging, DB timestamps and cycle ids. Each
+ * thread runs localtime_r and formats "YYYY-mm-dd HH:MM:SS" once per second,
+ * later calls in the same second only patch the millisecond digits. The
+ * returned strings live in a thread-local buffer and stay valid until the
+ * next call on the same thread.
+ */
+class WallClock
+{
+ public:
+    static std::time_t seconds(void);
+    static std::tm local_tm(std::time_t t);
+    static const char *now(int *millisec = nullptr); // YYYY-mm-dd HH:MM:SS
+    static const char *now_ms(void);                 // YYYY-mm-dd HH:MM:SS.mmm
+    static const char *time_ms(void);                // HH:MM:SS.mmm
+};
+
 class TimeUtility
 {
  protected:
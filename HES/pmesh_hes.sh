@@ -21,6 +21,23 @@ if [ "$#" -eq 1 ]; then
                     ;;
             esac
             ;;
+        reload)
+            # Hot restart: the new instance takes the gateway sockets over from the running one
+            log_dir="Master_Logs"
+            logfile="$log_dir/$(date +%d%m%Y_%H%M).txt"
+            mkdir -p "$log_dir"
+            ulimit -n 16384
+            case "$(pidof $PROCESS_NAME | wc -w)" in
+                0)
+                    stdbuf -o0 ./$PROCESS_NAME >> "$logfile" &
+                    echo "Started"
+                    ;;
+                *)
+                    stdbuf -o0 ./$PROCESS_NAME --takeover >> "$logfile" &
+                    echo "Reloading"
+                    ;;
+            esac
+            ;;
         stop)
             killall "$PROCESS_NAME"
             echo "Stopped"
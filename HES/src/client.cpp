@@ -1,10 +1,60 @@
 #include "../inc/client.h"
 #include "../inc/String_functions.h"
+#include "../inc/coverage_index.h"
+#include "../inc/hot_restart.h"
+#include "../inc/init_admission.h"
+#include "../inc/metrics.h"
+#include "../inc/nms_lease.h"
 #include "../inc/utility.h"
 #include <algorithm>
 #include <vector>
 
 static std::string obis_to_string(const unsigned char *obis);
+
+// The ODM ring's cache line aligned indexes make Client over-aligned
+static constexpr size_t CLIENT_SLAB_ALIGN = std::max(alignof(Client), alignof(std::max_align_t));
+static_assert(CLIENT_SLAB_ALIGN % alignof(Client) == 0, "session pool blocks must be aligned for Client");
+
+SlabPool &Client::session_pool(void)
+{
+    // Never destroyed: detached gateway threads may still release their session during exit
+    static SlabPool *pool = new SlabPool(sizeof(Client), CLIENT_SLAB_OBJECTS, CLIENT_SLAB_ALIGN);
+    return *pool;
+}
+
+void *Client::operator new(size_t size)
+{
+    if (void *ptr = session_pool().allocate(size))
+        return ptr;
+    return ::operator new(size);
+}
+
+void *Client::operator new(size_t size, std::align_val_t align)
+{
+    if (static_cast<size_t>(align) <= session_pool().alignment())
+    {
+        if (void *ptr = session_pool().allocate(size))
+            return ptr;
+    }
+    return ::operator new(size, align);
+}
+
+void Client::operator delete(void *ptr, size_t size)
+{
+    if (session_pool().fits(size))
+        session_pool().release(ptr);
+    else
+        ::operator delete(ptr);
+}
+
+void Client::operator delete(void *ptr, size_t size, std::align_val_t align)
+{
+    if (static_cast<size_t>(align) <= session_pool().alignment() && session_pool().fits(size))
+        session_pool().release(ptr);
+    else
+        ::operator delete(ptr, align);
+}
+
 Client::Client()
 {
     std::cout << "Client constructor called" << std::endl;
@@ -13,26 +63,50 @@ Client::Client()
     this->stateInfo.timeoutState = ClientTimeoutState::TIMER_PGWID_RX;
     this->stateInfo.currentState = ClientCurrentState::IDLE;
 
-    //==============================Added by LHK=====================//
-    db = std::make_unique<MySqlDatabase>();
-    fuota = std::make_unique<Fuota>(*this, *db);
-    print_and_log("Client ctor end, fuota=%p\n", fuota.get());
+    this->on_status_flushed = [this](const std::vector<StatusBatch> &batches) { this->report_status_batches(batches); };
 }
 
 Client::~Client()
 {
     std::cout << "Client destructor called" << std::endl;
 
+    // The journal outlives this object, whatever it still holds is written without publishing
+    this->on_status_flushed = nullptr;
+
     if (this->client_socket != -1)
     {
         shutdown(this->get_client_socket(), SHUT_RDWR);
         close(this->get_client_socket());
     }
+
+    if (this->nms_lease_fd != -1)
+    {
+        close(this->nms_lease_fd);
+    }
+}
+
+MySqlDatabase &Client::fuota_db(void)
+{
+    if (!this->db)
+        this->db = std::make_unique<MySqlDatabase>();
+    return *this->db;
+}
+
+//==============================Added by LHK=====================//
+Fuota &Client::fuota_session(void)
+{
+    if (!this->fuota)
+    {
+        this->fuota = std::make_unique<Fuota>(*this, this->fuota_db());
+        this->print_and_log("(%s) FUOTA session created, fuota=%p\n", this->gateway_id, this->fuota.get());
+    }
+    return *this->fuota;
 }
 
 void Client::set_client_socket(int client_socket)
 {
     this->client_socket = client_socket;
+    this->gateway_io.attach(client_socket);
 }
 
 int Client::get_client_socket(void)
@@ -99,11 +173,7 @@ void Client::unregister_client(char *gateway_id, Client *current_client)
 
 int Client::set_recv_timeout_for_client(uint32_t time_in_sec)
 {
-    timeval timeout;
-    timeout.tv_sec = time_in_sec;
-    timeout.tv_usec = 0;
-
-    if (setsockopt(this->get_client_socket(), SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) < 0)
+    if (this->gateway_io.set_recv_timeout(time_in_sec) < 0)
     {
         this->print_and_log("Failed to set recv timeout.\n");
         return FAILURE;
@@ -122,7 +192,7 @@ ssize_t Client::receive_data(uint8_t *buff, size_t buffSize)
 {
     this->print_and_log("%s start\n", __FUNCTION__);
 
-    ssize_t receivedBytes = recv(this->get_client_socket(), buff, buffSize, 0);
+    ssize_t receivedBytes = this->gateway_io.recv(buff, buffSize);
 
     if (!memcmp(buff, "PING", 4))
     {
@@ -267,33 +337,8 @@ int Client::initCommunication(uint8_t *buffer, ssize_t length)
         int val1, val2, val3;
         sscanf((char *)buffer, "%s %d %d %d", str, &val1, &val2, &val3);
 
-        memcpy(this->gateway_id, &str[6], 16);
-        memcpy(this->Source_ID, &str[14], 8);
-        this->Source_ID[8] = '\0';
-        memcpy(this->PAN_ID, &str[18], 4);
-        this->PAN_ID[4] = '\0';
-        memcpy(this->pgwid, str, 64);
-        this->pgwid[64] = '\0';
-
-        this->val1 = val1;
-        this->val2 = val2;
-        this->val3 = val3;
-
-        this->gatewayIdStr = std::string(this->gateway_id); // Store GATEWAY ID as std::string for MQTT client ID/topic(added by Amith KN)
-
-        this->print_and_log("gateway_id = %s\n", this->gateway_id);
-        this->print_and_log("val1 = %d\n", val1);
-        this->print_and_log("val2 = %d\n", val2);
-        this->print_and_log("val3 = %d\n", val3);
-
-        if (this->gatewayid_logging_enabled)
-        {
-            this->create_gateway_log_file();
-        }
-        this->register_client(this->gateway_id, this); // Add gateway info to Server::g_clients
-        this->load_mysql_config_from_file();           // Read from file and connect to MySQL server
-        this->init_connection(val1, val2, val3);       // initial pull function
-        this->create_mqtt_client();                    // Read from file and connect to broker
+        this->apply_pgwid(str, val1, val2, val3);
+        this->start_session(false);
 
         this->stateInfo.currentState = ClientCurrentState::IDLE;
         this->stateInfo.timeoutState = ClientTimeoutState::TIMER_NONE;
@@ -307,6 +352,178 @@ int Client::initCommunication(uint8_t *buffer, ssize_t length)
     return SUCCESS;
 }
 
+void Client::apply_pgwid(const char *str, int val1, int val2, int val3)
+{
+    memcpy(this->gateway_id, &str[6], 16);
+    memcpy(this->Source_ID, &str[14], 8);
+    this->Source_ID[8] = '\0';
+    memcpy(this->PAN_ID, &str[18], 4);
+    this->PAN_ID[4] = '\0';
+    strncpy(this->pgwid, str, 64);
+    this->pgwid[64] = '\0';
+
+    this->val1 = val1;
+    this->val2 = val2;
+    this->val3 = val3;
+
+    this->gatewayIdStr = std::string(this->gateway_id); // Store GATEWAY ID as std::string for MQTT client ID/topic(added by Amith KN)
+
+    this->print_and_log("gateway_id = %s\n", this->gateway_id);
+    this->print_and_log("val1 = %d\n", val1);
+    this->print_and_log("val2 = %d\n", val2);
+    this->print_and_log("val3 = %d\n", val3);
+}
+
+// A resumed session was initialised by the process it was handed over from, init_connection is skipped
+void Client::start_session(bool resumed)
+{
+    if (this->gatewayid_logging_enabled)
+    {
+        this->create_gateway_log_file();
+    }
+    this->register_client(this->gateway_id, this);       // Add gateway info to Server::g_clients
+    this->gateway_metrics.bind(this->gateway_id);        // Per-gateway metric series
+    this->load_mysql_config_from_file();                 // Read from file and connect to MySQL server
+    this->load_coverage_index_from_db(this->gateway_id); // Seed profile coverage once per gateway
+    this->load_event_code_dictionary();                  // Shared event-code table, loaded once
+    this->detect_ping_summary_schema();                  // Shared, checked once
+    if (!resumed)
+        this->admit_and_init_connection();
+    this->create_mqtt_client(); // Read from file and connect to broker
+}
+
+/*
+ * A reconnect shortly after a clean session only records the connection and
+ * reloads the paths; anything else waits its turn for the full
+ * init_connection so a reconnect storm does not run them all at once.
+ */
+void Client::admit_and_init_connection(void)
+{
+    InitAdmission &admission = InitAdmission::instance();
+
+    if (admission.init_still_valid(this->gateway_id))
+    {
+        this->print_and_log("[ADMISSION] %s init still valid, fast path\n", this->gateway_id);
+        this->record_gateway_connection(this->val1, this->val2, this->val3);
+        if (fetch_path_record_from_src_route_network_db(this->gateway_id) == FAILURE)
+        {
+            this->print_and_log("Failed to fetch path record from src route network db\n");
+        }
+        return;
+    }
+
+    auto queued_at = std::chrono::steady_clock::now();
+    bool admitted = admission.acquire(this->gateway_id, [this]() {
+        // Hung up while queued, or a successor process is taking over: no init for this session
+        pollfd pfd{this->get_client_socket(), POLLRDHUP, 0};
+        if (::poll(&pfd, 1, 0) > 0 && (pfd.revents & (POLLRDHUP | POLLHUP | POLLERR | POLLNVAL)))
+            return true;
+        return HotRestart::instance().handoff_pending();
+    });
+    long long waited_ms = static_cast<long long>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - queued_at).count());
+
+    if (!admitted)
+    {
+        this->print_and_log("[ADMISSION] %s left the queue after %lld ms, gateway gone or hot restart\n", this->gateway_id, waited_ms);
+        this->gatewayStatus = Status::DISCONNECTED;
+        return;
+    }
+    this->print_and_log("[ADMISSION] %s admitted after %lld ms\n", this->gateway_id, waited_ms);
+
+    int ret = this->init_connection(this->val1, this->val2, this->val3); // initial pull function
+    admission.release(this->gateway_id, ret == SUCCESS && this->gatewayStatus == Status::CONNECTED);
+}
+
+// Whether the next session of this gateway may skip init_connection
+bool Client::init_reusable(void) const
+{
+    return !this->fuota || this->fuota->ondemand_fuota_state == FUOTA_STATE::IDLE;
+}
+
+/*
+ * What a successor process needs to carry on with this gateway without it
+ * reconnecting: the PGWID line, the timer state and the HES cycle progress.
+ */
+nlohmann::json Client::session_snapshot(void) const
+{
+    return {{"pgwid", this->pgwid},
+            {"val1", this->val1},
+            {"val2", this->val2},
+            {"val3", this->val3},
+            {"init_done", !this->comm_init_status},
+            {"target_state", this->stateInfo.targetState},
+            {"current_state", this->stateInfo.currentState},
+            {"timeout_state", this->stateInfo.timeoutState},
+            {"polltimeout", this->polltimeout},
+            {"current_ip_cycle", this->current_ip_cycle},
+            {"hes_cycle", {{"last_hour", this->hes_state.last_hour}, {"cycle_id", this->hes_state.current_cycle_id}, {"done_mask", this->hes_state.done_mask}}},
+            {"rx_pending", this->bytes_to_hex_string(this->gateway_io.pending().data(), this->gateway_io.pending().size())}};
+}
+
+bool Client::resume_session(const nlohmann::json &snapshot)
+{
+    std::string pgwid = snapshot.value("pgwid", "");
+    if (pgwid.size() < 22 || pgwid.compare(0, 8, "PGWID:3C") != 0 || !snapshot.value("init_done", false))
+    {
+        this->print_and_log("[HOT RESTART] ❌ unusable session snapshot: %s\n", snapshot.dump().c_str());
+        return false;
+    }
+
+    this->comm_init_status = false;
+    this->apply_pgwid(pgwid.c_str(), snapshot.value("val1", 0), snapshot.value("val2", 0), snapshot.value("val3", 0));
+    this->start_session(true);
+
+    this->stateInfo.targetState = snapshot.value("target_state", static_cast<uint8_t>(ClientTargetState::IDLE));
+    this->stateInfo.currentState = snapshot.value("current_state", static_cast<uint8_t>(ClientCurrentState::IDLE));
+    this->stateInfo.timeoutState = snapshot.value("timeout_state", static_cast<uint8_t>(ClientTimeoutState::TIMER_NONE));
+    this->polltimeout = snapshot.value("polltimeout", 0);
+    this->current_ip_cycle = snapshot.value("current_ip_cycle", -1);
+
+    const nlohmann::json &cycle = snapshot.value("hes_cycle", nlohmann::json::object());
+    this->hes_state.last_hour = cycle.value("last_hour", -1);
+    this->hes_state.current_cycle_id = cycle.value("cycle_id", -1);
+    this->hes_state.done_mask = cycle.value("done_mask", 0);
+
+    // Received by the previous process after its last read, handed out before the socket is read
+    std::string rx_pending = snapshot.value("rx_pending", "");
+    for (size_t i = 0; i + 1 < rx_pending.size(); i += 2)
+    {
+        unsigned int byte = 0;
+        if (sscanf(rx_pending.c_str() + i, "%2x", &byte) != 1)
+            break;
+        uint8_t b = static_cast<uint8_t>(byte);
+        this->gateway_io.preload(&b, 1);
+    }
+
+    this->print_and_log("[HOT RESTART] ✅ session resumed for %s\n", this->gateway_id);
+    return true;
+}
+
+// Idle between exchanges: nothing on the air, queued or in FUOTA, so the socket can change process
+bool Client::ready_for_handoff(void)
+{
+    if (this->comm_init_status || this->gatewayStatus != Status::CONNECTED)
+        return false;
+
+    this->drain_odm_ring();
+    if (!this->odm_exchanges.empty() || !this->odm_schedule.empty())
+        return false;
+
+    if (this->fuota && this->fuota->ondemand_fuota_state != FUOTA_STATE::IDLE)
+        return false;
+
+    return this->check_rf_fuota_queue_empty();
+}
+
+// The socket now belongs to the caller, the destructor leaves it open
+int Client::release_client_socket(void)
+{
+    this->gateway_io.detach(); // bytes already read ahead stay in pending() for the snapshot
+    int fd = this->client_socket;
+    this->client_socket = -1;
+    return fd;
+}
+
 void Client::create_mqtt_client(void)
 {
     this->print_and_log("%s start\n", __FUNCTION__);
@@ -991,7 +1208,7 @@ void Client::poll_timeout_handler(void)
             break;
         }
         case ClientTimeoutState::TIMER_FUOTA_RESPONSE: {
-            if (!fuota->waiting_for_response)
+            if (!fuota || !fuota->waiting_for_response)
             {
                 this->print_and_log("(%s) FUOTA timeout: no pending FUOTA request (waiting_for_response==false) — nothing to retry.\n", this->gateway_id);
                 break;
@@ -1062,51 +1279,16 @@ void Client::poll_timeout_handler(void)
 
 void Client::client_get_time(std::string &time_str, int format_type)
 {
-    using namespace std::chrono;
-
-    // Get current system time with milliseconds
-    auto now = system_clock::now();
-    auto ms = duration_cast<milliseconds>(now.time_since_epoch()) % 1000;
-
-    std::time_t t = system_clock::to_time_t(now);
-    std::tm tm;
-#ifdef _WIN32
-    localtime_s(&tm, &t);
-#else
-    localtime_r(&t, &tm);
-#endif
-
-    std::ostringstream oss;
-
-    if (format_type == 1)
-    {
-        // HH:MM:SS.mmm
-        oss << std::setw(2) << std::setfill('0') << tm.tm_hour << ":"
-            << std::setw(2) << std::setfill('0') << tm.tm_min << ":"
-            << std::setw(2) << std::setfill('0') << tm.tm_sec << "."
-            << std::setw(3) << std::setfill('0') << ms.count();
-    }
-    else if (format_type == 2)
+    if (format_type == 2)
     {
         // YYYY-MM-DD HH:MM:SS.mmm
-        oss << (tm.tm_year + 1900) << "-"
-            << std::setw(2) << std::setfill('0') << (tm.tm_mon + 1) << "-"
-            << std::setw(2) << std::setfill('0') << tm.tm_mday << " "
-            << std::setw(2) << std::setfill('0') << tm.tm_hour << ":"
-            << std::setw(2) << std::setfill('0') << tm.tm_min << ":"
-            << std::setw(2) << std::setfill('0') << tm.tm_sec << "."
-            << std::setw(3) << std::setfill('0') << ms.count();
+        time_str.assign(WallClock::now_ms());
     }
     else
     {
-        // Default HH:MM:SS.mmm
-        oss << std::setw(2) << std::setfill('0') << tm.tm_hour << ":"
-            << std::setw(2) << std::setfill('0') << tm.tm_min << ":"
-            << std::setw(2) << std::setfill('0') << tm.tm_sec << "."
-            << std::setw(3) << std::setfill('0') << ms.count();
+        // HH:MM:SS.mmm (format 1 and default)
+        time_str.assign(WallClock::time_ms());
     }
-
-    time_str = oss.str();
 }
 
 int Client::write_to_client(uint8_t *buf, size_t length)
@@ -1119,7 +1301,7 @@ int Client::write_to_client(uint8_t *buf, size_t length)
 
     while (total_written < length)
     {
-        ssize_t written = send(this->client_socket, buf + total_written, length - total_written, 0);
+        ssize_t written = this->gateway_io.send(buf + total_written, length - total_written);
 
         this->client_get_time(this->time_str, 2); // Get current time in HH:MM:SS.mmm format
         this->print_and_log("[%s] TX: %s : %d =", this->time_str.c_str(), this->gateway_id, length);
@@ -1172,24 +1354,21 @@ void Client::process_ondemand_request(void)
     // Log function entry for debugging/tracing.
     this->print_and_log("%s start\n", __FUNCTION__);
 
-    auto now = std::chrono::system_clock::now();
-    const auto timeout = std::chrono::minutes(2);
-    // check for nms activity
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::minutes(2);
+    // check for nms activity, woken by the lease watcher as soon as NMS releases the gateway
     while (insert_update_hes_nms_sync_time(this->gateway_id, 1) != SUCCESS)
     {
-        this->receive_data_and_validate_response();
-        auto current = std::chrono::system_clock::now();
-        if (current - now > timeout)
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+        if (remaining.count() <= 0 || this->gatewayStatus == DISCONNECTED)
             break;
-        sleep(30); // sleep for 30secs
+        this->wait_for_nms_release(static_cast<int>(remaining.count()));
     }
 
     // Output current GATEWAY ID, data length, and data for context.
     this->print_and_log("Processing On-Demand request for GATEWAY ID: \n");
     // Wait for eventfd signal (from validate_request_ids or queue enqueuing event).
-    eventfd_t u;
-    eventfd_read(this->pfd[1].fd, &u); // pfd[1] is assumed ODM eventfd
-    this->pfd[1].revents = 0;          // Clear pollfd event state
+    this->ack_ondemand_signal(); // pfd[1] is the ODM eventfd
+    this->pfd[1].revents = 0;    // Clear pollfd event state
 
     // ================= TOP PRIORITY : CANCELLED REQUESTS =================
     while (true)
@@ -1206,171 +1385,838 @@ void Client::process_ondemand_request(void)
             this->cancelled_requests.pop();                                 // Remove from queue
         }
 
-        this->print_and_log("[❌CANCELLED]: REQ_ID=%d updated in DB\n", cancelled_req_id);
-        // Update DB immediately for cancelled request
-        this->Update_dlms_on_demand_request_status(cancelled_req_id, CANCELLED, 0);
+        this->print_and_log("[❌CANCELLED]: REQ_ID=%d updated in DB\n", cancelled_req_id);
+        // Update DB immediately for cancelled request
+        this->Update_dlms_on_demand_request_status(cancelled_req_id, CANCELLED, 0);
+    }
+
+    // 1. Process all failed commands (highest priority)
+    auto report_failed = [this](const FailedCommand &failed) {
+        // Debug log
+        this->print_and_log("[❌FAILED]: REQ_ID=%d \n", failed.request_id);
+        if (failed.download_data_type == PING_NODE || failed.download_data_type == PING_METER)
+            this->Update_dlms_on_demand_Ping_request_status(failed.request_id, FAILED_INVALID_REQUEST);
+        else
+            this->Update_dlms_on_demand_request_status(failed.request_id, FAILED_INVALID_REQUEST, 0); // Update status to failed in DB
+    };
+
+    while (FailedCommand *failed = this->Failed.front())
+    {
+        report_failed(*failed);
+        this->Failed.pop();
+    }
+
+    std::deque<FailedCommand> failed_overflow;
+    if (this->take_failed_overflow(failed_overflow))
+    {
+        for (const FailedCommand &failed : failed_overflow)
+            report_failed(failed);
+    }
+
+    // 2. Process all FUOTA commands, the FUOTA session is only built once there is one
+    if (this->fuota || !this->check_rf_fuota_queue_empty())
+        this->fuota_session().process_fuota_queue();
+
+    // 3. Process all ODM commands, urgent class first and earliest deadline first within a class,
+    //    up to odm_pipeline_depth requests and ping_parallel ping series on the air at once to distinct meters
+    size_t depth = ODM_PIPELINE_DEFAULT_DEPTH;
+    try
+    {
+        depth = static_cast<size_t>(std::clamp(Utility::readConfig<int>("HES.odm_pipeline_depth"), 1, ODM_PIPELINE_MAX_DEPTH));
+    }
+    catch (const std::exception &e)
+    {
+        this->print_and_log("HES.odm_pipeline_depth not set, using %zu\n", depth);
+    }
+
+    size_t ping_depth = PING_SERIES_DEFAULT_PARALLEL;
+    try
+    {
+        ping_depth = static_cast<size_t>(std::clamp(Utility::readConfig<int>("HES.ping_parallel"), 1, PING_SERIES_MAX_PARALLEL));
+    }
+    catch (const std::exception &e)
+    {
+        this->print_and_log("HES.ping_parallel not set, using %zu\n", ping_depth);
+    }
+
+    bool cancel_pending = false;
+    while (true)
+    {
+        // Hot restart gave up waiting for this gateway to go idle: what is queued or on the air ends as on a disconnect
+        if (HotRestart::instance().abandoning())
+        {
+            this->gatewayStatus = DISCONNECTED;
+            break;
+        }
+
+        // Commands queued meanwhile are ranked before picking the next one
+        this->drain_odm_ring();
+        if (this->odm_schedule.empty() && this->odm_exchanges.empty())
+            break;
+
+        this->print_and_log("[QUEUE SIZE] ODM = %zu | IN FLIGHT = %zu\n", this->odm_schedule.size(), this->odm_exchanges.size());
+        this->gateway_metrics.set(this->gateway_metrics.odm_queue_depth, static_cast<int64_t>(this->odm_schedule.size()));
+        // 🔥 PRIORITY CHECK: nothing new goes out, the requests on the air are seen through
+        if (!cancel_pending && has_pending_cancel())
+        {
+            this->print_and_log("⏹️ [ODM] 🔄 INTERRUPTING ODM | Processing CANCEL request\n");
+            cancel_pending = true;
+        }
+        if (cancel_pending && this->odm_exchanges.empty())
+            break; // Exit ODM immediately
+
+        if (!cancel_pending)
+        {
+            this->gateway_io.cork(); // the frames started here go out with the wait in service_odm_exchanges
+            this->start_odm_exchanges(depth, ping_depth);
+        }
+
+        if (this->gatewayStatus == DISCONNECTED)
+            break;
+
+        if (!this->odm_exchanges.empty())
+            this->service_odm_exchanges();
+        this->gateway_io.uncork();
+
+        this->flush_status_journal_if_due();
+
+        if (this->gatewayStatus == DISCONNECTED)
+            break;
+    }
+
+    // Requests still on the air when the gateway went away
+    for (OdmExchange &ex : this->odm_exchanges)
+    {
+        this->print_and_log("[❌ODM] Gateway disconnected - [RequestID] = %d\n", ex.cmd->request_id);
+        if (ex.ping)
+            this->Update_dlms_on_demand_Ping_request_status(ex.cmd->request_id, GW_DISCONNECTED);
+        else
+            this->Update_dlms_on_demand_request_status(ex.cmd->request_id, GW_DISCONNECTED, 0);
+    }
+    this->odm_exchanges.clear();
+    this->flush_status_journal();
+    this->publish_odm_results();
+    this->odm_result_values.clear();
+    this->gateway_metrics.set(this->gateway_metrics.odm_queue_depth, static_cast<int64_t>(this->odm_schedule.size() + this->ODM.size()));
+    ODM_Flag = 0; // Reset the flag after completion of ODM
+    this->print_and_log("[ODM Flag] =%d\n", ODM_Flag);
+    insert_update_hes_nms_sync_time(this->gateway_id, 0);
+}
+
+/*
+ * Moves the commands the mosquitto thread pushed into the ODM ring into the
+ * schedule. A command pushed out of a full schedule is rejected here with
+ * FAILED_INVALID_REQUEST, the same status a full ODM ring gives.
+ */
+void Client::drain_odm_ring(void)
+{
+    while (QueuedCommand *queued = this->ODM.front())
+    {
+        bool ping = queued->download_data_type == PING_NODE || queued->download_data_type == PING_METER;
+        int deadline = ping ? 0 : queued->number(DEADLINE, 0); // slot 7 of a ping is PING_INTERVAL, not a deadline
+        std::unique_ptr<QueuedCommand> rejected = this->odm_schedule.admit(*queued, deadline);
+        this->ODM.pop();
+
+        if (!rejected || this->take_cancelled(rejected->request_id))
+            continue;
+
+        this->print_and_log("❌ ODM schedule full (%d) → REJECTED | REQ_ID=%d | class=%d\n", ODM_SCHEDULE_CAPACITY, rejected->request_id,
+                            static_cast<int>(OdmScheduler::priority_of(rejected->download_data_type)));
+        if (rejected->download_data_type == PING_NODE || rejected->download_data_type == PING_METER)
+            this->Update_dlms_on_demand_Ping_request_status(rejected->request_id, FAILED_INVALID_REQUEST);
+        else
+            this->Update_dlms_on_demand_request_status(rejected->request_id, FAILED_INVALID_REQUEST, 0);
+    }
+}
+
+/*
+ * Steps every dequeued ODM command goes through before anything is sent.
+ * Returns false when the command is already settled (answered by a
+ * coalesced read, cancelled, bad route or served from the profile cache).
+ */
+bool Client::prepare_odm_command(QueuedCommand &cmd)
+{
+    // Request ID taken from the fields parsed at enqueue time
+    int request_id = cmd.request_id;
+
+    // Answered from an identical read that went over RF before it
+    if (cmd.answered)
+        return false;
+
+    if (this->take_cancelled(request_id))
+        return false;
+    this->client_get_time(this->time_str, 2);
+
+    this->gateway_metrics.observe_since(this->gateway_metrics.odm_wait, cmd.enqueued_at);
+
+    // Log the current device ID, length of on-demand data, and the data itself (context info)
+    this->print_and_log("[%s] [ODM START] : gateway_ID = %s | REQ_ID = %d | data = %s\n", this->time_str.c_str(), this->gateway_id, request_id, cmd.raw().c_str());
+
+    this->Update_dlms_on_demand_request_status(request_id, IN_PROGRESS, 0);
+
+    this->DB_parameter.req_id = request_id;
+    this->DB_parameter.gateway_id = cmd.field(GATEWAY_ID); // GATEWAY ID from parts[1]
+    // Path decoded at parse time, validated to hold at least the gateway entry
+    const uint8_t *meter_data = cmd.path;
+
+    // Last 8 bytes → MAC (as hex)
+    size_t mac_start = cmd.path_len - 8;
+    this->DB_parameter.meter_mac_address = this->bytes_to_hex_string(&meter_data[mac_start], 8);
+
+    // Last 4 bytes → Serial (as hex)
+    size_t serial_start = cmd.path_len - 4;
+    this->DB_parameter.meter_serial_no = this->bytes_to_hex_string(&meter_data[serial_start], 4);
+
+    // If hop count > 0, validate path in source route network
+    if (cmd.hop_count > 0)
+    {
+        // Check if path exists in source route network
+        if (!check_path_in_source_route_network(cmd, request_id))
+        {
+            Update_dlms_on_demand_request_status(request_id, FAILED_INVALID_REQUEST, 0);
+            return false; // Skip to next command
+        }
+    }
+
+    // Fresh enough data already stored for this meter, no RF exchange needed
+    if (cmd.download_data_type == DATA_TYPE_IP && this->answer_ip_from_cache(cmd))
+        return false;
+
+    return true;
+}
+
+// Address the meter answers from: the last hop, or the node itself when hop count is 0
+static const uint8_t *odm_target_of(const QueuedCommand &cmd)
+{
+    return (cmd.hop_count == 0) ? cmd.path + 4 : cmd.path + cmd.path_len - 4;
+}
+
+static std::chrono::seconds odm_response_timeout(int download_data_type)
+{
+    // ALL TAMPER EVENTS PROFILE takes longer to answer
+    return std::chrono::seconds((download_data_type == 0x05) ? 20 : 12);
+}
+
+// Statuses the NMS acts on; the intermediate ones are only written to the DB
+static bool is_final_status(int status)
+{
+    switch (status)
+    {
+    case REQUESTED:
+    case REQUEST_QUEUED:
+    case IN_PROGRESS:
+    case RETRY_IN_PROGRESS:
+        return false;
+    default:
+        return true;
+    }
+}
+
+/*
+ * Called once the journal has written a batch of transitions: every request
+ * that reached a final status goes out on the ONDEMAND_RESPONSE topic, with
+ * its decoded values when the read left any behind.
+ */
+void Client::report_status_batches(const std::vector<StatusBatch> &batches)
+{
+    for (const StatusBatch &batch : batches)
+    {
+        if (!is_final_status(batch.status))
+            continue;
+
+        for (unsigned int req_id : batch.request_ids)
+        {
+            auto it = this->odm_result_values.find(req_id);
+            if (it == this->odm_result_values.end())
+            {
+                this->add_odm_result(batch.table == StatusTable::PING, req_id, batch.status, batch.err_code, nlohmann::json());
+                continue;
+            }
+
+            this->add_odm_result(batch.table == StatusTable::PING, req_id, batch.status, batch.err_code, it->second);
+            this->odm_result_values.erase(it);
+        }
+    }
+
+    this->publish_odm_results();
+}
+
+bool Client::odm_target_busy(const QueuedCommand &cmd) const
+{
+    const uint8_t *target = odm_target_of(cmd);
+    for (const OdmExchange &ex : this->odm_exchanges)
+    {
+        if (memcmp(ex.target, target, sizeof(ex.target)) == 0)
+            return true;
+    }
+    return false;
+}
+
+/*
+ * Puts commands on the air until depth requests and ping_depth ping series
+ * are in flight. A command whose meter already has something in flight waits
+ * its turn without holding back the commands behind it.
+ */
+void Client::start_odm_exchanges(size_t depth, size_t ping_depth)
+{
+    size_t requests = 0;
+    size_t pings = 0;
+    for (const OdmExchange &ex : this->odm_exchanges)
+        (ex.ping ? pings : requests)++;
+
+    while ((requests < depth || pings < ping_depth) && this->gatewayStatus != DISCONNECTED)
+    {
+        std::unique_ptr<QueuedCommand> next = this->odm_schedule.next_if([&](const QueuedCommand &queued) {
+            if (queued.answered)
+                return true;
+            if (queued.download_data_type == PING_NODE || queued.download_data_type == PING_METER)
+            {
+                if (pings >= ping_depth)
+                    return false;
+            }
+            else if (requests >= depth)
+                return false;
+            return !this->odm_target_busy(queued);
+        });
+        if (!next)
+            break;
+
+        if (!this->prepare_odm_command(*next))
+            continue;
+
+        if (next->download_data_type == PING_NODE || next->download_data_type == PING_METER)
+        {
+            this->start_ping_series(std::move(next));
+            pings++;
+            continue;
+        }
+
+        this->start_odm_exchange(std::move(next));
+        requests++;
+    }
+}
+
+void Client::start_odm_exchange(std::unique_ptr<QueuedCommand> cmd)
+{
+    OdmExchange ex;
+    ex.cmd = std::move(cmd);
+    uint8_t download_data_type = static_cast<uint8_t>(ex.cmd->download_data_type);
+
+    // --- Create PMESH packet using clean function ---
+    ex.frame = build_pmesh_frame(*ex.cmd);
+    ex.pmesh_header.assign(this->Pmesh_header.data(), this->Pmesh_header.size());
+    memcpy(ex.target, odm_target_of(*ex.cmd), sizeof(ex.target));
+
+    // What prepare_odm_command filled in belongs to this request from now on
+    ex.state.profiles.DB_parameter = this->DB_parameter;
+    this->DB_parameter = DBparameters();
+
+    this->print_and_log("%s start [RequestID]=%d [Download data_type]=%d\n", __FUNCTION__, ex.cmd->request_id, download_data_type);
+
+    // Send the initial ODM packet to the client
+    if (write_to_client(ex.frame.data(), ex.frame.size()) != SUCCESS)
+    {
+        // If send fails, log and drop the request
+        this->print_and_log("[❌ODM ERROR] Failed to send initial packet - RequestID: %d\n", ex.cmd->request_id);
+        return;
+    }
+    ex.expires_at = std::chrono::steady_clock::now() + odm_response_timeout(download_data_type);
+
+    size_t length = ex.frame.size();
+    if (length >= 5 && download_data_type > 0x0F)
+    {
+        ex.pp_write_payload_tail = (static_cast<uint32_t>(ex.frame[length - 5]) << 24) | (static_cast<uint32_t>(ex.frame[length - 4]) << 16) |
+                                   (static_cast<uint32_t>(ex.frame[length - 3]) << 8) | static_cast<uint32_t>(ex.frame[length - 2]);
+        this->print_and_log("[ODM DEBUG] Last 4 Write bytes : 0x%08X\n", ex.pp_write_payload_tail);
+    }
+
+    this->odm_exchanges.push_back(std::move(ex));
+}
+
+/*
+ * A ping series sends PING_COUNT pings (one for PING_METER) PING_INTERVAL
+ * seconds apart, one outstanding at a time, and writes a single summary row
+ * once the last one is answered or lost.
+ */
+void Client::start_ping_series(std::unique_ptr<QueuedCommand> cmd)
+{
+    OdmExchange ex;
+    ex.ping = true;
+    ex.ping_failure = FAILED_NO_GW_RESPONSE;
+    ex.cmd = std::move(cmd);
+
+    if (ex.cmd->download_data_type == PING_NODE)
+    {
+        // PING_NODE command data of parts[5] is sent as is
+        ex.frame.assign(ex.cmd->payload, ex.cmd->payload_len);
+        ex.pings_left = static_cast<uint8_t>(std::max(1, ex.cmd->number(PING_COUNT, 1)));
+        ex.ping_interval = std::chrono::seconds(std::max(0, ex.cmd->number(PING_INTERVAL, 0)));
+    }
+    else
+    {
+        ex.frame = build_pmesh_frame(*ex.cmd);
+        ex.pings_left = 1;
+    }
+
+    // Answers come from the frame's own destination
+    this->need_to_validate_src_addr = false;
+    this->get_destination_address(ex.frame.data());
+    memcpy(ex.target, this->need_to_validate_src_addr ? this->src_addr_check_buffer : odm_target_of(*ex.cmd), sizeof(ex.target));
+
+    ex.state.profiles.DB_parameter = this->DB_parameter;
+    this->DB_parameter = DBparameters();
+
+    this->print_and_log("🔄 [PING] REQ_ID = %d | type = %d | count = %d | interval = %llds\n", ex.cmd->request_id, ex.cmd->download_data_type, ex.pings_left,
+                        static_cast<long long>(ex.ping_interval.count()));
+
+    // A failed send leaves the gateway disconnected, the series is then reported with the others in flight
+    this->send_ping(ex);
+    this->odm_exchanges.push_back(std::move(ex));
+}
+
+bool Client::send_ping(OdmExchange &ex)
+{
+    auto now = std::chrono::steady_clock::now();
+
+    if (write_to_client(ex.frame.data(), ex.frame.size()) != SUCCESS)
+    {
+        this->print_and_log("Failed to send ping for RequestID=%d .\n", ex.cmd->request_id);
+        return false;
+    }
+
+    ex.rtt.sent(now);
+    ex.pings_left--;
+    ex.expires_at = now + odm_response_timeout(ex.cmd->download_data_type);
+    return true;
+}
+
+// One result for a ping series: an answer or loss of the outstanding ping, or the end of the gap before the next
+bool Client::advance_ping_series(OdmExchange &ex, int ret)
+{
+    int request_id = ex.cmd->request_id;
+    auto now = std::chrono::steady_clock::now();
+
+    if (!ex.rtt.outstanding())
+    {
+        if (ret != POLL_TIMEOUT)
+            return false; // late answer to a ping already counted lost
+        if (this->send_ping(ex))
+            return false;
+
+        // The series ends here: summarise the pings already sent, the gateway is gone if none was answered
+        ex.ping_failure = GW_DISCONNECTED;
+        this->update_ping_summary(ex);
+        return true;
+    }
+
+    switch (ret)
+    {
+        case SUCCESS:
+        case DLMS_ERROR: // the meter answered, with an error
+            this->print_and_log("[✅ PING] REQ_ID = %d | RTT = %u ms\n", request_id, ex.rtt.answered(now));
+            break;
+        case POLL_TIMEOUT:
+            this->print_and_log("[⏰ PING LOST] REQ_ID = %d\n", request_id);
+            ex.rtt.lost();
+            ex.ping_failure = FAILED_NO_GW_RESPONSE;
+            break;
+        case TIMEOUT_RECEIVED:
+            this->print_and_log("[⏰ PING LOST] REQ_ID = %d | RF timeout\n", request_id);
+            ex.rtt.lost();
+            ex.ping_failure = FAILED_RF_TIMEOUT;
+            break;
+        case PMESH_ERROR:
+        case FAILED_PMESH_ERROR:
+            this->print_and_log("[❌ PING LOST] REQ_ID = %d | PMESH error\n", request_id);
+            ex.rtt.lost();
+            ex.ping_failure = FAILED_PMESH_ERROR;
+            break;
+        case DLMS_CONNECTION_FAILED:
+            this->print_and_log("[❌ PING LOST] REQ_ID = %d | DLMS connection failed\n", request_id);
+            ex.rtt.lost();
+            ex.ping_failure = DLMS_FAILED;
+            break;
+        default:
+            return false; // not an answer to this ping, keep waiting
+    }
+
+    if (ex.pings_left == 0)
+    {
+        this->update_ping_summary(ex);
+        return true;
+    }
+
+    ex.expires_at = now + ex.ping_interval;
+    return false;
+}
+
+/*
+ * Waits for the next batch of frames or the earliest expiry among the
+ * requests in flight. Each frame goes to the request whose meter sent it;
+ * anything else (push data, strays) is handled as outside an ODM cycle.
+ */
+void Client::service_odm_exchanges(void)
+{
+    auto now = std::chrono::steady_clock::now();
+    auto earliest = this->odm_exchanges.front().expires_at;
+    for (const OdmExchange &ex : this->odm_exchanges)
+        earliest = std::min(earliest, ex.expires_at);
+
+    int timeout_ms = static_cast<int>(std::max<int64_t>(0, std::chrono::duration_cast<std::chrono::milliseconds>(earliest - now).count()));
+
+    pollfd fd;
+    fd.fd = this->get_client_socket();
+    fd.events = POLLIN;
+    fd.revents = 0;
+
+    if (this->gateway_io.poll(&fd, 1, timeout_ms) > 0)
+    {
+        uint8_t buffer[4096] = {0};
+        ssize_t rxLen = this->receive_data(buffer, sizeof(buffer));
+
+        if (rxLen > 0)
+        {
+            for (OdmExchange &ex : this->odm_exchanges)
+                ex.gateway_heard = true;
+        }
+
+        ssize_t offset = 0;
+        uint8_t loop = 10;
+        while (rxLen > offset && this->gatewayStatus != DISCONNECTED)
+        {
+            int len = buffer[offset + 1] + 1;
+            uint8_t *frame = &buffer[offset];
+            offset += len;
+
+            if (loop-- == 0 || offset > rxLen)
+            {
+                this->print_and_log("[❌EXITING LOOP,WRONG RESPONSE]\n");
+                break;
+            }
+
+            const OtaAtCmdResponse *rx = reinterpret_cast<const OtaAtCmdResponse *>(frame);
+            auto it = this->odm_exchanges.begin();
+            while (it != this->odm_exchanges.end() && (len < static_cast<int>(sizeof(OtaAtCmdResponse)) || memcmp(rx->node_mac_address, it->target, sizeof(it->target)) != 0))
+                ++it;
+
+            if (it == this->odm_exchanges.end())
+            {
+                this->need_to_validate_src_addr = false;
+                this->client_received_data(frame, len);
+                continue;
+            }
+
+            this->swap_odm_exchange(*it, true);
+            int ret = this->client_received_data(frame, len);
+            bool done = this->advance_odm_exchange(*it, ret);
+            this->swap_odm_exchange(*it, false);
+
+            if (done)
+                this->finish_odm_exchange(it);
+            else if (!it->ping)
+                it->expires_at = std::chrono::steady_clock::now() + odm_response_timeout(it->cmd->download_data_type);
+        }
+    }
+
+    now = std::chrono::steady_clock::now();
+    for (auto it = this->odm_exchanges.begin(); it != this->odm_exchanges.end() && this->gatewayStatus != DISCONNECTED;)
+    {
+        auto current = it++;
+        if (current->expires_at > now)
+            continue;
+
+        this->swap_odm_exchange(*current, true);
+        bool done = this->advance_odm_exchange(*current, POLL_TIMEOUT);
+        this->swap_odm_exchange(*current, false);
+
+        if (done)
+            this->finish_odm_exchange(current);
+        else if (!current->ping)
+            current->expires_at = std::chrono::steady_clock::now() + odm_response_timeout(current->cmd->download_data_type);
+    }
+}
+
+/*
+ * Exchanges the per-request context with the Client members the response
+ * parsers work on. Called entering before handling a result and leaving
+ * after it, the second swap puts the Client's own values back.
+ */
+void Client::swap_odm_exchange(OdmExchange &ex, bool entering)
+{
+    std::swap(static_cast<ODMProfiles &>(*this), ex.state.profiles);
+    std::swap(this->name_plate, ex.state.name_plate);
+    std::swap(this->tx_page_index, ex.tx_page_index);
+    std::swap(this->pp_write_payload_tail, ex.pp_write_payload_tail);
+
+    if (entering)
+    {
+        this->odm_in_flight = ex.cmd.get();
+        memcpy(this->src_addr_check_buffer, ex.target, sizeof(ex.target));
+        this->need_to_validate_src_addr = true;
+    }
+    else
+    {
+        this->odm_in_flight = nullptr;
+        this->need_to_validate_src_addr = false;
+    }
+}
+
+/*
+ * Handles one result (a frame from the meter or POLL_TIMEOUT on expiry) for
+ * one request in flight, with retry counters kept per request. Returns true
+ * once the request is settled and can leave the pipeline.
+ */
+bool Client::advance_odm_exchange(OdmExchange &ex, int ret)
+{
+    if (ex.ping)
+        return this->advance_ping_series(ex, ret);
+
+    int request_id = ex.cmd->request_id;
+    uint8_t download_data_type = static_cast<uint8_t>(ex.cmd->download_data_type);
+    uint8_t *buf = ex.frame.data();
+    size_t length = ex.frame.size();
+
+    client_get_time(this->DB_parameter.last_download_time, 1);
+
+    // Every answer but DLMS_SUCCESS while reconnecting means another DLMS enable attempt
+    if (ex.reconnecting && ret != DLMS_SUCCESS)
+        return this->reconnect_odm_exchange(ex);
+
+    if (ret == SUCCESS)
+    {
+        ex.retry = 1;
+        this->print_and_log("[✅ SUCCESS] - RequestID: %d\n", request_id);
+        return handle_success(request_id, download_data_type, buf);
+    }
+    else if (ret == DLMS_SUCCESS)
+    {
+        this->print_and_log("[✅ DLMS_SUCCESS] - resending packet, [RequestID] = %d\n", request_id);
+        if (ex.reconnecting)
+        {
+            ex.reconnecting = false;
+            ex.retry = 1;
+        }
+        return !resend_packet(buf, length, request_id);
+    }
+    else if (ret == PMESH_ERROR)
+    {
+        this->Update_dlms_on_demand_request_status(request_id, FAILED_PMESH_ERROR, 0);
+        return true;
+    }
+    else if (ret == TIMEOUT_RECEIVED)
+    {
+        this->print_and_log("[⏰TIMEOUT_RECEIVED] - retrying, [RequestID] = %d || [RETRY COUNT] = %d\n", request_id, ex.retry);
+        if (ex.retry == 3)
+        {
+            this->Update_dlms_on_demand_request_status(request_id, FAILED_RF_TIMEOUT, 0);
+            this->print_and_log("ODM RequestID=%d || [RETRY COUNT] = %d, || [RETURN VALUE] = %d, failed with response code: %d\n", request_id, ex.retry, ret, FAILED_RF_TIMEOUT);
+            return true;
+        }
+        if (ex.once)
+        {
+            this->Update_dlms_on_demand_request_status(request_id, RETRY_IN_PROGRESS, 0);
+            ex.once = false;
+        }
+        ex.retry++;
+        return !resend_packet(buf, length, request_id);
+    }
+    else if (ret == DLMS_CONNECTION_FAILED)
+    {
+        this->print_and_log("[❌DLMS_CONNECTION_FAILED] - recovering, [RequestID] = %d\n", request_id);
+        if (ex.retry == 3)
+        {
+            this->Update_dlms_on_demand_request_status(request_id, FAILED_RF_TIMEOUT, 0);
+            this->print_and_log("ODM RequestID=%d || [RETRY COUNT] = %d, || [RETURN VALUE] = %d, failed with response code: %d\n", request_id, ex.retry, ret, FAILED_RF_TIMEOUT);
+            return true;
+        }
+        return this->reconnect_odm_exchange(ex);
+    }
+    else if (ret == FAILED_PMESH_ERROR)
+    {
+        this->print_and_log("[❌ ODM ERROR] General failure - [RequestID] = %d, [Response Code] = %u\n", request_id, ret);
+        this->Update_dlms_on_demand_request_status(request_id, FAILED_PMESH_ERROR, 0);
+        return true;
+    }
+    else if (ret == DLMS_ERROR)
+    {
+        this->print_and_log("[⭕ DLMS_ERROR] [REQ_ID] = %d, [Response Code] = %u\n", request_id, ret);
+        uint16_t dlms_error_code = (this->client_rx_buffer[this->buffer_rx_length - 3] << 8) | this->client_rx_buffer[this->buffer_rx_length - 2];
+        this->Update_dlms_on_demand_request_status(request_id, SUCCESS_STATUS, dlms_error_code);
+        return true;
+    }
+    else if (ret == POLL_TIMEOUT)
+    {
+        if (ex.poll_retry < 3)
+        {
+            this->print_and_log("[%s][⏰POLL_TIMEOUT] - retrying, [RequestID] = %d, [RETRY COUNT] = %d, Response Code: %u\n", this->DB_parameter.last_download_time.c_str(), request_id, ex.poll_retry, ret);
+            ex.poll_retry++;
+            return !resend_packet(buf, length, request_id);
+        }
+
+        this->print_and_log("[%s][⏰POLL_TIMEOUT] - retrying, [RequestID] = %d, [RETRY COUNT] = %d, Response Code: %u\n", this->DB_parameter.last_download_time.c_str(), request_id, ex.poll_retry, ret);
+        if (!ex.gateway_heard)
+        {
+            this->print_and_log("❌Gateway didn't respond with response\n");
+            this->gatewayStatus = Status::DISCONNECTED;
+        }
+        this->Update_dlms_on_demand_request_status(request_id, FAILED_NO_GW_RESPONSE, 0);
+        return true;
     }
-
-    // 1. Process all failed commands (highest priority)
-    while (!this->Failed.empty())
+    else if (ret == SUCCES_NEXT_PAGE)
     {
-        // Get a const reference to the first command's byte vector in the Failed queue
-        const std::vector<uint8_t> &cmd_bytes = this->Failed.front();
-
-        // Convert the command byte vector to string for parsing
-        std::string cmd_str(cmd_bytes.begin(), cmd_bytes.end());
-
-        // Split the command string by ':'
-        std::vector<std::string> parts = split(cmd_str, ':');
-
-        // Extract and convert request ID (parts[0]) to int, if present
-        int request_id = -1;
-        if (parts.size() > 0 && !parts[0].empty())
-            request_id = std::stoi(parts[0]);
-
-        int download_type = 0;
-        if (parts.size() > 0 && !parts[4].empty())
-            download_type = std::stoi(parts[4]);
-        // Debug log
-        this->print_and_log("[❌FAILED]: REQ_ID=%d \n", request_id);
-        if (download_type == PING_NODE || download_type == PING_METER)
-            this->Update_dlms_on_demand_Ping_request_status(request_id, FAILED_INVALID_REQUEST);
-        else
-            this->Update_dlms_on_demand_request_status(request_id, FAILED_INVALID_REQUEST, 0); // Update status to failed in DB
-
-        this->Failed.pop();
+        this->tx_page_index++;
+        ex.retry = 1;
+        ex.poll_retry = 1;
+        this->print_and_log("[✅ SUCCES_NEXT_PAGE] - moving to next page (%d), [RequestID] = %d\n", ex.page_index, request_id);
+        bool sent = handle_next_page(buf, length, request_id, download_data_type, ex.page_index);
+        ex.frame.resize(length);
+        return !sent;
     }
-
-    // 2. Process all FUOTA commands
-    fuota->process_fuota_queue();
-
-    // 3. Process all ODM commands
-    while (!this->ODM.empty())
+    else if (ret == INVALID_RESPONSE || ret == COMMAND_IN_PROGRESS)
+    {
+        this->print_and_log("[ℹ️ ODM INFO] Waiting for valid response or command completion - [RequestID] = %d\n", request_id);
+        return false;
+    }
+    else if (ret == DLMS_CHECKSUM_ERROR)
     {
-        // Get a const reference to the first command's byte vector in the ODM queue
-        const std::vector<uint8_t> &cmd_bytes = this->ODM.front();
+        this->print_and_log("[❌ DLMS_CHECKSUM_ERROR] - recalculating and retrying, [RequestID] = %d\n", request_id);
+        ex.dlms_checksum_error_retry++;
+        // Recalculate DLMS checksum (skip PMESH header)
+        recalculate_dlms_checksum(buf, length);
 
-        this->print_and_log("[QUEUE SIZE] ODM = %zu \n", this->ODM.size());
-        // 🔥 PRIORITY CHECK
-        if (has_pending_cancel())
+        // Resend corrected packet
+        if (write_to_client(buf, length) != SUCCESS)
         {
-            this->print_and_log("⏹️ [ODM] 🔄 INTERRUPTING ODM | Processing CANCEL request\n");
-            break; // Exit ODM immediately
+            this->print_and_log("[ODM ERROR] Failed to resend corrected packet - [RequestID] = %d\n", request_id);
+            this->Update_dlms_on_demand_request_status(request_id, FAILED_PMESH_ERROR, 0);
+            return true;
         }
-        this->client_get_time(this->time_str, 2);
+        if (ex.dlms_checksum_error_retry > 3)
+        {
+            this->Update_dlms_on_demand_request_status(request_id, DLMS_FAILED, 0);
+            return true;
+        }
+        return false;
+    }
 
-        // Convert the vector of bytes into a std::string for easier processing and parsing
-        std::string cmd_str(cmd_bytes.begin(), cmd_bytes.end());
+    return false;
+}
 
-        // Split the converted command string by ':' delimiter into individual parts/fields
-        std::vector<std::string> parts = split(cmd_str, ':');
+// Sends one DLMS enable without waiting for it, the answer arrives as a later result
+bool Client::reconnect_odm_exchange(OdmExchange &ex)
+{
+    int request_id = ex.cmd->request_id;
 
-        // Initialize request_id to invalid/default value
-        int request_id = -1;
+    if (ex.retry >= 3)
+    {
+        this->Update_dlms_on_demand_request_status(request_id, DLMS_FAILED, 0);
+        this->print_and_log("ODM RequestID=%d ,failed with response code: 01 %d\n", request_id, DLMS_CONNECTION_FAILED);
+        return true;
+    }
+    ex.retry++;
 
-        // If the parts vector is non-empty and first part is not empty, convert first part to integer request ID
-        if (parts.size() > 0 && !parts[0].empty())
-            request_id = std::stoi(parts[0]);
+    uint8_t DLMS_Enable[8] = {0x2B, 0x07, 0x00, 0x00, 0x00, 0x02, 0x01, 0x35};
+    FrameBuffer enable;
+    enable.push(ex.pmesh_header.data(), ex.pmesh_header.size());
+    enable.push(DLMS_Enable, sizeof(DLMS_Enable));
 
-        // Log the current device ID, length of on-demand data, and the data itself (context info)
-        this->print_and_log("[%s] [ODM START] : gateway_ID = %s | REQ_ID = %d | data = %s\n", this->time_str.c_str(), this->gateway_id, request_id, cmd_bytes.data());
+    if (write_to_client(enable.data(), enable.size()) != SUCCESS)
+    {
+        this->print_and_log("Failed to send ODM packet for RequestID=%d .\n", request_id);
+        return true;
+    }
+    ex.reconnecting = true;
+    return false;
+}
 
-        this->Update_dlms_on_demand_request_status(request_id, IN_PROGRESS, 0);
+void Client::finish_odm_exchange(std::list<OdmExchange>::iterator it)
+{
+    const QueuedCommand &cmd = *it->cmd;
 
-        int hop_count = 0;
-        hop_count = std::stoi(parts[2]); // convert string -> int
+    this->client_get_time(this->time_str, 2);
+    // Log details: request ID, original command string, length of decoded hex data, and total bytes in the command
+    this->print_and_log("[%s] [ODM END]: REQ_ID = %d || Command = %s || HexDataLen = %zu || DataLen = %d\n",
+                        this->time_str.c_str(), cmd.request_id, cmd.raw().c_str(), cmd.field_size(DEST_ADDR), static_cast<int>(cmd.length));
 
-        this->DB_parameter.req_id = request_id;
-        this->DB_parameter.gateway_id = parts[1].c_str(); // GATEWAY ID from parts[1]
-        std::vector<uint8_t> meter_data;
-        meter_data.resize(parts[3].length() / 2); // Resize to exact size
+    this->odm_exchanges.erase(it);
+}
 
-        // **FIX 1: Use parts[3].c_str()**
-        Utility::convert_asc_hex_string_to_bytes(&meter_data[0], (uint8_t *)(parts[3].c_str()), parts[3].length() / 2);
+/**
+ * @brief Waits before the next NMS acquire attempt, servicing gateway traffic meanwhile
+ *
+ * Only an NMS hold is waited out on the lease eventfd; after a failure for any
+ * other reason (DB error) the next attempt is NMS_LEASE_RETRY_BACKOFF_MS away.
+ *
+ * @return SUCCESS=retry now (release signalled or already released), FAILURE=timeout, gateway data handled or disconnected
+ */
+int Client::wait_for_nms_release(int timeout_ms)
+{
+    NmsLeaseManager &leases = NmsLeaseManager::instance();
+    NmsLeaseState state = leases.get_state(this->gateway_id);
 
-        // Last 8 bytes → MAC (as hex)
-        size_t mac_start = meter_data.size() - 8;
-        this->DB_parameter.meter_mac_address = this->bytes_to_hex_string(&meter_data[mac_start], 8);
+    if (state == NmsLeaseState::FREE)
+    {
+        return SUCCESS; // Released between the failed acquire and now
+    }
 
-        // Last 4 bytes → Serial (as hex)
-        size_t serial_start = meter_data.size() - 4;
-        this->DB_parameter.meter_serial_no = this->bytes_to_hex_string(&meter_data[serial_start], 4);
+    bool nms_hold = (state == NmsLeaseState::HELD_BY_NMS);
 
-        // If hop count > 0, validate path in source route network
-        if (hop_count > 0)
+    if (nms_hold && this->nms_lease_fd == -1)
+    {
+        this->nms_lease_fd = eventfd(0, EFD_NONBLOCK);
+        if (this->nms_lease_fd == -1)
         {
-            // Check if path exists in source route network
-            if (!check_path_in_source_route_network(parts, request_id))
-            {
-                Update_dlms_on_demand_request_status(request_id, FAILED_INVALID_REQUEST, 0);
-                this->ODM.pop();
-                continue; // Skip to next command
-            }
+            this->print_and_log("NMS lease eventfd failed: %d\n", errno);
+            nms_hold = false;
         }
+    }
 
-        // Extract command from parts
-        uint8_t download_data_type = 0;
-        download_data_type = static_cast<uint8_t>(std::stoi(parts[4]));
-        this->pingnode_detail.ping_count = 0;
-
-        if (download_data_type == PING_NODE || download_data_type == PING_METER)
-        {
-            // Log PING_NODE details for debugging
-            ping_node_details(parts, this->DB_parameter);
-        }
+    if (nms_hold && !leases.add_waiter(this->gateway_id, this->nms_lease_fd))
+    {
+        return SUCCESS; // Released between get_state and now
+    }
 
-        if (download_data_type == PING_NODE)
-        {
-            this->print_and_log("🔄 [PING NODE] Processing PING_NODE command\n");
-            // Extract PING_NODE command data from parts[5] (hex string) and convert to binary buffer
-            std::vector<uint8_t> command_data;
-            size_t cmd_len = 0;
-            if (parts.size() > 5)
-                cmd_len = parts[5].length() / 2;
-            if (cmd_len > 0)
-            {
-                command_data.resize(cmd_len);
-                Utility::convert_asc_hex_string_to_bytes(command_data.data(),
-                                                         (uint8_t *)parts[5].c_str(),
-                                                         static_cast<uint32_t>(cmd_len));
-            }
+    if (!nms_hold)
+    {
+        timeout_ms = std::min(timeout_ms, NMS_LEASE_RETRY_BACKOFF_MS);
+    }
 
-            // Get repeat count from parts[6] - number of times to send PING command
-            uint8_t count = static_cast<uint8_t>(std::stoi(parts[6]));
+    pollfd fds[2];
+    fds[0].fd = this->get_client_socket();
+    fds[0].events = POLLIN;
+    fds[0].revents = 0;
+    fds[1].fd = this->nms_lease_fd;
+    fds[1].events = POLLIN;
+    fds[1].revents = 0;
 
-            // Send PING_NODE command 'count' times to ensure reliable delivery in mesh network
-            while (count)
-            {
-                this->print_and_log("🔄 [PING NODE] Sending ping, remaining count: %d\n", count);
-                Process_ODM_request(command_data.data(), command_data.size(), request_id, download_data_type);
-                count--;                            // Decrement repeat counter
-                this->pingnode_detail.ping_count++; // Increment ping count statistic
-            }
-            this->pingnode_detail.ping_count = 0; // Reset ping count after sending
-        }
+    int ret = this->gateway_io.poll(fds, nms_hold ? 2 : 1, timeout_ms);
 
-        else
-        {
-            // --- Create PMESH packet using clean function ---
+    if (nms_hold)
+    {
+        leases.remove_waiter(this->gateway_id, this->nms_lease_fd);
+    }
 
-            std::vector<uint8_t> pkt = build_pmesh_frame(parts);
-            //  Send the framed PMESH packet to the client and process responses
-            Process_ODM_request(pkt.data(), pkt.size(), request_id, download_data_type);
-        }
+    if (ret > 0 && (fds[0].revents & (POLLHUP | POLLERR | POLLNVAL)))
+    {
+        this->print_and_log("Gateway %s socket closed while waiting for the NMS lease\n", this->gateway_id);
+        this->gatewayStatus = Status::DISCONNECTED;
+        return FAILURE;
+    }
 
-        this->client_get_time(this->time_str, 2);
-        // Log details: request ID, original command string, length of decoded hex data, and total bytes in the command
-        this->print_and_log("[%s] [ODM END]: REQ_ID = %d || Command = %s || HexDataLen = %zu || DataLen = %d\n",
-                            this->time_str.c_str(), request_id, cmd_str.c_str(), parts[3].length(), static_cast<int>(cmd_bytes.size()));
+    if (nms_hold && ret > 0 && (fds[1].revents & POLLIN))
+    {
+        eventfd_t u;
+        eventfd_read(this->nms_lease_fd, &u);
+        this->print_and_log("NMS lease signalled for gateway %s\n", this->gateway_id);
+        return SUCCESS;
+    }
 
-        if (this->gatewayStatus == DISCONNECTED)
-            break;
-        // Remove the processed command from the front of the ODM queue
-        this->ODM.pop();
+    if (ret > 0 && (fds[0].revents & POLLIN))
+    {
+        this->receive_data_and_validate_response();
     }
-    ODM_Flag = 0; // Reset the flag after completion of ODM
-    this->print_and_log("[ODM Flag] =%d\n", ODM_Flag);
-    insert_update_hes_nms_sync_time(this->gateway_id, 0);
+
+    return FAILURE;
 }
 
 std::string Client::bytes_to_hex_string(const uint8_t *data, size_t len) const
@@ -1387,7 +2233,7 @@ std::string Client::bytes_to_hex_string(const uint8_t *data, size_t len) const
     return out;
 }
 
-std::vector<uint8_t> Client::build_odm_pmesh_packet(const PMeshHeader &header, const uint8_t *command, size_t command_len)
+FrameBuffer Client::build_odm_pmesh_packet(const PMeshHeader &header, const uint8_t *command, size_t command_len)
 {
     this->print_and_log("%s start\n", __FUNCTION__);
     size_t pmh_len;
@@ -1397,43 +2243,41 @@ std::vector<uint8_t> Client::build_odm_pmesh_packet(const PMeshHeader &header, c
         pmh_len = 13 + 4;
     size_t total_len = pmh_len + command_len;
 
-    std::vector<uint8_t> packet(total_len, 0);
+    FrameBuffer packet;
 
     // Fill PMESH header
-    packet[0] = header.start_byte;
-    packet[1] = static_cast<uint8_t>(total_len - 1);
-    packet[2] = header.packet_type;
-    memcpy(&packet[3], header.pan_id, 4);
-    memcpy(&packet[7], header.source_address, 4);
-    packet[11] = header.router_index;
-    packet[12] = header.hop_count;
-    if (header.hop_count > 0 && !header.dest_address.empty())
-        memcpy(&packet[13], header.dest_address.data(), header.hop_count * 4);
-    else
-        memcpy(&packet[13], header.dest_address.data(), 4);
+    packet.push(header.start_byte);
+    packet.push(static_cast<uint8_t>(total_len - 1));
+    packet.push(header.packet_type);
+    packet.push(header.pan_id, 4);
+    packet.push(header.source_address, 4);
+    packet.push(header.router_index);
+    packet.push(header.hop_count);
+    packet.push(header.dest_address, std::min(pmh_len - 13, sizeof(header.dest_address)));
+    packet.resize(pmh_len); // short path, the missing hops stay zero
 
     this->Pmesh_header.resize(pmh_len);
     memcpy(this->Pmesh_header.data(), packet.data(), pmh_len);
     // Copy command after PMESH header
-    memcpy(&packet[pmh_len], command, command_len);
+    packet.push(command, command_len);
+
+    if (packet.overflowed())
+        this->print_and_log("[ODM ERROR] PMESH frame of %zu bytes truncated to %d\n", total_len, FRAME_BUFFER_SIZE);
     return packet;
 }
 
-std::vector<uint8_t> Client::build_pmesh_frame(const std::vector<std::string> &parts)
+FrameBuffer Client::build_pmesh_frame(const QueuedCommand &cmd)
 {
     this->print_and_log("%s start\n", __FUNCTION__);
     Client::PMeshHeader header;
-    uint8_t command[256] = {0};
 
-    // Decode command data
-    if (parts.size() > 5 && !parts[5].empty())
-        Utility::convert_asc_hex_string_to_bytes(command, (uint8_t *)parts[5].c_str(), parts[5].length() / 2);
+    // Command data, gateway and path were decoded and validated at parse time
 
     // PMESH header
     header.start_byte = 0x2E;
 
     // Set packet type based on parts[4]
-    if (parts[4] == "13")
+    if (cmd.download_data_type == PING_NODE)
         header.packet_type = 0x0D; // Ping node command
     else
         header.packet_type = 0x07; // other commands
@@ -1442,51 +2286,46 @@ std::vector<uint8_t> Client::build_pmesh_frame(const std::vector<std::string> &p
     header.pan_id[1] = 0x00;
 
     // PAN ID last 2 bytes from GATEWAY ID
-    std::string hex_str = parts[1].substr(parts[1].length() - 4, 4);
-    Utility::convert_asc_hex_string_to_bytes(&header.pan_id[2], (uint8_t *)hex_str.c_str(), hex_str.length() / 2);
+    memcpy(&header.pan_id[2], &cmd.gateway[6], 2);
 
     // Source address last 4 bytes of GATEWAY ID
-    hex_str = parts[1].substr(parts[1].length() - 8, 8);
-    Utility::convert_asc_hex_string_to_bytes(header.source_address, (uint8_t *)hex_str.c_str(), hex_str.length() / 2);
+    memcpy(header.source_address, &cmd.gateway[4], 4);
 
     // Router index
     header.router_index = 0x00;
 
     // Hop count
-    header.hop_count = static_cast<uint8_t>(std::stoi(parts[2])); // for example "2"
+    header.hop_count = static_cast<uint8_t>(cmd.hop_count); // for example "2"
 
-    // Decode path as destination address
-    uint8_t path[100] = {0};
+    // Path as destination address
+    const uint8_t *path = cmd.path;
 
-    Utility::convert_asc_hex_string_to_bytes(path, (uint8_t *)parts[3].c_str(), parts[3].length() / 2);
+    memset(header.dest_address, 0, sizeof(header.dest_address));
+    size_t dest_len = 0;
 
-    header.dest_address.clear();
-
-    size_t total_bytes = parts[3].length() / 2; // Total bytes in path
+    size_t total_bytes = cmd.path_len; // Total bytes in path
 
     if (header.hop_count == 0)
     {
         /* example:
         path = 3CC1F601A3535435
         header.dest_address = A3535435  */
-        header.dest_address.insert(header.dest_address.end(), path + 4, path + 8); // Copy bytes 4-7 as destination address
+        memcpy(header.dest_address, path + 4, 4); // Copy bytes 4-7 as destination address
     }
     else
     {
         /* example:
         path = 3CC1F601A35354353CC1F601000000453CC1F60100000047
         header.dest_address = 0000004500000047  */
-        for (size_t i = 8; i + 8 <= total_bytes; i += 8) // For each 8-byte block
+        for (size_t i = 8; i + 8 <= total_bytes && dest_len + 4 <= sizeof(header.dest_address); i += 8) // For each 8-byte block
         {
             // take only last 4 bytes of each 8-byte block
-            for (size_t j = i + 4; j < i + 8; j++) // Last 4 bytes
-            {
-                header.dest_address.push_back(path[j]);
-            }
+            memcpy(header.dest_address + dest_len, path + i + 4, 4);
+            dest_len += 4;
         }
     }
     // Frame PMESH packet
-    return build_odm_pmesh_packet(header, command, parts[5].length() / 2);
+    return build_odm_pmesh_packet(header, cmd.payload, cmd.payload_len);
 }
 
 void Client::get_destination_address(uint8_t *buf)
@@ -1523,7 +2362,7 @@ void Client::get_destination_address(uint8_t *buf)
     }
 }
 
-int Client::write_to_client_vector(std::vector<uint8_t> &buff)
+int Client::write_to_client_vector(FrameBuffer &buff)
 {
     this->print_and_log("%s start\n", __FUNCTION__);
 
@@ -1545,7 +2384,7 @@ int Client::write_to_client_vector(std::vector<uint8_t> &buff)
     {
         usleep(20000); // 20ms
 
-        ssize_t written = send(this->client_socket, buff.data() + total_written, length - total_written, 0);
+        ssize_t written = this->gateway_io.send(buff.data() + total_written, length - total_written);
 
         if (written < 0)
         {
@@ -1603,200 +2442,6 @@ int Client::validate_source_address(uint8_t *buf)
     return FAILURE;
 }
 
-void Client::Process_ODM_request(uint8_t *buf, size_t length, int request_id, uint8_t download_data_type)
-{
-    this->print_and_log("%s START\n", __FUNCTION__);
-
-    // Set the receive timeout for the client to 12 seconds
-    if (download_data_type == 0x05) // For ALL TAMPER EVENTS PROFILE
-        set_recv_timeout_for_client(20);
-    else
-        set_recv_timeout_for_client(12);
-
-    // Log the start of processing with request id and command
-    this->print_and_log("%s start [RequestID]=%d [Download data_type]=%d\n", __FUNCTION__, request_id, download_data_type);
-
-    this->pingnode_detail.Time_tx = std::chrono::steady_clock::now();
-    tx_page_index = 0;
-
-    // Send the initial ODM packet to the client
-    if (write_to_client(buf, length) != SUCCESS)
-    {
-        // If send fails, log and exit the function
-        this->print_and_log("[❌ODM ERROR] Failed to send initial packet - RequestID: %d\n", request_id);
-        return;
-    }
-
-    if (length >= 5 && download_data_type > 0x0F)
-    {
-        this->pp_write_payload_tail =
-            (static_cast<uint32_t>(buf[length - 5]) << 24) | (static_cast<uint32_t>(buf[length - 4]) << 16) | (static_cast<uint32_t>(buf[length - 3]) << 8) | static_cast<uint32_t>(buf[length - 2]);
-        this->print_and_log("[ODM DEBUG] Last 4 Write bytes : 0x%08X\n", this->pp_write_payload_tail);
-    }
-
-    uint8_t page_index = 1; // Initialize page index for multi-page data handling
-    uint8_t poll_retry = 1;
-    uint8_t once = true;
-    uint8_t invalid_resp = 0;
-    uint8_t dlms_checksum_error_retry = 1;
-    // Start a loop to receive responses and handle multiple pages if needed
-    while (1)
-    {
-        // Wait for and validate incoming response data
-        int ret = receive_data_and_validate_response();
-        client_get_time(this->DB_parameter.last_download_time, 1);
-
-        if (ret == SUCCESS)
-        {
-            this->retry = 1;
-            this->pingnode_detail.Time_rx = std::chrono::steady_clock::now();
-            this->print_and_log("[✅ SUCCESS] - RequestID: %d\n", request_id);
-            if (!handle_success(request_id, download_data_type, buf)) continue;
-            page_index = 0;
-            return;
-        }
-        else if (ret == DLMS_SUCCESS)
-        {
-            this->print_and_log("[✅ DLMS_SUCCESS] - resending packet, [RequestID] = %d\n", request_id);
-            if (!resend_packet(buf, length, request_id)) return;
-            continue;
-        }
-        else if (ret == PMESH_ERROR)
-        {
-            if (download_data_type == PING_NODE)
-                Update_Insert_Ping_request(download_data_type, FAILED_PMESH_ERROR);
-            else
-                this->Update_dlms_on_demand_request_status(request_id, FAILED_PMESH_ERROR, 0);
-            break;
-        }
-        else if (ret == TIMEOUT_RECEIVED)
-        {
-            this->print_and_log("[⏰TIMEOUT_RECEIVED] - retrying, [RequestID] = %d || [RETRY COUNT] = %d\n", request_id, this->retry);
-            if (this->retry == 3)
-            {
-                this->Update_dlms_on_demand_request_status(request_id, FAILED_RF_TIMEOUT, 0);
-                this->print_and_log("ODM RequestID=%d || [RETRY COUNT] = %d, || [RETURN VALUE] = %d, failed with response code: %d\n", request_id, this->retry, ret, FAILED_RF_TIMEOUT);
-                this->retry = 1;
-                break;
-            }
-            if (once)
-            {
-                this->Update_dlms_on_demand_request_status(request_id, RETRY_IN_PROGRESS, 0);
-                once = false;
-            }
-            this->retry++;
-            if (!resend_packet(buf, length, request_id)) return;
-            continue;
-        }
-        else if (ret == DLMS_CONNECTION_FAILED)
-        {
-            this->print_and_log("[❌DLMS_CONNECTION_FAILED] - recovering, [RequestID] = %d\n", request_id);
-            if (this->retry == 3)
-            {
-                this->Update_dlms_on_demand_request_status(request_id, FAILED_RF_TIMEOUT, 0);
-                this->print_and_log("ODM RequestID=%d || [RETRY COUNT] = %d, || [RETURN VALUE] = %d, failed with response code: %d\n", request_id, this->retry, ret, FAILED_RF_TIMEOUT);
-                this->retry = 1;
-                break;
-            }
-            if (!handle_connection_failed(request_id)) return;
-            continue;
-        }
-        else if (ret == FAILED_PMESH_ERROR)
-        {
-            this->print_and_log("[❌ ODM ERROR] General failure - [RequestID] = %d, [Response Code] = %u\n", request_id, ret);
-            // General failure case, update DB and log
-            this->Update_dlms_on_demand_request_status(request_id, FAILED_PMESH_ERROR, 0);
-            memset(this->src_addr_check_buffer, 0, sizeof(this->src_addr_check_buffer));
-            break;
-        }
-        else if (ret == DLMS_ERROR)
-        {
-            this->print_and_log("[⭕ DLMS_ERROR] [REQ_ID] = %d, [Response Code] = %u\n", request_id, ret);
-            uint16_t dlms_error_code = (this->client_rx_buffer[this->buffer_rx_length - 3] << 8) | this->client_rx_buffer[this->buffer_rx_length - 2];
-            this->Update_dlms_on_demand_request_status(request_id, SUCCESS_STATUS, dlms_error_code);
-            memset(this->src_addr_check_buffer, 0, sizeof(this->src_addr_check_buffer));
-            break;
-        }
-        else if (ret == POLL_TIMEOUT)
-        {
-            if (download_data_type == PING_NODE)
-            {
-                this->print_and_log("[⏰POLL_TIMEOUT] - PING_NODE failed , [RequestID] = %d, Response Code: %u\n", request_id, ret);
-                Update_Insert_Ping_request(download_data_type, FAILED_NO_GW_RESPONSE);
-                break;
-            }
-
-            if (poll_retry < 3)
-            {
-                this->print_and_log("[%s][⏰POLL_TIMEOUT] - retrying, [RequestID] = %d, [RETRY COUNT] = %d, Response Code: %u\n", this->DB_parameter.last_download_time.c_str(), request_id, poll_retry, ret);
-                poll_retry++;
-                if (!resend_packet(buf, length, request_id)) return;
-                continue;
-            }
-
-            this->print_and_log("[%s][⏰POLL_TIMEOUT] - retrying, [RequestID] = %d, [RETRY COUNT] = %d, Response Code: %u\n", this->DB_parameter.last_download_time.c_str(), request_id, poll_retry, ret);
-            if (!invalid_resp)
-            {
-                this->print_and_log("[INVALID RESPONSE FLAG] = %d\n", invalid_resp);
-                this->print_and_log("❌Gateway didn't respond with response\n");
-                this->gatewayStatus = Status::DISCONNECTED;
-            }
-            this->Update_dlms_on_demand_request_status(request_id, FAILED_NO_GW_RESPONSE, 0);
-            memset(this->src_addr_check_buffer, 0, sizeof(this->src_addr_check_buffer));
-            break;
-        }
-        else if (ret == SUCCES_NEXT_PAGE)
-        {
-            tx_page_index++;
-            this->retry = 1;
-            poll_retry = 1;
-            this->print_and_log("[✅ SUCCES_NEXT_PAGE] - moving to next page (%d), [RequestID] = %d\n", page_index, request_id);
-            if (!handle_next_page(buf, length, request_id, download_data_type, page_index)) return;
-            continue;
-        }
-        else if (ret == INVALID_RESPONSE || ret == COMMAND_IN_PROGRESS)
-        {
-            invalid_resp = 1;
-            this->print_and_log("[ℹ️ ODM INFO] Waiting for valid response or command completion - [RequestID] = %d\n", request_id);
-            // Continue waiting if response invalid or command still in progress
-            continue;
-        }
-
-        else if (ret == DLMS_CHECKSUM_ERROR)
-        {
-            this->print_and_log("[❌ DLMS_CHECKSUM_ERROR] - recalculating and retrying, [RequestID] = %d\n", request_id);
-            dlms_checksum_error_retry++;
-            // Recalculate DLMS checksum (skip PMESH header)
-            recalculate_dlms_checksum(buf, length);
-
-            // Log corrected frame (first few + checksum)
-            this->print_and_log("[ODM DEBUG] Corrected frame: ");
-            for (size_t i = 0; i < 20 && i < length; ++i)
-            {
-                this->print_and_log("%02X ", buf[i]);
-            }
-            this->print_and_log("... <checksum=0x%02X>\n", buf[length - 1]);
-
-            // Resend corrected packet
-            if (write_to_client(buf, length) != SUCCESS)
-            {
-                this->print_and_log("[ODM ERROR] Failed to resend corrected packet - [RequestID] = %d\n", request_id);
-                this->Update_dlms_on_demand_request_status(request_id, FAILED_PMESH_ERROR, 0);
-                memset(this->src_addr_check_buffer, 0, sizeof(this->src_addr_check_buffer));
-                break;
-            }
-            if (dlms_checksum_error_retry > 3)
-            {
-                this->Update_dlms_on_demand_request_status(request_id, DLMS_FAILED, 0);
-                break;
-            }
-
-            this->print_and_log("[ODM INFO] Checksum fixed and packet resent - awaiting response, RequestID: %d\n", request_id);
-            continue; // Wait for new response
-        }
-    }
-}
-
 void Client::recalculate_dlms_checksum(uint8_t *buf, size_t total_length)
 {
     if (total_length < 18)
@@ -2102,33 +2747,6 @@ bool Client::handle_next_page(uint8_t *buf, size_t &length, int request_id, uint
     return true;
 }
 
-// Handles DLMS connection failure with retries, returns false on failure
-bool Client::handle_connection_failed(int request_id)
-{
-    uint8_t DLMS_Enable[8] = {0x2B, 0x07, 0x00, 0x00, 0x00, 0x02, 0x01, 0x35};
-    this->Pmesh_header.insert(this->Pmesh_header.end(), DLMS_Enable, DLMS_Enable + 8);
-
-    while (this->retry < 3)
-    {
-        this->retry++;
-        if (write_to_client(this->Pmesh_header.data(), this->Pmesh_header.size()) != SUCCESS)
-        {
-            this->print_and_log("Failed to send ODM packet for RequestID=%d .\n", request_id);
-            return false;
-        }
-        int ret = receive_data_and_validate_response();
-        if (ret == DLMS_SUCCESS)
-        {
-            this->retry = 1;
-            return true;
-        }
-    }
-
-    this->Update_dlms_on_demand_request_status(request_id, DLMS_FAILED, 0);
-    this->print_and_log("ODM RequestID=%d ,failed with response code: 01 %d\n", request_id, DLMS_CONNECTION_FAILED);
-    return false;
-}
-
 bool Client::validate_response_frame(uint8_t *buf)
 {
     if (buf[20] == 0x0E)
@@ -2164,8 +2782,21 @@ bool Client::handle_success(int request_id, uint8_t download_data_type, uint8_t
     this->DB_parameter.push_alaram = 2; // PULL
     // **CALL SEPARATE DB FUNCTION** - handles all cases efficiently
     this->print_and_log("[Download Data_Type] = %d\n", download_data_type);
+
+    // Identical reads queued behind this one share its response
+    OdmResponseState response;
+    bool coalesce = (this->collect_waiting_reads(download_data_type) > 0);
+    if (coalesce)
+    {
+        response.profiles = *this;
+        response.name_plate = this->name_plate;
+    }
+
     bool result = this->update_odm_db(download_data_type);
 
+    if (coalesce)
+        this->fan_out_odm_result(download_data_type, response);
+
     // **CLEAR AFTER DB UPDATE**
     this->DB_parameter = DBparameters();
 
@@ -3201,16 +3832,6 @@ bool Client::update_odm_db(uint8_t download_data_type)
 
             break;
         }
-        case DATA_TYPE_PING_NODE: {
-            this->print_and_log("Ping Node\n");
-            Update_Insert_Ping_request(download_data_type, SUCCESS_STATUS); // Insert new record
-            return true;
-        }
-        case DATA_TYPE_PING_METER:
-            this->print_and_log("Ping Meter\n");
-            Update_Insert_Ping_request(download_data_type, SUCCESS_STATUS); // Insert new record
-            return true;
-
         // **COMMANDS 15-25** - programmable_parameter_data table (COMPLETE)
         case DATA_TYPE_RTC_READ:
         case DATA_TYPE_RTC_WRITE: // RTC Read/Write
@@ -3300,7 +3921,85 @@ bool Client::update_odm_db(uint8_t download_data_type)
     { // ✅ FAILURE
         this->print_and_log("[DB] 🗄️ INSERT ❌ | Type=%u \n", download_data_type);
     }
-    return true;
+    return true;
+}
+
+static bool is_coalescible_read(uint8_t download_data_type)
+{
+    switch (download_data_type)
+    {
+        case DATA_TYPE_NP:
+        case DATA_TYPE_IP:
+        case DATA_TYPE_BHP:
+        case DATA_TYPE_DLP:
+        case DATA_TYPE_BLP:
+        case DATA_TYPE_ALL_EVENTS:
+        case DATA_TYPE_VOLTAGE_EVENTS:
+        case DATA_TYPE_CURRENT_EVENTS:
+        case DATA_TYPE_POWER_EVENTS:
+        case DATA_TYPE_TRANSACTIONAL_EVENTS:
+        case DATA_TYPE_OTHER_EVENTS:
+        case DATA_TYPE_NON_ROLL_OVER_EVENTS:
+        case DATA_TYPE_CONTROL_EVENTS:
+        case DATA_TYPE_RTC_READ:
+        case DATA_TYPE_DEMAND_INTEGRATION_PERIOD_READ:
+        case DATA_TYPE_CAPTURE_PERIOD_READ:
+        case DATA_TYPE_LOAD_LIMIT_READ:
+        case DATA_TYPE_LOAD_STATUS_READ:
+        case DATA_TYPE_ACTION_SCHEDULER_READ:
+        case DATA_TYPE_ACTIVITY_CALENDAR_READ:
+        case DATA_TYPE_METER_FIRMWARE_VERSION_READ:
+        case DATA_TYPE_RF_FIRMWARE_VERSION_READ:
+            return true;
+        default:
+            return false; // pings, writes, FUOTA and MD reset always go over RF
+    }
+}
+
+/*
+ * Finds the pending ODM commands that ask the same meter for the same read
+ * as the one in flight, including those that arrived during the exchange.
+ */
+size_t Client::collect_waiting_reads(uint8_t download_data_type)
+{
+    this->odm_waiting.clear();
+
+    if (this->odm_in_flight == nullptr || !is_coalescible_read(download_data_type))
+        return 0;
+
+    this->drain_odm_ring();
+    this->odm_schedule.for_each([this](QueuedCommand &queued) {
+        if (!queued.answered && queued.same_read_as(*this->odm_in_flight))
+            this->odm_waiting.push_back(&queued);
+    });
+    return this->odm_waiting.size();
+}
+
+/*
+ * Writes the response of the request in flight for every waiting request ID
+ * and marks those commands answered so the ODM loop drops them without RF.
+ * update_odm_db clears the profile it stored, so each one starts again from
+ * the copy taken before the first write.
+ */
+void Client::fan_out_odm_result(uint8_t download_data_type, const OdmResponseState &response)
+{
+    int leader_id = this->odm_in_flight->request_id;
+
+    for (QueuedCommand *waiting : this->odm_waiting)
+    {
+        waiting->answered = true;
+        if (this->take_cancelled(waiting->request_id))
+            continue;
+
+        static_cast<ODMProfiles &>(*this) = response.profiles;
+        this->name_plate = response.name_plate;
+        this->DB_parameter.req_id = waiting->request_id;
+
+        this->print_and_log("[ODM COALESCED] REQ_ID=%d answered from REQ_ID=%d\n", waiting->request_id, leader_id);
+        this->update_odm_db(download_data_type);
+        this->gateway_metrics.add(this->gateway_metrics.odm_coalesced);
+    }
+    this->odm_waiting.clear();
 }
 
 void Client::clear_profile_for_type(uint8_t download_data_type)
@@ -3380,16 +4079,21 @@ void Client::clear_profile_for_type(uint8_t download_data_type)
 }
 
 //(added by Supritha K P)
-int Client::init_connection(int val1, int val2, int val3)
+void Client::record_gateway_connection(int val1, int val2, int val3)
 {
-    insert_update_hes_nms_sync_time(this->gateway_id, 1);
     if (this->update_into_gateway_status_info((const uint8_t *)this->pgwid, this->gatewayStatus, this->val1, this->val2, this->val3) == FAILURE) //(added by Supritha K P)
     {
         insert_into_gateway_status_info((const uint8_t *)this->pgwid);
     }
     this->insert_into_gateway_connection_log((const uint8_t *)this->pgwid, val1, val2, val3);
+}
+
+int Client::init_connection(int val1, int val2, int val3)
+{
+    insert_update_hes_nms_sync_time(this->gateway_id, 1);
+    this->record_gateway_connection(val1, val2, val3);
 
-    if (this->db->check_for_fuota_resume(this->gateway_id) == SUCCESS)
+    if (this->check_for_fuota_resume(this->gateway_id) == SUCCESS)
     {
         std::vector<uint8_t> pending_cmd;
         unsigned char target_mac_address[17] = {0}; // will be filled from dequeued command if available
@@ -3415,13 +4119,13 @@ int Client::init_connection(int val1, int val2, int val3)
                     Utility::convert_asc_hex_string_to_bytes(target_mac_address, (uint8_t *)parts[DEST_ADDR].c_str(), parts[DEST_ADDR].length() / 2);
             }
 
-            fuota->resume_rf_fuota_pending_state_process((unsigned char *)this->gateway_id, target_mac_address, this->request_id, this->firmware_path, this->firmware_filename);
+            this->fuota_session().resume_rf_fuota_pending_state_process((unsigned char *)this->gateway_id, target_mac_address, this->request_id, this->firmware_path, this->firmware_filename);
         }
         else
         {
             this->print_and_log("(%s) -> init_connection: no pending resume command in queue, invoking DB-based resume\n", this->gateway_id);
             // No pending entry in resume queue; trigger resume flow which will fetch from DB
-            fuota->resume_rf_fuota_pending_state_process((unsigned char *)this->gateway_id, target_mac_address, this->request_id, this->firmware_path, this->firmware_filename);
+            this->fuota_session().resume_rf_fuota_pending_state_process((unsigned char *)this->gateway_id, target_mac_address, this->request_id, this->firmware_path, this->firmware_filename);
         }
     }
 
@@ -4071,6 +4775,9 @@ int Client::transmit_command_and_validate_response(uint8_t *buf, size_t length,
     uint8_t tx_buffer[512] = {0};
     this->page_index_count = 0; // reset page index for next tx
 
+    std::chrono::steady_clock::time_point tx_at{}; // Last write, for the RF round-trip metric
+    bool awaiting_first_rx = false;
+
     uint8_t hop_count = 0; // Number of mesh hops
 
     PMESHQuerycmd *Pmeshbuf = reinterpret_cast<PMESHQuerycmd *>(buf); // Cast buffer to PMESH structure
@@ -4083,6 +4790,7 @@ int Client::transmit_command_and_validate_response(uint8_t *buf, size_t length,
         if (need_to_write) // Time to transmit next command?
         {
             set_recv_timeout_for_client(12); // Set 12-second receive timeout
+            this->gateway_io.cork();         // The frame goes out with the receive below
             if (!need_to_write_dlms_pkt)     // Send original PMESH packet?
             {
                 memcpy(tx_buffer, buf, length);
@@ -4114,6 +4822,9 @@ int Client::transmit_command_and_validate_response(uint8_t *buf, size_t length,
                 }
             }
             need_to_write = false; // Transmission complete, await response
+            tx_at = std::chrono::steady_clock::now();
+            awaiting_first_rx = true;
+            this->gateway_metrics.add(this->gateway_metrics.rf_transmits);
         }
 
         memset(buffer, 0, sizeof(buffer)); // Clear receive buffer
@@ -4124,6 +4835,12 @@ int Client::transmit_command_and_validate_response(uint8_t *buf, size_t length,
         {
             got_any_response = true; // Mark communication alive
 
+            if (awaiting_first_rx)
+            {
+                this->gateway_metrics.observe_since(this->gateway_metrics.rf_rtt, tx_at);
+                awaiting_first_rx = false;
+            }
+
             res = this->validate_response_buffer(tx_buffer, buffer);
             ret = FAILURE;
             if (res == SUCCESS)
@@ -4196,6 +4913,7 @@ int Client::transmit_command_and_validate_response(uint8_t *buf, size_t length,
                     {
                         this->print_and_log("Retry count in dlms failure %u for [%s] \n", retry, this->gateway_id);
                         retry++; // Increment retry counter
+                        this->gateway_metrics.add(this->gateway_metrics.rf_retries);
                     }
                     need_to_write_dlms_pkt = true; // Switch to DLMS reconnection mode
                     need_to_write = true;
@@ -4216,6 +4934,7 @@ int Client::transmit_command_and_validate_response(uint8_t *buf, size_t length,
                 break;
                 case PMESH_TIMEOUT_ERROR: // Mesh layer timeout - try alternate path
                 {
+                    this->gateway_metrics.add(this->gateway_metrics.rf_timeouts);
                     if (retry_timeout >= 2 && tried_alternate_path < 2 && buf[2] == MESH_DATA_QUERY) // Alternate path conditions met
                     {
                         if (hop_count == 0)
@@ -4349,6 +5068,8 @@ int Client::transmit_command_and_validate_response(uint8_t *buf, size_t length,
             this->print_and_log("[⏰ POLL TIMEOUT]: %u for [%s]\n", retry, this->gateway_id);
             need_to_write = true; // Retransmit next iteration
             retry++;              // Increment retry counter
+            this->gateway_metrics.add(this->gateway_metrics.rf_timeouts);
+            this->gateway_metrics.add(this->gateway_metrics.rf_retries);
         }
 
         if (ret == PMESH_TIMEOUT_ERROR || ret == FAILED_RESPONSE) // Normal retry conditions
@@ -4356,6 +5077,7 @@ int Client::transmit_command_and_validate_response(uint8_t *buf, size_t length,
             need_to_write = true; // resend on next iteration
             retry++;              // Increment retry counter
             retry_timeout++;      // Increment timeout counter
+            this->gateway_metrics.add(this->gateway_metrics.rf_retries);
         }
         if ((retry > 2 || retry_timeout > 2)) // Max retries exceeded
         {
@@ -4810,90 +5532,51 @@ void Client::Insert_receive_data_offset()
     }
 }
 
-void Client::Update_Insert_Ping_request(uint8_t download_type, uint8_t status)
+/*
+ * One row per ping series: the request's own row gets the status and the
+ * RTT distribution, time_duration carries the average.
+ */
+void Client::update_ping_summary(const OdmExchange &ex)
 {
-    char query_buf[MAX_QUERY_BUFFER] = {0};
-    this->pingnode_detail.time_duration = std::chrono::duration_cast<std::chrono::milliseconds>(this->pingnode_detail.Time_rx - this->pingnode_detail.Time_tx).count();
-    if (download_type == PING_NODE)
+    PingSummary summary = ex.rtt.summary();
+    uint8_t status = (summary.received > 0) ? static_cast<uint8_t>(SUCCESS_STATUS) : ex.ping_failure;
+
+    client_get_time(this->DB_parameter.last_download_time, 2); // YYYY-MM-DD HH:MM:SS.mmm
+
+    this->print_and_log("[PING SUMMARY] REQ_ID = %zu | sent = %u | received = %u | loss = %u%% | min/avg/p95 = %u/%u/%u ms\n", this->DB_parameter.req_id, summary.sent,
+                        summary.received, summary.loss_percent, summary.rtt_min_ms, summary.rtt_avg_ms, summary.rtt_p95_ms);
+
+    char query_buf[512] = {0};
+    bool rtt_columns = this->has_ping_rtt_columns();
+    if (rtt_columns)
     {
-        if (this->pingnode_detail.ping_count == 0) // First ping request
-        {
-            snprintf(query_buf, sizeof(query_buf),
-                     "UPDATE dlms_on_demand_ping_request SET status = %d, last_download_time = '%s', time_duration = %llu WHERE gateway_id = '%s' AND target_mac_address = '%s' AND request_id = %zu",
-                     status,
-                     this->DB_parameter.last_download_time.c_str(),
-                     (unsigned long long)this->pingnode_detail.time_duration,
-                     this->DB_parameter.gateway_id.c_str(),
-                     this->DB_parameter.meter_mac_address.c_str(),
-                     this->DB_parameter.req_id);
-        }
-        else
-        {
-            snprintf(query_buf, sizeof(query_buf),
-                     "INSERT INTO dlms_on_demand_ping_request("
-                     "gateway_id,gateway_type,meter_sno,download_sub_data_type,target_mac_address,request_command,status,request_id,last_download_time,time_duration) "
-                     "VALUES('%s',%d,'%s',%d,'%s','%s',%d,%zu,'%s',%llu)",
-
-                     // 6 VALUES :
-                     this->pingnode_detail.gateway_id.c_str(),
-                     this->pingnode_detail.gateway_type.back(),
-                     this->pingnode_detail.meter_serial_no.c_str(),
-                     download_type,
-                     this->pingnode_detail.target_mac_address.c_str(),
-                     this->pingnode_detail.req_command.c_str(),
-                     status,
-                     this->pingnode_detail.request_id.back(),
-                     this->DB_parameter.last_download_time.c_str(),
-                     (unsigned long long)this->pingnode_detail.time_duration);
-        }
+        snprintf(query_buf, sizeof(query_buf),
+                 "UPDATE dlms_on_demand_ping_request SET status = %d, last_download_time = '%s', time_duration = %u, ping_sent = %u, ping_received = %u, "
+                 "rtt_min_ms = %u, rtt_p95_ms = %u, loss_percent = %u WHERE gateway_id = '%s' AND target_mac_address = '%s' AND request_id = %zu",
+                 status, this->DB_parameter.last_download_time.c_str(), summary.rtt_avg_ms, summary.sent, summary.received, summary.rtt_min_ms, summary.rtt_p95_ms,
+                 summary.loss_percent, this->DB_parameter.gateway_id.c_str(), this->DB_parameter.meter_mac_address.c_str(), this->DB_parameter.req_id);
     }
     else
     {
+        // Table without the distribution columns (see detect_ping_summary_schema): status and average only
         snprintf(query_buf, sizeof(query_buf),
-                 "UPDATE dlms_on_demand_ping_request SET status = %d, last_download_time = '%s', time_duration = %llu WHERE gateway_id = '%s' AND target_mac_address = '%s' AND request_id = %zu",
-                 status,
-                 this->DB_parameter.last_download_time.c_str(),
-                 (unsigned long long)this->pingnode_detail.time_duration,
-                 this->DB_parameter.gateway_id.c_str(),
-                 this->DB_parameter.meter_mac_address.c_str(),
+                 "UPDATE dlms_on_demand_ping_request SET status = %d, last_download_time = '%s', time_duration = %u WHERE gateway_id = '%s' AND target_mac_address = '%s' AND request_id = %zu",
+                 status, this->DB_parameter.last_download_time.c_str(), summary.rtt_avg_ms, this->DB_parameter.gateway_id.c_str(), this->DB_parameter.meter_mac_address.c_str(),
                  this->DB_parameter.req_id);
     }
-    int db_result = execute_query(query_buf);
-    if (db_result == 0)
-    { // ✅ SUCCESS
-        this->print_and_log("[DB] 🗄️ INSERT ✅ | Type=%u | ReqID=%zu\n", download_type, this->DB_parameter.req_id);
-        clear_profile_for_type(download_type);
-    }
-    else
-    { // ✅ FAILURE
-        this->print_and_log("[DB] 🗄️ INSERT ❌ | Type=%u \n", download_type);
-    }
-}
 
-void Client::ping_node_details(const std::vector<std::string> &parts, DBparameters &DB_parameter)
-{
-    this->print_and_log("Ping Node/Meter Details\n");
-    this->pingnode_detail.gateway_id = parts.size() > 1 ? parts[1] : std::string();
-    uint8_t hop_count = 0;
-    if (parts.size() > 2 && !parts[2].empty())
-        hop_count = static_cast<uint8_t>(std::stoi(parts[2]));
-    if (hop_count == 0)
-        this->pingnode_detail.gateway_type.push_back(1);
-    else
-        this->pingnode_detail.gateway_type.push_back(0);
-    if (!parts.empty())
-        this->pingnode_detail.request_id.push_back(static_cast<size_t>(std::stoul(parts[0])));
-    this->pingnode_detail.meter_serial_no = DB_parameter.meter_serial_no;
-    this->pingnode_detail.target_mac_address = DB_parameter.meter_mac_address;
-    // Join parts into a single command string for DB storage
-    std::string joined_cmd;
-    for (size_t i = 0; i < parts.size(); ++i)
+    if (execute_query(query_buf) != 0)
     {
-        if (i) joined_cmd += ':';
-        joined_cmd += parts[i];
+        this->print_and_log("[DB] 🗄️ PING SUMMARY ❌ | ReqID=%zu\n", this->DB_parameter.req_id);
+        return;
     }
-    this->pingnode_detail.req_command = joined_cmd;
-    this->pingnode_detail.ping_count = 0;
+
+    this->print_and_log("[DB] 🗄️ PING SUMMARY ✅ | ReqID=%zu%s\n", this->DB_parameter.req_id, rtt_columns ? "" : " | without RTT distribution");
+
+    // Published only once the row says the same
+    nlohmann::json values = {{"sent", summary.sent},          {"received", summary.received},     {"loss_percent", summary.loss_percent},
+                             {"rtt_min_ms", summary.rtt_min_ms}, {"rtt_avg_ms", summary.rtt_avg_ms}, {"rtt_p95_ms", summary.rtt_p95_ms}};
+    this->add_odm_result(true, static_cast<unsigned int>(this->DB_parameter.req_id), status, 0, values);
 }
 
 int Client::validate_response_buffer(uint8_t *tx_buffer, uint8_t *rx_buffer)
@@ -5649,9 +6332,7 @@ int Client::client_hes_cycle_schedule(void)
 {
     this->print_and_log("%s start\n", __FUNCTION__);
 
-    time_t now = time(nullptr);
-    tm timeinfo{};
-    localtime_r(&now, &timeinfo);
+    tm timeinfo = WallClock::local_tm(WallClock::seconds());
 
     int minute = timeinfo.tm_min;
     int hour = timeinfo.tm_hour;
@@ -5683,6 +6364,7 @@ int Client::hes_start_cycle_activiy(const char *gateway_id)
     if (this->insert_update_hes_nms_sync_time(gateway_id, 1) != SUCCESS)
     {
         this->print_and_log("Failed to insert/update HES sync time\n");
+        this->node_table.invalidate(); // NMS holds the gateway, routes may change
         return FAILURE;
     }
 
@@ -5691,16 +6373,14 @@ int Client::hes_start_cycle_activiy(const char *gateway_id)
 
     this->stateInfo.targetState = ClientTargetState::PULL;
 
-    std::map<std::array<uint8_t, 8>, NodeInfo> nodes_info;
-
     // Update gateway details
     this->update_gateway_details(gateway_id);
 
-    // Build node list from DB
-    this->build_node_list_from_db(nodes_info, gateway_id);
+    // Reuse node list across cycles, rebuild from DB only on topology change or TTL
+    this->refresh_node_table(gateway_id);
 
     // Pull missing info for all nodes
-    int ret = this->pull_missing_info_for_all_nodes(nodes_info);
+    int ret = this->pull_missing_info_for_all_nodes(this->node_table.nodes);
 
     this->stateInfo.targetState = ClientTargetState::IDLE;
 
@@ -5733,7 +6413,7 @@ void Client::update_gateway_details(const char *gateway_id)
     this->print_and_log("\n");
 }
 
-void Client::build_node_list_from_db(std::map<std::array<uint8_t, 8>, NodeInfo> &nodes_info, const char *gateway_id)
+void Client::build_node_list_from_db(NodeMap &nodes_info, const char *gateway_id)
 {
     this->print_and_log("%s start\n", __FUNCTION__);
 
@@ -5745,12 +6425,81 @@ void Client::build_node_list_from_db(std::map<std::array<uint8_t, 8>, NodeInfo>
 
     // Alternate path from alternate source route network
     this->get_alternate_path_for_all_nodes(nodes_info, gateway_id);
+}
+
+int Client::refresh_node_table(const char *gateway_id)
+{
+    this->print_and_log("%s start\n", __FUNCTION__);
+
+    NodeTable &table = this->node_table;
+
+    try
+    {
+        table.ttl_sec = Utility::readConfig<int>("HES.node_table_ttl_sec");
+    }
+    catch (const std::exception &e)
+    {
+        table.ttl_sec = NODE_TABLE_DEFAULT_TTL_SEC;
+    }
+
+    std::string fingerprint;
+    if (this->get_topology_fingerprint(gateway_id, fingerprint) != SUCCESS)
+    {
+        table.invalidate();
+    }
+    else if (table.valid && fingerprint != table.topology_fingerprint)
+    {
+        this->print_and_log("Routing tables changed, rebuilding node table\n");
+        table.invalidate();
+    }
+
+    if (table.valid && table.is_expired())
+    {
+        this->print_and_log("Node table TTL expired, rebuilding\n");
+        table.invalidate();
+    }
+
+    if (!table.valid)
+    {
+        NodeMap fresh;
+        fresh.reserve(table.nodes.size());
+
+        this->build_node_list_from_db(fresh, gateway_id);
+
+        // Recycle profile buffers and scaler state of nodes still in the network
+        for (auto &kv : fresh)
+        {
+            auto old = table.nodes.find(kv.first);
+            if (old != table.nodes.end())
+            {
+                kv.second.profile_data = std::move(old->second.profile_data);
+                kv.second.scalar_loaded = old->second.scalar_loaded;
+
+                // Failure history only holds while the route is the same
+                if (old->second.primary_path.path == kv.second.primary_path.path)
+                    kv.second.health = old->second.health;
+            }
+        }
+
+        table.nodes = std::move(fresh);
+        table.topology_fingerprint = fingerprint;
+        table.loaded_at = std::chrono::steady_clock::now();
+        table.valid = !fingerprint.empty();
+
+        this->print_and_log("Node table rebuilt: %zu nodes\n", table.nodes.size());
+    }
+    else
+    {
+        this->print_and_log("Reusing node table: %zu nodes\n", table.nodes.size());
+    }
 
     // Get all missing cycle information (Nameplate, Scalars, IFV, IP, BLP, DLP, BHP)
-    this->get_missing_info_for_all_nodes(nodes_info, gateway_id);
+    this->get_missing_info_for_all_nodes(table.nodes, gateway_id);
+
+    return SUCCESS;
 }
 
-void Client::add_gateway_node_to_map_list(std::map<std::array<uint8_t, 8>, NodeInfo> &nodes_info, const char *gateway_id)
+void Client::add_gateway_node_to_map_list(NodeMap &nodes_info, const char *gateway_id)
 {
     this->print_and_log("%s start\n", __FUNCTION__);
 
@@ -5773,12 +6522,12 @@ void Client::add_gateway_node_to_map_list(std::map<std::array<uint8_t, 8>, NodeI
         this->print_and_log(" %02X", b);
     this->print_and_log("\n");
 
-    nodes_info[gateway_mac] = std::move(gateway_node);
+    nodes_info[PullData::mac_to_key(gateway_mac)] = std::move(gateway_node);
 
     return;
 }
 
-void Client::get_alternate_path_for_all_nodes(std::map<std::array<uint8_t, 8>, NodeInfo> &nodes_info, const char *gateway_id)
+void Client::get_alternate_path_for_all_nodes(NodeMap &nodes_info, const char *gateway_id)
 {
     this->print_and_log("%s start\n", __FUNCTION__);
 
@@ -5786,7 +6535,7 @@ void Client::get_alternate_path_for_all_nodes(std::map<std::array<uint8_t, 8>, N
 
     for (auto &kv : nodes_info)
     {
-        const std::array<uint8_t, 8> &mac = kv.first;
+        const std::array<uint8_t, 8> &mac = kv.second.node_mac_address;
         NodeInfo &node = kv.second;
 
         if (mac == GATEWAY_MAC)
@@ -5806,28 +6555,49 @@ void Client::get_alternate_path_for_all_nodes(std::map<std::array<uint8_t, 8>, N
     }
 }
 
-void Client::get_missing_info_for_all_nodes(std::map<std::array<uint8_t, 8>, NodeInfo> &nodes_info, const char *gateway_id)
+void Client::get_missing_info_for_all_nodes(NodeMap &nodes_info, const char *gateway_id)
 {
     this->print_and_log("%s start\n", __FUNCTION__);
 
+    CoverageIndex &coverage = CoverageIndex::instance();
+    bool coverage_loaded = coverage.is_gateway_loaded(gateway_id) || (this->load_coverage_index_from_db(gateway_id) == SUCCESS);
+
+    if (coverage_loaded)
+    {
+        std::set<std::array<uint8_t, 8>> macs;
+        for (const auto &kv : nodes_info)
+            macs.insert(kv.second.node_mac_address);
+        coverage.retain_nodes(gateway_id, macs);
+    }
+
     for (auto &kv : nodes_info)
     {
-        const std::array<uint8_t, 8> &mac = kv.first;
+        const std::array<uint8_t, 8> &mac = kv.second.node_mac_address;
         NodeInfo &node = kv.second;
 
         char mac_hex[17] = {0};
         PullData::mac_to_hex(mac, mac_hex);
         this->print_and_log("Get missing info for node: %s\n", mac_hex);
 
-        node.missing_info.missing_ip_cycles = this->get_last_hour_missing_ip_cycles_for_node(node.node_mac_address, gateway_id);
+        if (coverage_loaded)
+        {
+            // Answered from the in-memory coverage index, no SQL
+            node.missing_info.missing_ip_cycles = coverage.get_last_hour_missing_ip_cycles(gateway_id, node.node_mac_address);
+            node.missing_info.is_blp_available = coverage.is_blp_available_last_hour(gateway_id, node.node_mac_address);
+            node.missing_info.is_dlp_available = coverage.is_dlp_available_previous_day(gateway_id, node.node_mac_address);
+            node.missing_info.is_bhp_available = coverage.is_bhp_available_previous_month(gateway_id, node.node_mac_address);
+        }
+        else
+        {
+            node.missing_info.missing_ip_cycles = this->get_last_hour_missing_ip_cycles_for_node(node.node_mac_address, gateway_id);
+            node.missing_info.is_blp_available = this->is_blp_available_last_hour(node.node_mac_address, gateway_id);
+            node.missing_info.is_dlp_available = this->is_dlp_available_previous_day(node.node_mac_address, gateway_id);
+            node.missing_info.is_bhp_available = this->is_bhp_available_previous_month(node.node_mac_address, gateway_id);
+        }
 
-        node.missing_info.is_blp_available = this->is_blp_available_last_hour(node.node_mac_address, gateway_id);
+        this->print_and_log("IP missing cycles: %zu\n", node.missing_info.missing_ip_cycles.size());
         this->print_and_log("BLP: %s\n", node.missing_info.is_blp_available ? "Exists" : "Missing");
-
-        node.missing_info.is_dlp_available = this->is_dlp_available_previous_day(node.node_mac_address, gateway_id);
         this->print_and_log("DLP: %s\n", node.missing_info.is_dlp_available ? "Exists" : "Missing");
-
-        node.missing_info.is_bhp_available = this->is_bhp_available_previous_month(node.node_mac_address, gateway_id);
         this->print_and_log("BHP: %s\n", node.missing_info.is_bhp_available ? "Exists" : "Missing");
 
         node.missing_info.is_name_plate_available = this->is_nameplate_available(node.node_mac_address);
@@ -5836,41 +6606,337 @@ void Client::get_missing_info_for_all_nodes(std::map<std::array<uint8_t, 8>, Nod
         node.missing_info.is_scalar_available = this->is_scalar_profile_available(node.node_mac_address);
         this->print_and_log("Scalar profile: %s\n", node.missing_info.is_scalar_available ? "Exists" : "Missing");
 
-        node.missing_info.is_silenced = this->is_node_silenced(node.node_mac_address, gateway_id);
-        this->print_and_log("Node silenced: %s\n", node.missing_info.is_silenced ? "Yes" : "No");
+        node.missing_info.is_silenced = this->is_node_silenced(node.node_mac_address, gateway_id);
+        this->print_and_log("Node silenced: %s\n", node.missing_info.is_silenced ? "Yes" : "No");
+
+        node.missing_info.verify_ifv_presence = is_ifv_available_for_node(node.node_mac_address, gateway_id);
+        this->print_and_log("IFV: %s\n", node.missing_info.verify_ifv_presence ? "Exists/Entry not present" : "Missing");
+    }
+}
+
+void Client::load_scalar_values_from_db(std::array<uint8_t, 8> meter_sl_number)
+{
+    this->print_and_log("%s start\n", __FUNCTION__);
+
+    char mac_hex[17] = {0};
+    PullData::mac_to_hex(meter_sl_number, mac_hex);
+
+    std::string meter_serial_no(&mac_hex[8], 8);
+    load_scaler_details_from_db(meter_serial_no, this->gateway_id, this);
+}
+
+void Client::load_scalar_for_all_nodes(NodeMap &nodes_info)
+{
+    this->print_and_log("%s start\n", __FUNCTION__);
+
+    for (auto &kv : nodes_info)
+    {
+        this->load_scalar_for_a_node(kv.second);
+    }
+}
+
+void Client::load_scalar_for_a_node(NodeInfo &node)
+{
+    if (node.scalar_loaded)
+        return;
+
+    this->print_and_log("Load scalar for node: %s\n", Utility::mac_to_string(node.node_mac_address.data()).c_str());
+
+    this->load_scalar_values_from_db(node.node_mac_address);
+
+    char mac_hex[17] = {0};
+    PullData::mac_to_hex(node.node_mac_address, mac_hex);
+    node.scalar_loaded = (this->meter_info_map.count(std::string(&mac_hex[8], 8)) != 0);
+}
+
+int Client::pull_missing_info_for_all_nodes(NodeMap &nodes_info)
+{
+    this->print_and_log("%s start\n", __FUNCTION__);
+
+    std::string pull_mode = "node_major";
+    try
+    {
+        pull_mode = Utility::readConfig<std::string>("HES.pull_mode");
+    }
+    catch (const std::exception &e)
+    {
+        this->print_and_log("HES.pull_mode not set, using %s\n", pull_mode.c_str());
+    }
+
+    this->begin_pull_cycle_report(nodes_info);
+
+    int ret = FAILURE;
+    if (pull_mode == "profile_major")
+        ret = this->pull_missing_info_profile_major(nodes_info);
+    else
+        ret = this->pull_missing_info_node_major(nodes_info);
+
+    this->end_pull_cycle_report(nodes_info);
+
+    return ret;
+}
+
+static const char *pull_stage_name[PULL_STAGE_COUNT] = {"Unsilence", "IFV", "Nameplate", "IP", "DLP", "BLP", "BHP"};
+
+void Client::begin_pull_cycle_report(NodeMap &nodes_info)
+{
+    this->print_and_log("%s start\n", __FUNCTION__);
+
+    NodeTable &table = this->node_table;
+
+    try
+    {
+        table.stage_retries = Utility::readConfig<int>("HES.pull_stage_retries");
+        table.quarantine_after = Utility::readConfig<int>("HES.pull_quarantine_after");
+        table.quarantine_cycles = Utility::readConfig<int>("HES.pull_quarantine_cycles");
+    }
+    catch (const std::exception &e)
+    {
+        this->print_and_log("Pull retry/quarantine config: %s, using defaults\n", e.what());
+    }
+
+    PullCycleReport &report = table.last_report;
+    report = PullCycleReport{};
+    report.started = std::time(nullptr);
+    report.nodes = nodes_info.size();
+
+    for (auto &kv : nodes_info)
+    {
+        NodePullHealth &health = kv.second.health;
+        health.answered = false;
+        health.failed = false;
+
+        if (health.quarantine_cycles > 0)
+        {
+            report.quarantined++;
+        }
+    }
+}
+
+void Client::end_pull_cycle_report(NodeMap &nodes_info)
+{
+    this->print_and_log("%s start\n", __FUNCTION__);
+
+    NodeTable &table = this->node_table;
+    PullCycleReport &report = table.last_report;
+
+    // Interrupted cycles (gateway lost / ODM) say nothing about the nodes
+    bool completed = (this->gatewayStatus == Status::CONNECTED && ODM_Flag != 1);
+
+    for (auto &kv : nodes_info)
+    {
+        NodeInfo &node = kv.second;
+        NodePullHealth &health = node.health;
+
+        if (health.quarantine_cycles > 0)
+        {
+            health.quarantine_cycles--;
+            continue;
+        }
+
+        if (!completed)
+            continue;
+
+        if (health.answered)
+        {
+            health.failed_cycles = 0;
+        }
+        else if (health.failed)
+        {
+            report.unreachable++;
+
+            if (++health.failed_cycles >= table.quarantine_after)
+            {
+                health.failed_cycles = 0;
+                health.quarantine_cycles = table.quarantine_cycles;
+
+                this->print_and_log("Node quarantined for %d cycles: ", health.quarantine_cycles);
+                this->print_data_in_hex(node.node_mac_address.data(), 8);
+            }
+        }
+    }
+
+    report.finished = std::time(nullptr);
+
+    this->print_and_log("Pull cycle report: nodes=%zu quarantined=%d unreachable=%d duration=%lds%s\n",
+                        report.nodes, report.quarantined, report.unreachable,
+                        static_cast<long>(report.finished - report.started), completed ? "" : " (interrupted)");
+
+    for (int i = 0; i < PULL_STAGE_COUNT; i++)
+    {
+        const PullStageCount &count = report.stages[i];
+        this->print_and_log("  %-10s completed=%d skipped=%d failed=%d\n", pull_stage_name[i], count.completed, count.skipped, count.failed);
+    }
+}
+
+int Client::run_pull_stage(NodeInfo &node, PullStage stage)
+{
+    NodePullHealth &health = node.health;
+
+    if (health.quarantine_cycles > 0)
+    {
+        return PULL_SKIPPED;
+    }
+
+    int (Client::*handler)(NodeInfo &) = nullptr;
+
+    switch (stage)
+    {
+        case PULL_STAGE_UNSILENCE:
+            handler = &Client::unsilence_node;
+            break;
+        case PULL_STAGE_IFV:
+            handler = &Client::pull_missing_internal_firmware_version_for_a_node;
+            break;
+        case PULL_STAGE_NAMEPLATE:
+            handler = &Client::pull_missing_nameplate_for_a_node;
+            break;
+        case PULL_STAGE_IP:
+            handler = &Client::pull_missing_instantaneous_for_a_node;
+            break;
+        case PULL_STAGE_DLP:
+            handler = &Client::pull_missing_daily_load_for_a_node;
+            break;
+        case PULL_STAGE_BLP:
+            handler = &Client::pull_missing_block_load_for_a_node;
+            break;
+        case PULL_STAGE_BHP:
+            handler = &Client::pull_missing_billing_history_for_a_node;
+            break;
+        default:
+            return FAILURE;
+    }
+
+    int ret = (this->*handler)(node);
+
+    // Retry budget only for nodes known to be reachable in this cycle
+    int retries = health.answered ? this->node_table.stage_retries : 0;
+    while (ret == FAILURE && retries-- > 0 && this->gatewayStatus == Status::CONNECTED && ODM_Flag != 1)
+    {
+        this->print_and_log("Retrying %s for node\n", pull_stage_name[stage]);
+        ret = (this->*handler)(node);
+    }
+
+    PullStageCount &count = this->node_table.last_report.stages[stage];
+
+    switch (ret)
+    {
+        case SUCCESS:
+            count.completed++;
+            health.answered = true;
+            health.stage_failures[stage] = 0;
+            break;
+
+        case PULL_SKIPPED:
+            count.skipped++;
+            break;
+
+        default:
+            count.failed++;
+            health.failed = true;
+            if (health.stage_failures[stage] < UINT8_MAX)
+                health.stage_failures[stage]++;
+
+            this->print_and_log("%s failed for node (%u consecutive cycles)\n", pull_stage_name[stage], health.stage_failures[stage]);
+            ret = FAILURE;
+            break;
+    }
+
+    return ret;
+}
+
+int Client::pull_missing_info_node_major(NodeMap &nodes_info)
+{
+    this->print_and_log("%s start\n", __FUNCTION__);
+
+    // Scalar profiles are fetched gateway wide, refresh them before the node sessions
+    if (this->check_for_scalar_profile(this->gateway_id))
+    {
+        if (this->pull_scalar_profile() == FAILURE)
+        {
+            this->stateInfo.currentState = ClientCurrentState::IDLE;
+            this->print_and_log("Pull scalar profile failed\n");
+            return FAILURE;
+        }
+    }
+
+    for (auto &kv : nodes_info)
+    {
+        if (this->pull_missing_info_for_a_node(kv.second) != SUCCESS)
+        {
+            this->stateInfo.currentState = ClientCurrentState::IDLE;
+            this->print_and_log("Gateway disconnected or ODM_Flag set. Exiting.\n");
+            return FAILURE;
+        }
+    }
+
+    this->print_and_log("%s completed successfully\n", __FUNCTION__);
 
-        node.missing_info.verify_ifv_presence = is_ifv_available_for_node(node.node_mac_address, gateway_id);
-        this->print_and_log("IFV: %s\n", node.missing_info.verify_ifv_presence ? "Exists/Entry not present" : "Missing");
-    }
+    this->stateInfo.currentState = ClientCurrentState::IDLE;
+    return SUCCESS;
 }
 
-void Client::load_scalar_values_from_db(std::array<uint8_t, 8> meter_sl_number)
+/*
+ * One session per node: every missing profile is read back to back on the
+ * node's best path, so the route and the DLMS association set up by the
+ * first request are reused by the following ones. A node that has not
+ * answered any request in this session is left for the next cycle after
+ * its first failure.
+ * Returns FAILURE only when the cycle has to stop (gateway gone / ODM).
+ */
+int Client::pull_missing_info_for_a_node(NodeInfo &node)
 {
     this->print_and_log("%s start\n", __FUNCTION__);
 
-    char mac_hex[17] = {0};
-    PullData::mac_to_hex(meter_sl_number, mac_hex);
+    this->print_and_log("Node session: ");
+    this->print_data_in_hex(node.node_mac_address.data(), 8);
 
-    std::string meter_serial_no(&mac_hex[8], 8);
-    load_scaler_details_from_db(meter_serial_no, this->gateway_id, this);
-}
+    if (node.health.quarantine_cycles > 0)
+    {
+        this->print_and_log("Node in quarantine for %d more cycles. Skipping.\n", node.health.quarantine_cycles);
+        return SUCCESS;
+    }
 
-void Client::load_scalar_for_all_nodes(std::map<std::array<uint8_t, 8>, NodeInfo> &nodes_info)
-{
-    this->print_and_log("%s start\n", __FUNCTION__);
+    bool nameplate_pulled = false;
 
-    for (auto &kv : nodes_info)
+    for (int i = 0; i < PULL_STAGE_COUNT; i++)
     {
-        const std::array<uint8_t, 8> &mac = kv.first;
-        NodeInfo &node = kv.second;
+        PullStage stage = static_cast<PullStage>(i);
+
+        // Scalers must be present before any profile value is stored
+        if (stage == PULL_STAGE_IP)
+        {
+            if (nameplate_pulled && this->check_for_scalar_profile(this->gateway_id))
+            {
+                this->pull_scalar_profile();
+            }
+
+            this->load_scalar_for_a_node(node);
+        }
+
+        int ret = this->run_pull_stage(node, stage);
+
+        if (stage == PULL_STAGE_NAMEPLATE && ret == SUCCESS)
+        {
+            nameplate_pulled = true;
+        }
 
-        this->print_and_log("Load scalar for node: %s\n", Utility::mac_to_string(mac.data()).c_str());
+        if (this->gatewayStatus == Status::DISCONNECTED || ODM_Flag == 1)
+        {
+            return FAILURE;
+        }
 
-        this->load_scalar_values_from_db(node.node_mac_address);
+        if (ret == FAILURE && !node.health.answered)
+        {
+            this->print_and_log("Node not reachable in this session, moving to next node\n");
+            break;
+        }
     }
+
+    return SUCCESS;
 }
 
-int Client::pull_missing_info_for_all_nodes(std::map<std::array<uint8_t, 8>, NodeInfo> &nodes_info)
+int Client::pull_missing_info_profile_major(NodeMap &nodes_info)
 {
     this->print_and_log("%s start\n", __FUNCTION__);
 
@@ -5942,7 +7008,7 @@ int Client::pull_missing_info_for_all_nodes(std::map<std::array<uint8_t, 8>, Nod
     return SUCCESS;
 }
 
-int Client::try_paths_for_profile_pull(NodeInfo &node, std::vector<uint8_t> (Client::*frame_fn)(uint8_t), uint8_t &page_index, const char *profile_name)
+int Client::try_paths_for_profile_pull(NodeInfo &node, FrameBuffer (Client::*frame_fn)(uint8_t), uint8_t &page_index, const char *profile_name)
 {
     this->print_and_log("Trying primary path for %s\n", profile_name);
 
@@ -6013,7 +7079,7 @@ int Client::try_paths_for_profile_pull(NodeInfo &node, std::vector<uint8_t> (Cli
     return FAILURE;
 }
 
-int Client::pull_profile_pages_on_path(const PathInfo &path, std::vector<uint8_t> (Client::*frame_fn)(uint8_t), uint8_t &page_index, NodeInfo &node)
+int Client::pull_profile_pages_on_path(const PathInfo &path, FrameBuffer (Client::*frame_fn)(uint8_t), uint8_t &page_index, NodeInfo &node)
 {
     this->print_and_log("%s start\n", __FUNCTION__);
 
@@ -6029,7 +7095,7 @@ int Client::pull_profile_pages_on_path(const PathInfo &path, std::vector<uint8_t
 
         this->print_and_log("Requesting page %u on path (hop_count=%d)\n", page_index, path.hop_count);
 
-        std::vector<uint8_t> dlms_cmd = (this->*frame_fn)(page_index);
+        FrameBuffer dlms_cmd = (this->*frame_fn)(page_index);
 
         int ret = this->transmit_command_on_path_pmesh(MESH_DATA_QUERY, dlms_cmd, path, 3);
 
@@ -6082,10 +7148,10 @@ int Client::pull_profile_pages_on_path(const PathInfo &path, std::vector<uint8_t
     return FAILURE;
 }
 
-int Client::transmit_command_on_path_pmesh(uint8_t packet_type, const std::vector<uint8_t> &cmd, PathInfo const &path, int timeout_retries)
+int Client::transmit_command_on_path_pmesh(uint8_t packet_type, ByteSpan cmd, PathInfo const &path, int timeout_retries)
 {
     this->print_and_log("%s start\n", __FUNCTION__);
-    std::vector<uint8_t> packet = this->frame_pmesh_command_packet(packet_type, path, cmd);
+    FrameBuffer packet = this->frame_pmesh_command_packet(packet_type, path, cmd);
     return this->transmit_command_and_validate_response(packet, timeout_retries);
 }
 
@@ -6100,48 +7166,49 @@ int Client::perform_flash_and_reset(NodeInfo &node, PathInfo const &path)
     return SUCCESS;
 }
 
-int Client::unsilence_all_nodes(std::map<std::array<uint8_t, 8>, NodeInfo> &nodes_info)
+int Client::unsilence_node(NodeInfo &node)
 {
-    this->print_and_log("%s start\n", __FUNCTION__);
+    this->print_and_log("Processing unsilence for node: ");
+    this->print_data_in_hex(node.node_mac_address.data(), 8);
 
-    for (auto it = nodes_info.begin(); it != nodes_info.end(); ++it)
+    if (node.missing_info.is_silenced != true)
     {
-        auto &mac = it->first;
-        auto &node = it->second;
-
-        this->print_and_log("Processing unsilence for node: ");
-        this->print_data_in_hex(mac.data(), 8);
+        this->print_and_log("Node is not silenced. Skipping.\n");
+        return PULL_SKIPPED;
+    }
 
-        if (node.missing_info.is_silenced == true)
-        {
-            int fuota_status = this->check_fuota_status(node);
-            if (fuota_status == SUCCESS)
-            {
-                this->delete_node_from_unsilence_nodes_from_fuota(mac, this->gateway_id);
-            }
-            else if (fuota_status == ENABLED)
-            {
-                int result = this->fuota_disable_for_a_node(node);
-                if (result == SUCCESS)
-                {
-                    this->print_and_log("Unsilence command success -> updating DB\n");
-                    this->delete_node_from_unsilence_nodes_from_fuota(mac, this->gateway_id);
-                }
-                else
-                {
-                    this->print_and_log("Unsilence command failed -> not updating DB\n");
-                }
-            }
-            else
-            {
-                this->print_and_log("Node FUOTA status unknown: %d\n", fuota_status);
-            }
-        }
-        else
+    int fuota_status = this->check_fuota_status(node);
+    if (fuota_status == SUCCESS)
+    {
+        this->delete_node_from_unsilence_nodes_from_fuota(node.node_mac_address, this->gateway_id);
+        return SUCCESS;
+    }
+    else if (fuota_status == ENABLED)
+    {
+        int result = this->fuota_disable_for_a_node(node);
+        if (result == SUCCESS)
         {
-            this->print_and_log("Node is not silenced. Skipping.\n");
+            this->print_and_log("Unsilence command success -> updating DB\n");
+            this->delete_node_from_unsilence_nodes_from_fuota(node.node_mac_address, this->gateway_id);
+            return SUCCESS;
         }
 
+        this->print_and_log("Unsilence command failed -> not updating DB\n");
+        return FAILURE;
+    }
+
+    this->print_and_log("Node FUOTA status unknown: %d\n", fuota_status);
+    return FAILURE;
+}
+
+int Client::unsilence_all_nodes(NodeMap &nodes_info)
+{
+    this->print_and_log("%s start\n", __FUNCTION__);
+
+    for (auto &kv : nodes_info)
+    {
+        this->run_pull_stage(kv.second, PULL_STAGE_UNSILENCE);
+
         if (this->gatewayStatus == Status::DISCONNECTED || ODM_Flag == 1)
         {
             this->print_and_log("Gateway disconnected or ODM_Flag set. Exiting.\n");
@@ -6424,36 +7491,35 @@ int Client::pull_internal_firmware_version_for_a_node(NodeInfo &node)
     return FAILURE;
 }
 
-int Client::pull_missing_internal_firmware_version_for_all_nodes(std::map<std::array<uint8_t, 8>, NodeInfo> &nodes_info)
+int Client::pull_missing_internal_firmware_version_for_a_node(NodeInfo &node)
 {
-    this->print_and_log("%s start\n", __FUNCTION__);
+    this->print_and_log("Processing internal firmware version for node: ");
+    this->print_data_in_hex(node.node_mac_address.data(), 8);
 
-    for (auto it = nodes_info.begin(); it != nodes_info.end(); ++it)
+    if (node.missing_info.verify_ifv_presence != 0)
     {
-        auto &mac = it->first;
-        auto &node = it->second;
+        this->print_and_log("Internal firmware version already present. Skipping.\n");
+        return PULL_SKIPPED;
+    }
 
-        this->print_and_log("Processing internal firmware version for node: ");
-        this->print_data_in_hex(mac.data(), 8);
+    if (this->pull_internal_firmware_version_for_a_node(node) != SUCCESS)
+    {
+        this->print_and_log("Internal firmware version read failed -> not updating DB\n");
+        return FAILURE;
+    }
 
-        if (node.missing_info.verify_ifv_presence == 0)
-        {
-            int result = this->pull_internal_firmware_version_for_a_node(node);
+    this->print_and_log("Internal firmware version read success -> updating DB\n");
+    this->update_internal_firmware_version_in_meter_details(node.node_mac_address, this->gateway_id, node.profile_data.internal_firmware_version);
+    return SUCCESS;
+}
 
-            if (result == SUCCESS)
-            {
-                this->print_and_log("Internal firmware version read success -> updating DB\n");
-                this->update_internal_firmware_version_in_meter_details(mac, this->gateway_id, node.profile_data.internal_firmware_version);
-            }
-            else
-            {
-                this->print_and_log("Internal firmware version read failed -> not updating DB\n");
-            }
-        }
-        else
-        {
-            this->print_and_log("Internal firmware version already present. Skipping.\n");
-        }
+int Client::pull_missing_internal_firmware_version_for_all_nodes(NodeMap &nodes_info)
+{
+    this->print_and_log("%s start\n", __FUNCTION__);
+
+    for (auto &kv : nodes_info)
+    {
+        this->run_pull_stage(kv.second, PULL_STAGE_IFV);
 
         if (this->gatewayStatus == Status::DISCONNECTED || ODM_Flag == 1)
         {
@@ -6480,30 +7546,34 @@ int Client::pull_nameplate_for_a_node(NodeInfo &node)
     return ret;
 }
 
-int Client::pull_missing_nameplate_for_all_nodes(std::map<std::array<uint8_t, 8>, NodeInfo> &nodes_info)
+int Client::pull_missing_nameplate_for_a_node(NodeInfo &node)
 {
-    this->print_and_log("%s start\n", __FUNCTION__);
+    this->print_and_log("Processing nameplate for node: ");
+    this->print_data_in_hex(node.node_mac_address.data(), 8);
 
-    for (auto it = nodes_info.begin(); it != nodes_info.end(); ++it)
+    if (node.missing_info.is_name_plate_available == true)
     {
-        auto &mac = it->first;
-        auto &node = it->second;
+        this->print_and_log("Nameplate already present. Skipping.\n");
+        return PULL_SKIPPED;
+    }
 
-        this->print_and_log("Processing nameplate for node: ");
-        this->print_data_in_hex(mac.data(), 8);
+    if (this->pull_nameplate_for_a_node(node) != SUCCESS)
+    {
+        return FAILURE;
+    }
 
-        if (node.missing_info.is_name_plate_available != true)
-        {
-            if (this->pull_nameplate_for_a_node(node) == SUCCESS)
-            {
-                this->insert_name_plate_data(mac, this->gateway_id, &node.profile_data.name_plate_profile);
-                node.profile_data.name_plate_profile.clear();
-            }
-        }
-        else
-        {
-            this->print_and_log("Nameplate already present. Skipping.\n");
-        }
+    this->insert_name_plate_data(node.node_mac_address, this->gateway_id, &node.profile_data.name_plate_profile);
+    node.profile_data.name_plate_profile.clear();
+    return SUCCESS;
+}
+
+int Client::pull_missing_nameplate_for_all_nodes(NodeMap &nodes_info)
+{
+    this->print_and_log("%s start\n", __FUNCTION__);
+
+    for (auto &kv : nodes_info)
+    {
+        this->run_pull_stage(kv.second, PULL_STAGE_NAMEPLATE);
 
         if (this->gatewayStatus == Status::DISCONNECTED || ODM_Flag == 1)
         {
@@ -6530,30 +7600,34 @@ int Client::pull_daily_load_profile_for_a_node(NodeInfo &node)
     return ret;
 }
 
-int Client::pull_missing_daily_load_for_all_nodes(std::map<std::array<uint8_t, 8>, NodeInfo> &nodes_info)
+int Client::pull_missing_daily_load_for_a_node(NodeInfo &node)
 {
-    this->print_and_log("%s start\n", __FUNCTION__);
+    this->print_and_log("Processing daily load profile for node: ");
+    this->print_data_in_hex(node.node_mac_address.data(), 8);
+
+    if (node.missing_info.is_dlp_available == true)
+    {
+        this->print_and_log("Daily load profile already present. Skipping.\n");
+        return PULL_SKIPPED;
+    }
 
-    for (auto it = nodes_info.begin(); it != nodes_info.end(); ++it)
+    if (this->pull_daily_load_profile_for_a_node(node) != SUCCESS)
     {
-        auto &mac = it->first;
-        auto &node = it->second;
+        return FAILURE;
+    }
 
-        this->print_and_log("Processing daily load profile for node: ");
-        this->print_data_in_hex(mac.data(), 8);
+    this->insert_daily_load_profile_data(node.node_mac_address, this->gateway_id, node.profile_data.daily_load_profile, 0);
+    node.profile_data.daily_load_profile.clear();
+    return SUCCESS;
+}
 
-        if (node.missing_info.is_dlp_available != true)
-        {
-            if (this->pull_daily_load_profile_for_a_node(node) == SUCCESS)
-            {
-                this->insert_daily_load_profile_data(mac, this->gateway_id, node.profile_data.daily_load_profile, 0);
-                node.profile_data.daily_load_profile.clear();
-            }
-        }
-        else
-        {
-            this->print_and_log("Daily load profile already present. Skipping.\n");
-        }
+int Client::pull_missing_daily_load_for_all_nodes(NodeMap &nodes_info)
+{
+    this->print_and_log("%s start\n", __FUNCTION__);
+
+    for (auto &kv : nodes_info)
+    {
+        this->run_pull_stage(kv.second, PULL_STAGE_DLP);
 
         if (this->gatewayStatus == Status::DISCONNECTED || ODM_Flag == 1)
         {
@@ -6580,31 +7654,35 @@ int Client::pull_block_load_profile_for_a_node(NodeInfo &node)
     return ret;
 }
 
-int Client::pull_missing_block_load_for_all_nodes(std::map<std::array<uint8_t, 8>, NodeInfo> &nodes_info)
+int Client::pull_missing_block_load_for_a_node(NodeInfo &node)
 {
-    this->print_and_log("%s start\n", __FUNCTION__);
+    this->print_and_log("Processing block load profile for node: ");
+    this->print_data_in_hex(node.node_mac_address.data(), 8);
 
-    for (auto it = nodes_info.begin(); it != nodes_info.end(); ++it)
+    if (node.missing_info.is_blp_available == true)
     {
-        auto &mac = it->first;
-        auto &node = it->second;
+        this->print_and_log("Block load profile already present. Skipping.\n");
+        return PULL_SKIPPED;
+    }
 
-        this->print_and_log("Processing block load profile for node: ");
-        this->print_data_in_hex(mac.data(), 8);
+    if (this->pull_block_load_profile_for_a_node(node) != SUCCESS)
+    {
+        return FAILURE;
+    }
 
-        if (node.missing_info.is_blp_available != true)
-        {
-            if (this->pull_block_load_profile_for_a_node(node) == SUCCESS)
-            {
-                int cycle_id = this->calculate_cycle_id_for_block_load();
-                this->insert_block_load_profile_data(mac, this->gateway_id, cycle_id, node.profile_data.block_load_profile, 0);
-                node.profile_data.block_load_profile.clear();
-            }
-        }
-        else
-        {
-            this->print_and_log("Block load profile already present. Skipping.\n");
-        }
+    int cycle_id = this->calculate_cycle_id_for_block_load();
+    this->insert_block_load_profile_data(node.node_mac_address, this->gateway_id, cycle_id, node.profile_data.block_load_profile, 0);
+    node.profile_data.block_load_profile.clear();
+    return SUCCESS;
+}
+
+int Client::pull_missing_block_load_for_all_nodes(NodeMap &nodes_info)
+{
+    this->print_and_log("%s start\n", __FUNCTION__);
+
+    for (auto &kv : nodes_info)
+    {
+        this->run_pull_stage(kv.second, PULL_STAGE_BLP);
 
         if (this->gatewayStatus == Status::DISCONNECTED || ODM_Flag == 1)
         {
@@ -6632,30 +7710,34 @@ int Client::pull_billing_history_profile_for_a_node(NodeInfo &node)
     return ret;
 }
 
-int Client::pull_missing_billing_history_for_all_nodes(std::map<std::array<uint8_t, 8>, NodeInfo> &nodes_info)
+int Client::pull_missing_billing_history_for_a_node(NodeInfo &node)
 {
-    this->print_and_log("%s start\n", __FUNCTION__);
+    this->print_and_log("Processing billing history profile for node: ");
+    this->print_data_in_hex(node.node_mac_address.data(), 8);
 
-    for (auto it = nodes_info.begin(); it != nodes_info.end(); ++it)
+    if (node.missing_info.is_bhp_available == true)
     {
-        auto &mac = it->first;
-        auto &node = it->second;
+        this->print_and_log("Billing history profile already present. Skipping.\n");
+        return PULL_SKIPPED;
+    }
 
-        this->print_and_log("Processing billing history profile for node: ");
-        this->print_data_in_hex(mac.data(), 8);
+    if (this->pull_billing_history_profile_for_a_node(node) != SUCCESS)
+    {
+        return FAILURE;
+    }
 
-        if (node.missing_info.is_bhp_available != true)
-        {
-            if (this->pull_billing_history_profile_for_a_node(node) == SUCCESS)
-            {
-                this->insert_billing_history_profile_data(mac, this->gateway_id, node.profile_data.billing_history, 0);
-                node.profile_data.billing_history.clear();
-            }
-        }
-        else
-        {
-            this->print_and_log("Billing history profile already present. Skipping.\n");
-        }
+    this->insert_billing_history_profile_data(node.node_mac_address, this->gateway_id, node.profile_data.billing_history, 0);
+    node.profile_data.billing_history.clear();
+    return SUCCESS;
+}
+
+int Client::pull_missing_billing_history_for_all_nodes(NodeMap &nodes_info)
+{
+    this->print_and_log("%s start\n", __FUNCTION__);
+
+    for (auto &kv : nodes_info)
+    {
+        this->run_pull_stage(kv.second, PULL_STAGE_BHP);
 
         if (this->gatewayStatus == Status::DISCONNECTED || ODM_Flag == 1)
         {
@@ -6688,12 +7770,15 @@ int Client::pull_missing_instantaneous_for_a_node(NodeInfo &node)
 {
     this->print_and_log("%s start\n", __FUNCTION__);
 
+    this->print_and_log("Processing instantaneous profile for node: ");
+    this->print_data_in_hex(node.node_mac_address.data(), 8);
+
     auto &missing_cycles = node.missing_info.missing_ip_cycles;
 
     if (missing_cycles.empty())
     {
-        this->print_and_log("List empty\n");
-        return SUCCESS;
+        this->print_and_log("No missing instantaneous profile cycles. Skipping.\n");
+        return PULL_SKIPPED;
     }
 
     if (missing_cycles.size() > 4)
@@ -6720,33 +7805,18 @@ int Client::pull_missing_instantaneous_for_a_node(NodeInfo &node)
         }
     }
 
+    this->print_and_log("Pull missings cycles for a node is successful\n");
+    node.profile_data.instantaneous_profile.clear();
     return SUCCESS;
 }
 
-int Client::pull_missing_ip_profile_for_all_nodes(std::map<std::array<uint8_t, 8>, NodeInfo> &nodes_info)
+int Client::pull_missing_ip_profile_for_all_nodes(NodeMap &nodes_info)
 {
     this->print_and_log("%s start\n", __FUNCTION__);
 
     for (auto &kv : nodes_info)
     {
-        auto &mac = kv.first;
-        NodeInfo &node = kv.second;
-
-        this->print_and_log("Processing instantaneous profile for node: ");
-        this->print_data_in_hex(mac.data(), 8);
-
-        if (!node.missing_info.missing_ip_cycles.empty())
-        {
-            if (this->pull_missing_instantaneous_for_a_node(node) == SUCCESS)
-            {
-                this->print_and_log("Pull missings cycles for a node is successful\n");
-                node.profile_data.instantaneous_profile.clear();
-            }
-        }
-        else
-        {
-            this->print_and_log("No missing instantaneous profile cycles. Skipping.\n");
-        }
+        this->run_pull_stage(kv.second, PULL_STAGE_IP);
 
         if (this->gatewayStatus == Status::DISCONNECTED || ODM_Flag == 1)
         {
@@ -6790,38 +7860,35 @@ int Client::pull_missing_ip_profile_for_all_nodes(std::map<std::array<uint8_t, 8
     return packet;
 } */
 
-std::vector<uint8_t> Client::frame_pmesh_command_packet(uint8_t packet_type, PathInfo const &path_info, const std::vector<uint8_t> &cmd)
+FrameBuffer Client::frame_pmesh_command_packet(uint8_t packet_type, PathInfo const &path_info, ByteSpan cmd)
 {
     this->print_and_log("%s start\n", __FUNCTION__);
 
-    // Build packet safely using push_back/insert to avoid out-of-bounds writes.
-    std::vector<uint8_t> packet;
-    packet.reserve(256);
+    // Pooled frame, appends past FRAME_BUFFER_SIZE are dropped instead of written out of bounds
+    FrameBuffer packet;
 
     // Header
-    packet.push_back(HES_START_BYTE);
-    packet.push_back(0x00); // placeholder for LENGTH
-    packet.push_back(packet_type);
+    packet.push(HES_START_BYTE);
+    packet.push(0x00); // placeholder for LENGTH
+    packet.push(packet_type);
 
     // PAN ID (4 bytes)
-    packet.insert(packet.end(), this->gateway_details.panid.begin(), this->gateway_details.panid.end());
+    packet.push(this->gateway_details.panid.data(), this->gateway_details.panid.size());
 
     // Serial number (last 4 bytes)
-    packet.insert(packet.end(), this->gateway_details.serial_number.begin() + 4, this->gateway_details.serial_number.end());
+    packet.push(this->gateway_details.serial_number.data() + 4, this->gateway_details.serial_number.size() - 4);
 
     // Router index
-    packet.push_back(0x00);
+    packet.push(0x00);
 
     // Hop count
-    packet.push_back(static_cast<uint8_t>(path_info.hop_count));
+    packet.push(static_cast<uint8_t>(path_info.hop_count));
 
     // Path bytes (if any)
-    if (!path_info.path.empty())
-        packet.insert(packet.end(), path_info.path.begin(), path_info.path.end());
+    packet.push(path_info.path.data(), path_info.path.size());
 
     // Command payload
-    if (!cmd.empty())
-        packet.insert(packet.end(), cmd.begin(), cmd.end());
+    packet.push(cmd.data(), cmd.size());
 
     // Set length (exclude start byte)
     if (packet.size() >= 2)
@@ -6830,11 +7897,11 @@ std::vector<uint8_t> Client::frame_pmesh_command_packet(uint8_t packet_type, Pat
     return packet;
 }
 
-std::vector<uint8_t> Client::frame_dlms_nameplate_command_packet(uint8_t page_index)
+FrameBuffer Client::frame_dlms_nameplate_command_packet(uint8_t page_index)
 {
     this->print_and_log("%s start\n", __FUNCTION__);
 
-    std::vector<uint8_t> packet;
+    FrameBuffer packet;
     packet.resize(8);
     size_t pos = 0;
 
@@ -6860,7 +7927,7 @@ std::vector<uint8_t> Client::frame_dlms_nameplate_command_packet(uint8_t page_in
     return packet;
 }
 
-std::vector<uint8_t> Client::frame_dlms_ip_command_packet(uint8_t page_index)
+FrameBuffer Client::frame_dlms_ip_command_packet(uint8_t page_index)
 {
     this->print_and_log("%s start\n", __FUNCTION__);
 
@@ -6869,7 +7936,7 @@ std::vector<uint8_t> Client::frame_dlms_ip_command_packet(uint8_t page_index)
         this->print_and_log("Invalid IP cycle %d (expected 0-3)\n", this->current_ip_cycle);
     }
 
-    std::vector<uint8_t> packet;
+    FrameBuffer packet;
     packet.resize(8);
     size_t pos = 0;
 
@@ -6895,11 +7962,11 @@ std::vector<uint8_t> Client::frame_dlms_ip_command_packet(uint8_t page_index)
     return packet;
 }
 
-std::vector<uint8_t> Client::frame_dlms_dlp_command_packet(uint8_t page_index)
+FrameBuffer Client::frame_dlms_dlp_command_packet(uint8_t page_index)
 {
     this->print_and_log("%s start\n", __FUNCTION__);
 
-    std::vector<uint8_t> packet;
+    FrameBuffer packet;
     packet.resize(128);
     size_t pos = 0;
 
@@ -6949,11 +8016,11 @@ std::vector<uint8_t> Client::frame_dlms_dlp_command_packet(uint8_t page_index)
     return packet;
 }
 
-std::vector<uint8_t> Client::frame_dlms_blp_command_packet(uint8_t page_index)
+FrameBuffer Client::frame_dlms_blp_command_packet(uint8_t page_index)
 {
     this->print_and_log("%s start\n", __FUNCTION__);
 
-    std::vector<uint8_t> packet;
+    FrameBuffer packet;
     packet.resize(128);
     size_t pos = 0;
 
@@ -7006,11 +8073,11 @@ std::vector<uint8_t> Client::frame_dlms_blp_command_packet(uint8_t page_index)
     return packet;
 }
 
-std::vector<uint8_t> Client::frame_dlms_bhp_command_packet(uint8_t page_index)
+FrameBuffer Client::frame_dlms_bhp_command_packet(uint8_t page_index)
 {
     this->print_and_log("%s start\n", __FUNCTION__);
 
-    std::vector<uint8_t> packet;
+    FrameBuffer packet;
     packet.resize(128);
     size_t pos = 0;
 
@@ -7032,8 +8099,8 @@ std::vector<uint8_t> Client::frame_dlms_bhp_command_packet(uint8_t page_index)
     push(0x01); // count = 1
 
     uint8_t checksum = 0;
-    for (uint8_t b : packet)
-        checksum += b;
+    for (size_t i = 0; i < pos; ++i)
+        checksum += packet[i];
     push(checksum);
 
     packet.resize(pos); // Final size
@@ -7041,7 +8108,7 @@ std::vector<uint8_t> Client::frame_dlms_bhp_command_packet(uint8_t page_index)
     return packet;
 }
 
-int Client::transmit_command_and_validate_response(std::vector<uint8_t> &buff, uint8_t maxRetries)
+int Client::transmit_command_and_validate_response(FrameBuffer &buff, uint8_t maxRetries)
 {
     this->print_and_log("%s start\n", __FUNCTION__);
 
@@ -7270,7 +8337,6 @@ bool Client::process_NP_case()
 
 bool Client::process_IP_case()
 {
-    char query_buf[MAX_QUERY_BUFFER] = {0};
     uint8_t err_code = 1;
 
     this->validate_IP_for_db();
@@ -7351,6 +8417,83 @@ bool Client::process_IP_case()
     this->print_and_log("[DEBUG IP] push_alaram: %d\n", this->DB_parameter.push_alaram);
     this->print_and_log("[DEBUG IP] error_code: %d\n", err_code);
 
+    InstantaneousRecord record;
+    record.meter_rtc_time = get_string(IP_RTC);
+    record.voltage = get_float(IP_VOLTAGE, voltage);
+    record.phase_current = get_float(IP_PHASE_CURRENT, phase_current);
+    record.neutral_current = get_float(IP_NEUTRAL_CURRENT, neutral_current);
+    record.signed_powerfactor = get_float(IP_SIGNED_POWER_FACTOR, signed_powerfactor);
+    record.frequency = get_float(IP_FREQUENCY, frequency);
+    record.apparent_power_kva = get_float(IP_APPARENT_POWER, apparent_power);
+    record.active_power_kw = get_float(IP_ACTIVE_POWER, active_power);
+    record.cum_energy_kwh_import = get_float(IP_CUMULATIVE_ENERGY_IMPORT_KWH, cum_energy_kwh_import);
+    record.cum_energy_kvah_import = get_float(IP_CUMULATIVE_ENERGY_IMPORT_KVAH, cum_energy_kvah_import);
+    record.maximum_demand_kw = get_float(IP_MAXIMUM_DEMAND_KW, max_demand_kw);
+    record.md_kw_datetime = get_datetime(IP_MAXIMUM_DEMAND_KW_DATE_TIME);
+    record.maximum_demand_kva = get_float(IP_MAXIMUM_DEMAND_KVA, max_demand_kva);
+    record.md_kva_datetime = get_datetime(IP_MAXIMUM_DEMAND_KVA_DATE_TIME);
+    record.cum_power_on_duration = get_float(IP_CUMULATIVE_POWER_ON, power_on_duration);
+    record.cum_tamper_count = get_float(IP_CUMULATIVE_TAMPER_COUNT, tamper_count);
+    record.cum_billing_count = get_float(IP_CUMULATIVE_BILLING_COUNT, billing_count);
+    record.cum_programming_count = get_float(IP_CUMULATIVE_PROGRAMMING_COUNT, programming_count);
+    record.cum_energy_kwh_export = get_float(IP_CUMULATIVE_ENERGY_EXPORT_KWH, cum_energy_kwh_export);
+    record.cum_energy_kvah_export = get_float(IP_CUMULATIVE_ENERGY_EXPORT_KVAH, cum_energy_kvah_export);
+    record.loadlimit_function_sts = load_limit_sts; // ✅  bool→int
+    record.loadlimit_value_kw = get_float(IP_LOAD_LIMIT_VALUE_KW, load_limit_value);
+    record.last_download_time = this->DB_parameter.last_download_time;
+
+    clear_profile_for_type(DATA_TYPE_IP);
+
+    if (this->insert_odm_ip_record(record, err_code) == 0)
+    { // ✅ SUCCESS
+        this->print_and_log("[DB] 🗄️ INSERT ✅ | Type=%u | ReqID=%zu\n", DATA_TYPE_IP, this->DB_parameter.req_id);
+
+        std::array<uint8_t, 8> mac;
+        if (this->DB_parameter.meter_mac_address.size() == 16 && QueuedCommand::decode_hex(this->DB_parameter.meter_mac_address, mac.data(), mac.size()) == 8)
+            ProfileCache::instance().store_ip(mac, record, ProfileSource::ODM);
+    }
+    else
+    { // ✅ FAILURE
+        this->print_and_log("[DB] 🗄️ INSERT ❌ | Type=%u \n", DATA_TYPE_IP);
+    }
+    return true;
+}
+
+static nlohmann::json ip_record_values(const InstantaneousRecord &record)
+{
+    return {{"meter_rtc_time", record.meter_rtc_time},
+            {"voltage", record.voltage},
+            {"phase_current", record.phase_current},
+            {"neutral_current", record.neutral_current},
+            {"signed_powerfactor", record.signed_powerfactor},
+            {"frequency", record.frequency},
+            {"apparent_power_kva", record.apparent_power_kva},
+            {"active_power_kw", record.active_power_kw},
+            {"cum_energy_kwh_import", record.cum_energy_kwh_import},
+            {"cum_energy_kvah_import", record.cum_energy_kvah_import},
+            {"maximum_demand_kw", record.maximum_demand_kw},
+            {"md_kw_datetime", record.md_kw_datetime},
+            {"maximum_demand_kva", record.maximum_demand_kva},
+            {"md_kva_datetime", record.md_kva_datetime},
+            {"cum_power_on_duration", record.cum_power_on_duration},
+            {"cum_tamper_count", record.cum_tamper_count},
+            {"cum_billing_count", record.cum_billing_count},
+            {"cum_programming_count", record.cum_programming_count},
+            {"cum_energy_kwh_export", record.cum_energy_kwh_export},
+            {"cum_energy_kvah_export", record.cum_energy_kvah_export},
+            {"loadlimit_function_sts", record.loadlimit_function_sts},
+            {"loadlimit_value_kw", record.loadlimit_value_kw},
+            {"last_download_time", record.last_download_time}};
+}
+
+/*
+ * ODM instantaneous row for DB_parameter.req_id, from a fresh RF read or
+ * from the profile cache. Returns the execute_query result, 0 on success.
+ */
+int Client::insert_odm_ip_record(const InstantaneousRecord &record, uint8_t err_code)
+{
+    char query_buf[MAX_QUERY_BUFFER] = {0};
+
     snprintf(query_buf, sizeof(query_buf),
              "INSERT INTO dlms_ip_push_data("
              "meter_serial_number,meter_mac_address,gateway_id,meter_rtc_time,"
@@ -7367,45 +8510,70 @@ bool Client::process_IP_case()
              this->DB_parameter.meter_serial_no.c_str(),
              this->DB_parameter.meter_mac_address.c_str(),
              this->DB_parameter.gateway_id.c_str(),
-             get_string(IP_RTC).c_str(),
-             get_float(IP_VOLTAGE, voltage),
-             get_float(IP_PHASE_CURRENT, phase_current),
-             get_float(IP_NEUTRAL_CURRENT, neutral_current),
-             get_float(IP_SIGNED_POWER_FACTOR, signed_powerfactor),
-             get_float(IP_FREQUENCY, frequency),
-             get_float(IP_APPARENT_POWER, apparent_power),
-             get_float(IP_ACTIVE_POWER, active_power),
-             get_float(IP_CUMULATIVE_ENERGY_IMPORT_KWH, cum_energy_kwh_import),
-             get_float(IP_CUMULATIVE_ENERGY_IMPORT_KVAH, cum_energy_kvah_import),
-             get_float(IP_MAXIMUM_DEMAND_KW, max_demand_kw),
-             get_datetime(IP_MAXIMUM_DEMAND_KW_DATE_TIME).c_str(),
-             get_float(IP_MAXIMUM_DEMAND_KVA, max_demand_kva),
-             get_datetime(IP_MAXIMUM_DEMAND_KVA_DATE_TIME).c_str(),
-             get_float(IP_CUMULATIVE_POWER_ON, power_on_duration),
-             get_float(IP_CUMULATIVE_TAMPER_COUNT, tamper_count),
-             get_float(IP_CUMULATIVE_BILLING_COUNT, billing_count),
-             get_float(IP_CUMULATIVE_PROGRAMMING_COUNT, programming_count),
-             get_float(IP_CUMULATIVE_ENERGY_EXPORT_KWH, cum_energy_kwh_export),
-             get_float(IP_CUMULATIVE_ENERGY_EXPORT_KVAH, cum_energy_kvah_export),
-             load_limit_sts, // ✅  bool→int
-             get_float(IP_LOAD_LIMIT_VALUE_KW, load_limit_value),
-             this->DB_parameter.last_download_time.c_str(),
+             record.meter_rtc_time.c_str(),
+             record.voltage,
+             record.phase_current,
+             record.neutral_current,
+             record.signed_powerfactor,
+             record.frequency,
+             record.apparent_power_kva,
+             record.active_power_kw,
+             record.cum_energy_kwh_import,
+             record.cum_energy_kvah_import,
+             record.maximum_demand_kw,
+             record.md_kw_datetime.c_str(),
+             record.maximum_demand_kva,
+             record.md_kva_datetime.c_str(),
+             record.cum_power_on_duration,
+             record.cum_tamper_count,
+             record.cum_billing_count,
+             record.cum_programming_count,
+             record.cum_energy_kwh_export,
+             record.cum_energy_kvah_export,
+             record.loadlimit_function_sts,
+             record.loadlimit_value_kw,
+             record.last_download_time.c_str(),
              this->DB_parameter.req_id,
              this->DB_parameter.push_alaram,
              err_code);
 
-    clear_profile_for_type(DATA_TYPE_IP);
+    this->odm_result_values[static_cast<unsigned int>(this->DB_parameter.req_id)] = ip_record_values(record);
 
-    int db_result = execute_query(query_buf); // 0=SUCCESS, non-zero=FAILURE
+    return execute_query(query_buf); // 0=SUCCESS, non-zero=FAILURE
+}
 
-    if (db_result == 0)
-    { // ✅ SUCCESS
+/*
+ * Answers an ODM instantaneous read from the profile cache when the request
+ * carries a maximum age and the meter was read recently enough by the pull
+ * cycle, a push or another ODM. The status error_code records the source.
+ */
+bool Client::answer_ip_from_cache(const QueuedCommand &cmd)
+{
+    int max_age_sec = cmd.number(MAX_STALENESS, 0);
+    if (max_age_sec <= 0 || cmd.path_len < 8)
+        return false;
+
+    std::array<uint8_t, 8> mac;
+    memcpy(mac.data(), &cmd.path[cmd.path_len - 8], mac.size());
+
+    InstantaneousRecord record;
+    ProfileSource source;
+    if (!ProfileCache::instance().lookup_ip(mac, max_age_sec, record, source))
+        return false;
+
+    this->print_and_log("[ODM CACHE] REQ_ID=%d answered from cache | source=%d | read at %s\n", cmd.request_id, static_cast<int>(source), record.last_download_time.c_str());
+
+    this->DB_parameter.status = static_cast<uint8_t>(SUCCESS_STATUS);
+    this->DB_parameter.push_alaram = 2; // PULL
+    this->odm_result_values[static_cast<unsigned int>(cmd.request_id)] = ip_record_values(record);
+    this->Update_dlms_on_demand_request_status(cmd.request_id, SUCCESS_STATUS, ODM_CACHE_ERROR_CODE_BASE + static_cast<uint16_t>(source));
+
+    if (this->insert_odm_ip_record(record, 1) == 0)
         this->print_and_log("[DB] 🗄️ INSERT ✅ | Type=%u | ReqID=%zu\n", DATA_TYPE_IP, this->DB_parameter.req_id);
-    }
     else
-    { // ✅ FAILURE
         this->print_and_log("[DB] 🗄️ INSERT ❌ | Type=%u \n", DATA_TYPE_IP);
-    }
+
+    this->DB_parameter = DBparameters();
     return true;
 }
 
@@ -0,0 +1,116 @@
+#include "../inc/command_queue.h"
+
+#include <cstdlib>
+#include <cstring>
+
+bool QueuedCommand::parse(std::string_view cmd)
+{
+    bool fits = cmd.size() < COMMAND_TEXT_MAX;
+    size_t len = fits ? cmd.size() : COMMAND_TEXT_MAX - 1;
+
+    memcpy(this->text, cmd.data(), len);
+    this->text[len] = '\0';
+    this->length = static_cast<uint16_t>(len);
+
+    // Same field boundaries as explode(), the last field keeps any extra ':'
+    this->part_count = 1;
+    this->field_count = 1;
+    this->field_offset[0] = 0;
+    for (size_t i = 0; i < len; i++)
+    {
+        if (this->text[i] != ':')
+            continue;
+
+        this->part_count++;
+        if (this->field_count == COMMAND_FIELDS_MAX)
+            continue;
+
+        this->text[i] = '\0';
+        this->field_length[this->field_count - 1] = static_cast<uint16_t>(i - this->field_offset[this->field_count - 1]);
+        this->field_offset[this->field_count++] = static_cast<uint16_t>(i + 1);
+    }
+    this->field_length[this->field_count - 1] = static_cast<uint16_t>(len - this->field_offset[this->field_count - 1]);
+
+    this->request_id = this->number(0, -1);
+    this->hop_count = this->number(2, 0);
+    this->download_data_type = this->number(4, -1);
+    this->enqueued_at = std::chrono::steady_clock::now();
+
+    // Field indexes as in mqtt.h: 1 gateway, 3 path, 5 command
+    this->gateway_ok = (this->field_size(1) == 2 * sizeof(this->gateway)) &&
+                       (decode_hex(this->view(1), this->gateway, sizeof(this->gateway)) >= 0);
+
+    int decoded = decode_hex(this->view(3), this->path, sizeof(this->path));
+    this->path_ok = (decoded > 0);
+    this->path_len = this->path_ok ? static_cast<uint8_t>(decoded) : 0;
+
+    decoded = decode_hex(this->view(5), this->payload, sizeof(this->payload));
+    this->payload_ok = (decoded >= 0);
+    this->payload_len = this->payload_ok ? static_cast<uint16_t>(decoded) : 0;
+
+    return fits;
+}
+
+static int hex_nibble(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    return -1;
+}
+
+int QueuedCommand::decode_hex(std::string_view hex, uint8_t *out, size_t out_size)
+{
+    if ((hex.size() % 2) != 0 || (hex.size() / 2) > out_size)
+        return -1;
+
+    for (size_t i = 0; i < hex.size(); i += 2)
+    {
+        int high = hex_nibble(hex[i]);
+        int low = hex_nibble(hex[i + 1]);
+        if (high < 0 || low < 0)
+            return -1;
+
+        out[i / 2] = static_cast<uint8_t>((high << 4) | low);
+    }
+    return static_cast<int>(hex.size() / 2);
+}
+
+int QueuedCommand::number(int index, int fallback) const
+{
+    const char *start = this->field(index);
+    char *end = nullptr;
+
+    long value = strtol(start, &end, 10);
+    return (end == start) ? fallback : static_cast<int>(value);
+}
+
+bool QueuedCommand::same_read_as(const QueuedCommand &other) const
+{
+    return this->download_data_type == other.download_data_type && this->hop_count == other.hop_count &&
+           this->path_len == other.path_len && this->payload_len == other.payload_len &&
+           memcmp(this->path, other.path, this->path_len) == 0 && memcmp(this->payload, other.payload, this->payload_len) == 0;
+}
+
+std::string QueuedCommand::raw(void) const
+{
+    std::string cmd;
+    cmd.reserve(this->length);
+
+    for (int i = 0; i < this->field_count; i++)
+    {
+        if (i)
+            cmd += ':';
+        cmd.append(this->field(i), this->field_size(i));
+    }
+    return cmd;
+}
+
+std::vector<uint8_t> QueuedCommand::bytes(void) const
+{
+    std::string cmd = this->raw();
+    return std::vector<uint8_t>(cmd.begin(), cmd.end());
+}
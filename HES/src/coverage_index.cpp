@@ -0,0 +1,187 @@
+#include "../inc/coverage_index.h"
+
+CoverageIndex &CoverageIndex::instance()
+{
+    static CoverageIndex index;
+    return index;
+}
+
+// Local calendar day as days since 1970-01-01 (same clock as NOW()/CURDATE())
+int64_t CoverageIndex::day_number(std::time_t t)
+{
+    std::tm lt{};
+    localtime_r(&t, &lt);
+
+    int64_t y = lt.tm_year + 1900;
+    unsigned m = static_cast<unsigned>(lt.tm_mon + 1);
+    unsigned d = static_cast<unsigned>(lt.tm_mday);
+
+    y -= (m <= 2);
+    const int64_t era = (y >= 0 ? y : y - 399) / 400;
+    const unsigned yoe = static_cast<unsigned>(y - era * 400);
+    const unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+
+    return era * 146097 + static_cast<int64_t>(doe) - 719468;
+}
+
+// Absolute 15-minute cycle: day * 96 + (cycle_id - 1)
+int64_t CoverageIndex::cycle_number(std::time_t t)
+{
+    std::tm lt{};
+    localtime_r(&t, &lt);
+
+    return day_number(t) * COVERAGE_CYCLES_PER_DAY + (lt.tm_hour * 4) + (lt.tm_min / 15);
+}
+
+int64_t CoverageIndex::month_number(int year, int month)
+{
+    return static_cast<int64_t>(year) * 12 + (month - 1);
+}
+
+bool CoverageIndex::is_gateway_loaded(const char *gateway_id)
+{
+    std::lock_guard<std::mutex> lock(this->coverage_mutex);
+    return this->loaded_gateways.count(gateway_id) != 0;
+}
+
+void CoverageIndex::set_gateway_loaded(const char *gateway_id)
+{
+    std::lock_guard<std::mutex> lock(this->coverage_mutex);
+    this->loaded_gateways.insert(gateway_id);
+}
+
+NodeCoverage *CoverageIndex::find_node(const char *gateway_id, const std::array<uint8_t, 8> &mac)
+{
+    auto gw = this->gateways.find(gateway_id);
+    if (gw == this->gateways.end())
+        return nullptr;
+
+    auto node = gw->second.find(mac);
+    if (node == gw->second.end())
+        return nullptr;
+
+    return &node->second;
+}
+
+void CoverageIndex::mark_ip_cycle(const char *gateway_id, const std::array<uint8_t, 8> &mac, int cycle_id, std::time_t at)
+{
+    if (cycle_id < 1 || cycle_id > COVERAGE_CYCLES_PER_DAY)
+        return;
+
+    int64_t now_cycle = cycle_number(at);
+    int64_t day = now_cycle / COVERAGE_CYCLES_PER_DAY;
+    int current_index = static_cast<int>(now_cycle % COVERAGE_CYCLES_PER_DAY);
+
+    // calculate_cycle_id() rounds up to 5 minutes ahead, anything further
+    // ahead of the wall clock belongs to the previous day (e.g. cycle 96
+    // written just after midnight)
+    if ((cycle_id - 1) > current_index + 1)
+        day -= 1;
+
+    std::lock_guard<std::mutex> lock(this->coverage_mutex);
+    this->gateways[gateway_id][mac].ip_cycles.mark(day * COVERAGE_CYCLES_PER_DAY + (cycle_id - 1));
+}
+
+void CoverageIndex::mark_blp(const char *gateway_id, const std::array<uint8_t, 8> &mac, std::time_t at)
+{
+    int64_t slot = cycle_number(at);
+
+    std::lock_guard<std::mutex> lock(this->coverage_mutex);
+    this->gateways[gateway_id][mac].blp_slots.mark(slot);
+}
+
+void CoverageIndex::retain_nodes(const char *gateway_id, const std::set<std::array<uint8_t, 8>> &macs)
+{
+    std::lock_guard<std::mutex> lock(this->coverage_mutex);
+
+    auto gw = this->gateways.find(gateway_id);
+    if (gw == this->gateways.end())
+        return;
+
+    for (auto it = gw->second.begin(); it != gw->second.end();)
+    {
+        if (macs.count(it->first))
+            ++it;
+        else
+            it = gw->second.erase(it);
+    }
+}
+
+void CoverageIndex::mark_dlp_day(const char *gateway_id, const std::array<uint8_t, 8> &mac, std::time_t rtc)
+{
+    int64_t day = day_number(rtc);
+
+    std::lock_guard<std::mutex> lock(this->coverage_mutex);
+    this->gateways[gateway_id][mac].dlp_days.mark(day);
+}
+
+void CoverageIndex::mark_bhp_month(const char *gateway_id, const std::array<uint8_t, 8> &mac, int year, int month)
+{
+    if (month < 1 || month > 12)
+        return;
+
+    std::lock_guard<std::mutex> lock(this->coverage_mutex);
+    this->gateways[gateway_id][mac].bhp_months.mark(month_number(year, month));
+}
+
+std::vector<int> CoverageIndex::get_last_hour_missing_ip_cycles(const char *gateway_id, const std::array<uint8_t, 8> &mac)
+{
+    std::vector<int> missing_cycles;
+    int64_t current = cycle_number(std::time(nullptr));
+
+    std::lock_guard<std::mutex> lock(this->coverage_mutex);
+    NodeCoverage *node = this->find_node(gateway_id, mac);
+
+    // Oldest first, relative 3..0 as returned by the SQL version
+    for (int relative = 3; relative >= 0; relative--)
+    {
+        if (node == nullptr || !node->ip_cycles.test(current - relative))
+            missing_cycles.push_back(relative);
+    }
+
+    return missing_cycles;
+}
+
+bool CoverageIndex::is_blp_available_last_hour(const char *gateway_id, const std::array<uint8_t, 8> &mac)
+{
+    int64_t current = cycle_number(std::time(nullptr));
+
+    std::lock_guard<std::mutex> lock(this->coverage_mutex);
+    NodeCoverage *node = this->find_node(gateway_id, mac);
+    if (node == nullptr)
+        return false;
+
+    for (int i = 0; i < 4; i++)
+    {
+        if (node->blp_slots.test(current - i))
+            return true;
+    }
+
+    return false;
+}
+
+bool CoverageIndex::is_dlp_available_previous_day(const char *gateway_id, const std::array<uint8_t, 8> &mac)
+{
+    int64_t yesterday = day_number(std::time(nullptr)) - 1;
+
+    std::lock_guard<std::mutex> lock(this->coverage_mutex);
+    NodeCoverage *node = this->find_node(gateway_id, mac);
+
+    return (node != nullptr) && node->dlp_days.test(yesterday);
+}
+
+bool CoverageIndex::is_bhp_available_previous_month(const char *gateway_id, const std::array<uint8_t, 8> &mac)
+{
+    std::time_t t = std::time(nullptr);
+    std::tm lt{};
+    localtime_r(&t, &lt);
+
+    int64_t current = month_number(lt.tm_year + 1900, lt.tm_mon + 1);
+
+    std::lock_guard<std::mutex> lock(this->coverage_mutex);
+    NodeCoverage *node = this->find_node(gateway_id, mac);
+
+    // Previous or current billing month, as in the SQL range check
+    return (node != nullptr) && (node->bhp_months.test(current) || node->bhp_months.test(current - 1));
+}
@@ -1,5 +1,11 @@
 #include "../inc/database.h"
 #include "../inc/client.h"
+#include "../inc/coverage_index.h"
+#include "../inc/event_code_dictionary.h"
+#include "../inc/metrics.h"
+#include "../inc/nms_lease.h"
+#include "../inc/profile_cache.h"
+#include <atomic>
 #include <ctime>
 #include <iomanip>
 #include <mutex>
@@ -49,6 +55,7 @@ MySqlDatabase::~MySqlDatabase()
 
     if (this->mysql)
     {
+        this->flush_status_journal();
         mysql_close(this->mysql);
         this->mysql = nullptr;
     }
@@ -78,6 +85,15 @@ void MySqlDatabase::load_mysql_config_from_file(void)
     this->print_and_log("mysql_server_username: %s\n", this->creds.username.c_str());
     this->print_and_log("mysql_server_password: %s\n", this->creds.password.c_str());
 
+    try
+    {
+        this->status_journal.set_window(Utility::readConfig<int>("HES.status_journal_window_ms"));
+    }
+    catch (const std::exception &e)
+    {
+        this->print_and_log("HES.status_journal_window_ms not set, using %d\n", STATUS_JOURNAL_DEFAULT_WINDOW_MS);
+    }
+
     this->connect_to_mysql();
 }
 
@@ -168,9 +184,14 @@ int MySqlDatabase::execute_query(char *query)
     this->print_and_log("Query: %s\n", query);
     MysqlThreadGuard guard;
 
+    auto started = std::chrono::steady_clock::now();
+    std::string statement = Metrics::statement_label(query);
+    LatencyHistogram &latency = Metrics::instance().histogram("hes_db_query_seconds", Metrics::label("statement", statement));
+
     if (!check_and_reconnect())
     {
         this->print_and_log("MySQL not connected. Query cannot be executed.\n");
+        Metrics::instance().counter("hes_db_query_errors_total", Metrics::label("statement", statement)).fetch_add(1, std::memory_order_relaxed);
         return FAILURE;
     }
 
@@ -179,6 +200,7 @@ int MySqlDatabase::execute_query(char *query)
         if (mysql_query(this->mysql, query) == 0)
         {
             this->print_and_log("Query executed successfully.\n");
+            latency.observe_since(started);
             return SUCCESS;
         }
 
@@ -198,73 +220,190 @@ int MySqlDatabase::execute_query(char *query)
         if (mysql_query(this->mysql, query) == 0)
         {
             this->print_and_log("Query re-executed successfully after reconnect.\n");
+            latency.observe_since(started);
             return SUCCESS;
         }
     }
 
     this->print_and_log("Reconnection or re-execution failed.\n");
+    latency.observe_since(started);
+    Metrics::instance().counter("hes_db_query_errors_total", Metrics::label("statement", statement)).fetch_add(1, std::memory_order_relaxed);
     return FAILURE;
 }
 
-int MySqlDatabase::Update_dlms_on_demand_request_status(unsigned int req_id, RequestStatus status, uint16_t err_code)
+/**
+ * @brief Runs a SELECT and streams each row to on_row without buffering the result set
+ *
+ * on_row must not issue queries of its own, the connection stays busy until the last row is read.
+ *
+ * @return Number of rows streamed, FAILURE=DB error
+ */
+int MySqlDatabase::query_each_row(char *query, const std::function<void(MYSQL_ROW row)> &on_row)
 {
-    char query[128] = {0};
-    std::string download_time;
-    auto now = std::time(nullptr);
-    auto tm = *std::localtime(&now);
-    std::ostringstream oss;
-    oss << std::put_time(&tm, "%Y-%m-%d %H:%M:%S");
-    download_time = oss.str();
-    // Construct SQL UPDATE query to set the status for the given request_id
-    snprintf(query, sizeof(query),
-             "UPDATE dlms_on_demand_request SET status='%d',error_code = %d,download_time = '%s' WHERE request_id=%u;",
-             static_cast<int>(status), err_code, download_time.c_str(), req_id);
+    if (this->execute_query(query) == FAILURE)
+    {
+        return FAILURE;
+    }
 
-    // Execute the update query
-    bool ret = this->execute_query(query);
+    MYSQL_RES *result = mysql_use_result(this->mysql);
+    if (!result)
+    {
+        this->print_and_log("mysql_use_result failed (Error %u): %s\n", mysql_errno(this->mysql), mysql_error(this->mysql));
+        return FAILURE;
+    }
 
-    // Log the execution result
-    this->print_and_log("Update_dlms_on_demand_request_status Result: %s\n", (ret == SUCCESS ? "SUCCESS" : "FAILURE"));
+    int row_count = 0;
+    MYSQL_ROW row;
+    while ((row = mysql_fetch_row(result)) != nullptr)
+    {
+        on_row(row);
+        row_count++;
+    }
 
-    return ret;
+    uint32_t err = mysql_errno(this->mysql);
+    mysql_free_result(result);
+
+    if (err)
+    {
+        this->print_and_log("Row fetch failed (Error %u) after %d rows\n", err, row_count);
+        return FAILURE;
+    }
+
+    return row_count;
+}
+
+/**
+ * @brief Indexes pathSrcRouteQueue by the 16-char meter MAC so callers look a node up once instead of rescanning the queue
+ */
+void MySqlDatabase::snapshot_source_routes(std::unordered_map<std::string, silenceND> &routes)
+{
+    routes.clear();
+
+    std::queue<silenceND> temp_queue = MySqlDatabase::pathSrcRouteQueue; // Copy queue (original unchanged)
+    while (!temp_queue.empty())
+    {
+        silenceND &route = temp_queue.front();
+        std::string mac(reinterpret_cast<const char *>(route.meter_mac_address.data()), route.meter_mac_address.size());
+        routes.emplace(std::move(mac), std::move(route)); // First queued path wins
+        temp_queue.pop();
+    }
+}
+
+// Status transitions are journaled and written in batches, see StatusJournal
+int MySqlDatabase::Update_dlms_on_demand_request_status(unsigned int req_id, RequestStatus status, uint16_t err_code)
+{
+    this->print_and_log("[STATUS] REQ_ID=%u -> %d (error_code %d)\n", req_id, static_cast<int>(status), err_code);
+
+    if (this->status_journal.record(StatusTable::ODM, req_id, static_cast<int>(status), err_code))
+        return this->flush_status_journal();
+
+    return SUCCESS;
 }
 
 int MySqlDatabase::Update_dlms_on_demand_Ping_request_status(unsigned int req_id, RequestStatus status)
 {
-    char query[128] = {0};
-    std::string download_time;
-    auto now = std::time(nullptr);
-    auto tm = *std::localtime(&now);
-    std::ostringstream oss;
-    oss << std::put_time(&tm, "%Y-%m-%d %H:%M:%S");
-    download_time = oss.str();
-    // Construct SQL UPDATE query to set the status for the given request_id
-    snprintf(query, sizeof(query),
-             "UPDATE dlms_on_demand_ping_request SET status='%d',last_download_time = '%s' WHERE request_id=%u;",
-             static_cast<int>(status), download_time.c_str(), req_id);
+    this->print_and_log("[STATUS] PING REQ_ID=%u -> %d\n", req_id, static_cast<int>(status));
+
+    if (this->status_journal.record(StatusTable::PING, req_id, static_cast<int>(status), 0))
+        return this->flush_status_journal();
+
+    return SUCCESS;
+}
 
-    // Execute the update query
-    bool ret = this->execute_query(query);
+void MySqlDatabase::flush_status_journal_if_due(void)
+{
+    if (this->status_journal.due())
+        this->flush_status_journal();
+}
+
+/*
+ * Writes every pending status transition, one UPDATE ... WHERE request_id
+ * IN (...) per (table, status, error code), split every
+ * STATUS_JOURNAL_IDS_PER_QUERY IDs.
+ */
+int MySqlDatabase::flush_status_journal(void)
+{
+    std::vector<StatusBatch> batches = this->status_journal.take();
+    if (batches.empty())
+        return SUCCESS;
+
+    int ret = SUCCESS;
+    size_t statements = 0;
+    size_t transitions = 0;
+    std::string query;
+    std::vector<StatusBatch> written; // only what reached the DB is reported to on_status_flushed
+    const StatusBatch *written_from = nullptr;
+
+    for (const StatusBatch &batch : batches)
+    {
+        char download_time[20] = {0};
+        std::tm tm{};
+        localtime_r(&batch.at, &tm);
+        strftime(download_time, sizeof(download_time), "%Y-%m-%d %H:%M:%S", &tm);
+
+        char head[160] = {0};
+        if (batch.table == StatusTable::PING)
+            snprintf(head, sizeof(head), "UPDATE dlms_on_demand_ping_request SET status='%d',last_download_time = '%s' WHERE request_id IN (", batch.status, download_time);
+        else
+            snprintf(head, sizeof(head), "UPDATE dlms_on_demand_request SET status='%d',error_code = %d,download_time = '%s' WHERE request_id IN (", batch.status, batch.err_code,
+                     download_time);
+
+        for (size_t first = 0; first < batch.request_ids.size(); first += STATUS_JOURNAL_IDS_PER_QUERY)
+        {
+            size_t last = std::min(batch.request_ids.size(), first + STATUS_JOURNAL_IDS_PER_QUERY);
+
+            query.assign(head);
+            for (size_t i = first; i < last; i++)
+            {
+                if (i != first)
+                    query.push_back(',');
+                query.append(std::to_string(batch.request_ids[i]));
+            }
+            query.append(");");
+
+            statements++;
+            if (this->execute_query(&query[0]) != SUCCESS)
+            {
+                // Kept for the next flush instead of being lost with this one
+                this->status_journal.restore(batch, first, last);
+                ret = FAILURE;
+                continue;
+            }
+
+            if (&batch != written_from)
+            {
+                written.push_back(StatusBatch{batch.table, batch.status, batch.err_code, batch.at, {}});
+                written_from = &batch;
+            }
+            written.back().request_ids.insert(written.back().request_ids.end(), batch.request_ids.begin() + first, batch.request_ids.begin() + last);
+            transitions += last - first;
+        }
+    }
+
+    this->print_and_log("[STATUS JOURNAL] %zu transitions written in %zu statements: %s\n", transitions, statements, (ret == SUCCESS ? "SUCCESS" : "FAILURE"));
 
-    // Log the execution result
-    this->print_and_log("Update_dlms_on_demand_Ping_request_status Result: %s\n", (ret == SUCCESS ? "SUCCESS" : "FAILURE"));
+    if (this->on_status_flushed && !written.empty())
+        this->on_status_flushed(written);
 
     return ret;
 }
 
-bool MySqlDatabase::check_path_in_source_route_network(const std::vector<std::string> &parts, int request_id)
+bool MySqlDatabase::check_path_in_source_route_network(const QueuedCommand &cmd, int request_id)
 {
-    if (parts[3].length() < 32)
+    const char *dest_addr = cmd.field(DEST_ADDR);
+    size_t dest_len = cmd.field_size(DEST_ADDR);
+
+    if (dest_len < 32)
     {
-        this->print_and_log("❌ PATH TOO SHORT: '%s' (len=%zu) < 32\n", parts[3].c_str(), parts[3].length());
+        this->print_and_log("❌ PATH TOO SHORT: '%s' (len=%zu) < 32\n", dest_addr, dest_len);
         this->Update_dlms_on_demand_request_status(request_id, FAILED_PMESH_ERROR, 0);
         return false;
     }
     // Extract substring skipping first 16 bytes (32 hex chars)
-    std::string path_hex = parts[3].substr(16);
+    std::string path_hex(dest_addr + 16, dest_len - 16);
 
     this->print_and_log("🔍 FULL_PATH='%s' → PATH='%s' (len=%zu)\n",
-                        parts[3].c_str(), path_hex.c_str(), path_hex.length());
+                        dest_addr, path_hex.c_str(), path_hex.length());
 
     // Convert to uppercase for consistent DB query(string to uppercase hex format)
     std::transform(path_hex.begin(), path_hex.end(), path_hex.begin(), ::toupper);
@@ -315,121 +454,99 @@ int MySqlDatabase::is_NP_data_available(char *gateway_id)
         return FAILURE; // Null GATEWAY ID → early exit
     }
 
-    char query_buffer[256];       // Query 1 buffer: source routes
-    char query_buffer2[256];      // Query 2 buffer: nameplate check
-    MYSQL_RES *result = nullptr;  // Result set 1: source_route_network
-    MYSQL_RES *result2 = nullptr; // Result set 2: name_plate_data
-    // MYSQL_ROW row2;               // Row iterator for nameplate data
+    char query_buffer[256];                  // Nameplate set for the whole gateway
+    std::unordered_set<std::string> np_macs; // MACs (gateway included) that already have nameplate data
 
-    // Query 1: fetch nomber of name plate count for gateway
+    // One round trip: every MAC on this gateway with nameplate data
     snprintf(query_buffer, sizeof(query_buffer),
-             "SELECT COUNT(*) FROM name_plate_data WHERE gateway_id='%s' and meter_mac_address='%s';",
-             gateway_id, gateway_id);
+             "SELECT DISTINCT meter_mac_address FROM name_plate_data WHERE gateway_id='%s';",
+             gateway_id);
 
-    if (this->execute_query(query_buffer) == FAILURE)
+    int rows = this->query_each_row(query_buffer, [&np_macs](MYSQL_ROW row)
+                                    {
+                                        if (row[0])
+                                            np_macs.emplace(row[0]);
+                                    });
+    if (rows == FAILURE)
     {
         this->print_and_log("Query executed Failed.\n");
         return FAILURE;
     }
 
-    result = mysql_store_result(this->mysql);
-    if (result && mysql_num_rows(result) > 0)
-    {
-        MYSQL_ROW row = mysql_fetch_row(result);
-        int row_count = atoi(row[0]);
-        mysql_free_result(result);
+    this->print_and_log("NamePlate data present for %d MACs on gateway %s\n", rows, gateway_id);
 
-        if (row_count > 0)
-        {
-            this->print_and_log("✅ NamePlate data EXISTS for gateway = %s\n", gateway_id);
-        }
-        else
-        {
-            this->print_and_log("❌ No NamePlate data found for Gateway \n");
+    if (np_macs.count(std::string(gateway_id, strnlen(gateway_id, 16))))
+    {
+        this->print_and_log("✅ NamePlate data EXISTS for gateway = %s\n", gateway_id);
+    }
+    else
+    {
+        this->print_and_log("❌ No NamePlate data found for Gateway \n");
 
-            // Fetch last 8 bytes of gateway and enqueue
-            dest_address.clear(); // Clear global destination address buffer
+        // Fetch last 8 bytes of gateway and enqueue
+        dest_address.clear(); // Clear global destination address buffer
 
-            size_t total_length = 16; // Total raw path length in bytes
+        size_t total_length = 16; // Total raw path length in bytes
 
-            size_t copy_start = 8; // Skip initial 8 bytes (likely source MAC/header)
+        size_t copy_start = 8; // Skip initial 8 bytes (likely source MAC/header)
 
-            while (copy_start + 8 <= total_length)
+        while (copy_start + 8 <= total_length)
+        {
+            // Copy next 8 bytes after skipping previous 8
+            for (size_t i = 0; i < 8; i++)
             {
-                // Copy next 8 bytes after skipping previous 8
-                for (size_t i = 0; i < 8; i++)
-                {
-                    dest_address.push_back(gateway_id[copy_start + i]);
-                }
-                copy_start += 16; // Skip next 8 bytes after copying 8 bytes
+                dest_address.push_back(gateway_id[copy_start + i]);
             }
-            dest_address.push_back(0); // Null terminate extracted path
-
-            // Enqueue Gateway details to pull
-            auto qsize = this->hesNPDataQueue.size(); // Check NamePlate queue size
+            copy_start += 16; // Skip next 8 bytes after copying 8 bytes
+        }
+        dest_address.push_back(0); // Null terminate extracted path
 
-            if (qsize >= 50) // Queue full (max 10) → drop oldest entry
-            {
-                this->print_and_log("HES data queue full, dropping oldest packet\n");
-                this->hesNPDataQueue.pop();
-            }
+        // Enqueue Gateway details to pull
+        auto qsize = this->hesNPDataQueue.size(); // Check NamePlate queue size
 
-            // Queue for NamePlate pull: MAC(16), path_len, path, hop_count
-            this->hesNPDataQueue.emplace((uint8_t *)gateway_id, 16, (uint8_t *)dest_address.data(), 8, 0);
+        if (qsize >= 50) // Queue full (max 10) → drop oldest entry
+        {
+            this->print_and_log("HES data queue full, dropping oldest packet\n");
+            this->hesNPDataQueue.pop();
         }
+
+        // Queue for NamePlate pull: MAC(16), path_len, path, hop_count
+        this->hesNPDataQueue.emplace((uint8_t *)gateway_id, 16, (uint8_t *)dest_address.data(), 8, 0);
     }
 
     std::queue<silenceND> temp_queue = MySqlDatabase::pathSrcRouteQueue; // Copy queue again (original unchanged)
 
     while (!temp_queue.empty())
     {
-
         silenceND &router_mac_add = temp_queue.front(); // Get front queue element (meter record)
 
-        // Prepare null-terminated MAC string from queued binary/vector data
         std::string queued_mac_str(reinterpret_cast<const char *>(router_mac_add.meter_mac_address.data()), router_mac_add.meter_mac_address.size());
 
-        // Query 2: Check if NamePlate data EXISTS for this GATEWAY
-        snprintf(query_buffer2, sizeof(query_buffer2), "select COUNT(*) from name_plate_data where gateway_id ='%s' and meter_mac_address = '%s';", gateway_id, queued_mac_str.c_str());
-        if (this->execute_query(query_buffer2) == FAILURE)
+        if (np_macs.count(queued_mac_str))
         {
-            this->print_and_log("Query execution Failed.\n");
-            continue;
+            this->print_and_log("✅ NP data found for (%.*s)\n",
+                                static_cast<int>(router_mac_add.meter_mac_address.size()), (char *)router_mac_add.meter_mac_address.data());
         }
-
-        result2 = mysql_store_result(this->mysql); // Store nameplate results
-        if (result2 != nullptr)
+        else
         {
-            MYSQL_ROW row = mysql_fetch_row(result2);
-            int row_count = atoi(row[0]);
-            mysql_free_result(result2);
+            this->print_and_log("❌ NP data not found\n");
 
-            if (row_count > 0)
+            auto qsize = this->hesNPDataQueue.size(); // Check NamePlate queue size
+
+            if (qsize >= 50) // Queue full (max 10) → drop oldest entry
             {
-                this->print_and_log("✅ NP data found for (%.*s)\n",
-                                    static_cast<int>(router_mac_add.meter_mac_address.size()), (char *)router_mac_add.meter_mac_address.data());
+                this->print_and_log("HES data queue full, dropping oldest packet\n");
+                this->hesNPDataQueue.pop();
             }
-            else
-            {
-                this->print_and_log("❌ NP data not found\n");
 
-                auto qsize = this->hesNPDataQueue.size(); // Check NamePlate queue size
-
-                if (qsize >= 50) // Queue full (max 10) → drop oldest entry
-                {
-                    this->print_and_log("HES data queue full, dropping oldest packet\n");
-                    this->hesNPDataQueue.pop();
-                }
-
-                // Queue for NamePlate pull: MAC(16), path_len, path, hop_count
-                this->hesNPDataQueue.emplace(router_mac_add.meter_mac_address.data(), 16, router_mac_add.path_record.data(), router_mac_add.hop_count * 8, router_mac_add.hop_count);
+            // Queue for NamePlate pull: MAC(16), path_len, path, hop_count
+            this->hesNPDataQueue.emplace(router_mac_add.meter_mac_address.data(), 16, router_mac_add.path_record.data(), router_mac_add.hop_count * 8, router_mac_add.hop_count);
 
-                // Print safely using explicit lengths because these fields may contain non-null-terminated/binary data
-                this->print_and_log("Queued [%.*s], path[%.*s] hop count[%d]\n",
-                                    16, (char *)router_mac_add.meter_mac_address.data(),
-                                    static_cast<int>(router_mac_add.path_record.size()), (char *)router_mac_add.path_record.data(),
-                                    router_mac_add.hop_count);
-            }
+            // Print safely using explicit lengths because these fields may contain non-null-terminated/binary data
+            this->print_and_log("Queued [%.*s], path[%.*s] hop count[%d]\n",
+                                16, (char *)router_mac_add.meter_mac_address.data(),
+                                static_cast<int>(router_mac_add.path_record.size()), (char *)router_mac_add.path_record.data(),
+                                router_mac_add.hop_count);
         }
         temp_queue.pop(); // Remove processed queue element
     }
@@ -730,128 +847,96 @@ int MySqlDatabase::check_for_scalar_profile(char *gateway_id)
 {
     this->print_and_log("%s Start\n", __FUNCTION__);
 
-    char query_buffer[512];
-    MYSQL_RES *result = nullptr;
-    MYSQL_RES *result2 = nullptr;
+    char query_buffer[2048];
     int return_value = 0; // 1=missing profile queued
 
-    //  Query 1: Get ALL meter details for this GATEWAY
+    // attribute_id is hex text, compared as a number like the sscanf("%x") it replaces: padding, case and a 0x prefix do not matter
+    const char *attr = "CAST(CONV(TRIM(LEADING '0x' FROM LOWER(TRIM(msa.attribute_id))), 16, 10) AS UNSIGNED)";
+
+    // One round trip: every meter of this GATEWAY with its link state and which scalar profiles are stored
     snprintf(query_buffer, sizeof(query_buffer),
-             "SELECT meter_manufacture_name, meter_mac_address, meter_phase, meter_firmware_version "
-             "FROM meter_details "
-             "WHERE gateway_id = '%s';",
+             "SELECT md.meter_manufacture_name, md.meter_mac_address, md.meter_phase, md.meter_firmware_version, "
+             "(SELECT srn.disconnected_from_gateway FROM source_route_network srn "
+             "WHERE srn.target_mac_address = md.meter_mac_address AND srn.gateway_id = '%s' LIMIT 1), "
+             "(SELECT gsi.status FROM gateway_status_info gsi WHERE gsi.gateway_id = '%s' LIMIT 1), "
+             "COALESCE(MAX(%s = %u), 0), COALESCE(MAX(%s = %u), 0), "
+             "COALESCE(MAX(%s = %u), 0), COALESCE(MAX(%s = %u), 0) "
+             "FROM meter_details md "
+             "LEFT JOIN meter_supported_attributes msa "
+             "ON msa.manufacturer_name = md.meter_manufacture_name AND msa.firmware_version = md.meter_firmware_version "
+             "AND %s IN (%u, %u, %u, %u) "
+             "WHERE md.gateway_id = '%s' "
+             "GROUP BY md.meter_manufacture_name, md.meter_mac_address, md.meter_phase, md.meter_firmware_version;",
+             gateway_id, gateway_id,
+             attr, attribute_id_ip, attr, attribute_id_bh, attr, attribute_id_dlp, attr, attribute_id_blp,
+             attr, attribute_id_ip, attribute_id_bh, attribute_id_dlp, attribute_id_blp,
              gateway_id);
 
-    if (this->execute_query(query_buffer) == FAILURE)
+    struct ScalarCheckRow
+    {
+        uint8_t meter_manufacture_name_md[65];
+        uint8_t meter_mac_address[17];
+        uint8_t meter_fw_version[65];
+        uint8_t meter_phase;
+        bool has_ip, has_bh, has_dlp, has_blp;
+    };
+    std::vector<ScalarCheckRow> meters;
+
+    int rows = this->query_each_row(query_buffer, [this, &meters, gateway_id](MYSQL_ROW row)
+                                    {
+                                        if (!row[0] || !row[1] || !row[2] || !row[3])
+                                        {
+                                            return; // Skip incomplete records
+                                        }
+
+                                        ScalarCheckRow meter = {};
+                                        memcpy(meter.meter_manufacture_name_md, row[0], strnlen(row[0], 64));
+                                        memcpy(meter.meter_fw_version, row[3], strnlen(row[3], 64));
+                                        memcpy(meter.meter_mac_address, row[1], strnlen(row[1], 16));
+                                        meter.meter_phase = atoi(row[2]);
+
+                                        // Not in source_route_network → fall back to the gateway status
+                                        if (!row[4])
+                                        {
+                                            if (row[5] && atoi(row[5]) == 0)
+                                            {
+                                                this->print_and_log("Gateway %s is disconnected - SKIP\n", gateway_id);
+                                                return;
+                                            }
+                                        }
+                                        else if (atoi(row[4]) == 1)
+                                        {
+                                            this->print_and_log("Meter %s is disconnected from gateway %s - SKIP\n", meter.meter_mac_address, gateway_id);
+                                            return;
+                                        }
+
+                                        meter.has_ip = row[6] && atoi(row[6]);
+                                        meter.has_bh = row[7] && atoi(row[7]);
+                                        meter.has_dlp = row[8] && atoi(row[8]);
+                                        meter.has_blp = row[9] && atoi(row[9]);
+                                        meters.push_back(meter);
+                                    });
+    if (rows == FAILURE)
     {
         this->print_and_log("Query 1 failed\n");
         return FAILURE;
     }
 
-    result = mysql_store_result(this->mysql);
-    if (!result)
-    {
-        this->print_and_log("mysql_store_result failed for Query 1\n");
-        return FAILURE;
-    }
-
-    //  Process each meter
-    MYSQL_ROW row;
-    MYSQL_RES *local_result = nullptr;
-
-    while ((row = mysql_fetch_row(result)) != nullptr)
+    //  Process each connected meter
+    for (ScalarCheckRow &meter : meters)
     {
-        if (!row[0] || !row[1] || !row[2] || !row[3])
-        {
-            continue; // Skip incomplete records
-        }
-        char local_query_buffer[512];
-        MYSQL_ROW local_row;
-        uint8_t meter_manufacture_name_md[65] = {0};
-        uint8_t meter_mac_address[17] = {0};
-        uint8_t meter_fw_version[65] = {0};
-        uint8_t meter_phase = atoi(row[2]);
-
-        memcpy(meter_manufacture_name_md, row[0], strnlen(row[0], 64));
-        meter_manufacture_name_md[64] = '\0';
-
-        memcpy(meter_fw_version, row[3], strnlen(row[3], 64));
-        meter_fw_version[64] = '\0';
-
-        memcpy(meter_mac_address, row[1], strnlen(row[1], 16));
-        meter_mac_address[16] = '\0';
-
         this->print_and_log("Processing: %s | %s | Phase=%d\n",
-                            meter_manufacture_name_md, meter_mac_address, meter_phase);
+                            meter.meter_manufacture_name_md, meter.meter_mac_address, meter.meter_phase);
 
         //  Check queue (avoid duplicates)
         bool already_queued = false;
 
-        bool meter_connected = false;
-
-        //  Check source_route_network for disconnection status
-        snprintf(local_query_buffer, sizeof(local_query_buffer),
-                 "select disconnected_from_gateway from source_route_network where target_mac_address = '%s' and gateway_id = '%s';",
-                 meter_mac_address, gateway_id);
-
-        if (this->execute_query(local_query_buffer) == FAILURE)
-        {
-            this->print_and_log("Fallback query failed\n");
-            return FAILURE;
-        }
-        local_result = mysql_store_result(this->mysql);
-        if (!local_result)
-        {
-            this->print_and_log("mysql_store_result failed for Query 1\n");
-            return FAILURE;
-        }
-        if (mysql_num_rows(local_result) == 0)
-        {
-            mysql_free_result(local_result);
-            local_result = nullptr;
-            snprintf(local_query_buffer, sizeof(local_query_buffer),
-                     "select status from gateway_status_info where gateway_id = '%s';",
-                     gateway_id);
-
-            if (this->execute_query(local_query_buffer) == FAILURE)
-            {
-                this->print_and_log("Fallback query failed\n");
-                continue; // Skip disconnected meters
-            }
-            local_result = mysql_store_result(this->mysql);
-            if ((local_row = mysql_fetch_row(local_result)))
-            {
-                meter_connected = true;
-                if (local_row[0] && atoi(local_row[0]) == 0)
-                {
-                    this->print_and_log("Gateway %s is disconnected - SKIP\n", gateway_id);
-                    mysql_free_result(local_result);
-                    continue; // Skip disconnected meters
-                }
-                mysql_free_result(local_result);
-            }
-        }
-
-        if (!meter_connected)
-        {
-            if ((local_row = mysql_fetch_row(local_result)))
-            {
-                if (local_row[0] && atoi(local_row[0]) == 1)
-                {
-                    this->print_and_log("Meter %s is disconnected from gateway %s - SKIP\n", meter_mac_address, gateway_id);
-                    mysql_free_result(local_result);
-                    continue; // Skip disconnected meters
-                }
-                mysql_free_result(local_result);
-            }
-        }
-
         std::queue<meter_details> temp_queue = MySqlDatabase::meterDetailsQueue;
         while (!temp_queue.empty())
         {
             meter_details &q = temp_queue.front();
-            if (strncmp((char *)q.meter_manufacture_name.data(), (char *)meter_manufacture_name_md, 64) == 0 &&
-                strncmp((char *)q.meter_fw_version.data(), (char *)meter_fw_version, 64) == 0)
+            if (strncmp((char *)q.meter_manufacture_name.data(), (char *)meter.meter_manufacture_name_md, 64) == 0 &&
+                strncmp((char *)q.meter_fw_version.data(), (char *)meter.meter_fw_version, 64) == 0)
             {
                 already_queued = true;
                 break;
@@ -861,80 +946,33 @@ int MySqlDatabase::check_for_scalar_profile(char *gateway_id)
 
         if (already_queued)
         {
-            this->print_and_log("Manufacturer '%s' already queued - SKIP\n", meter_manufacture_name_md);
+            this->print_and_log("Manufacturer '%s' already queued - SKIP\n", meter.meter_manufacture_name_md);
             continue;
         }
 
-        //  Query 2: Check scalar attributes
-        snprintf(query_buffer, sizeof(query_buffer),
-                 "SELECT attribute_id FROM meter_supported_attributes "
-                 "WHERE manufacturer_name='%s' AND firmware_version='%s'",
-                 meter_manufacture_name_md, meter_fw_version);
-
-        if (this->execute_query(query_buffer) == FAILURE)
-        {
-            this->print_and_log("Attribute query failed\n");
-            continue;
-        }
-
-        result2 = mysql_store_result(this->mysql);
-        if (!result2) continue;
-
-        // Parse attributes
-        bool has_ip = false, has_bh = false, has_dlp = false, has_blp = false;
-        MYSQL_ROW row2;
-        while ((row2 = mysql_fetch_row(result2)) != nullptr)
-        {
-            if (!row2[0]) continue;
-
-            unsigned int attr_id = 0;
-            sscanf(row2[0], "%x", &attr_id);
-
-            switch (attr_id)
-            {
-                case attribute_id_ip:
-                    has_ip = true;
-                    break;
-                case attribute_id_bh:
-                    has_bh = true;
-                    break;
-                case attribute_id_dlp:
-                    has_dlp = true;
-                    break;
-                case attribute_id_blp:
-                    has_blp = true;
-                    break;
-            }
-        }
-
-        mysql_free_result(result2); // ✅ Cleanup
-
         //  Queue missing profiles
-        if (!has_ip)
+        if (!meter.has_ip)
         {
-            this->enqueue_info(meter_manufacture_name_md, 1, meter_mac_address, meter_phase, gateway_id, meter_fw_version);
+            this->enqueue_info(meter.meter_manufacture_name_md, 1, meter.meter_mac_address, meter.meter_phase, gateway_id, meter.meter_fw_version);
             return_value = 1;
         }
-        if (!has_bh)
+        if (!meter.has_bh)
         {
-            this->enqueue_info(meter_manufacture_name_md, 2, meter_mac_address, meter_phase, gateway_id, meter_fw_version);
+            this->enqueue_info(meter.meter_manufacture_name_md, 2, meter.meter_mac_address, meter.meter_phase, gateway_id, meter.meter_fw_version);
             return_value = 1;
         }
-        if (!has_dlp)
+        if (!meter.has_dlp)
         {
-            this->enqueue_info(meter_manufacture_name_md, 3, meter_mac_address, meter_phase, gateway_id, meter_fw_version);
+            this->enqueue_info(meter.meter_manufacture_name_md, 3, meter.meter_mac_address, meter.meter_phase, gateway_id, meter.meter_fw_version);
             return_value = 1;
         }
-        if (!has_blp)
+        if (!meter.has_blp)
         {
-            this->enqueue_info(meter_manufacture_name_md, 4, meter_mac_address, meter_phase, gateway_id, meter_fw_version);
+            this->enqueue_info(meter.meter_manufacture_name_md, 4, meter.meter_mac_address, meter.meter_phase, gateway_id, meter.meter_fw_version);
             return_value = 1;
         }
     }
 
-    //  FINAL CLEANUP
-    if (result) mysql_free_result(result);
-
     this->print_and_log("%s End → return %d\n", __FUNCTION__, return_value);
     return return_value;
 }
@@ -1138,71 +1176,55 @@ int MySqlDatabase::fetch_path_record_from_src_route_network_db(char *gateway_id)
 
 int MySqlDatabase::check_for_unsilenced_nodes(char *gateway_id)
 {
-    char query_buffer[256];      // Query 1: unsilenced FUOTA nodes
-    MYSQL_RES *result = nullptr; // Result set 1: unsilenced nodes
-    MYSQL_ROW row;               // Unsilenced node row
+    char query_buffer[256]; // Query 1: unsilenced FUOTA nodes
+
+    // Source routes indexed once by MAC instead of rescanning the queue per row
+    std::unordered_map<std::string, silenceND> routes;
+    this->snapshot_source_routes(routes);
 
     // Query 1: Get ALL unsilenced nodes eligible for FUOTA
-    snprintf(query_buffer, sizeof(query_buffer), "select meter_mac_address, Fuota_status from unsilenced_nodes_for_fuota where gateway_id = '%s';", gateway_id);
-    if (this->execute_query(query_buffer) == FAILURE)
-    {
-        this->print_and_log("Query executed Failed.\n");
-        return FAILURE;
-    }
+    snprintf(query_buffer, sizeof(query_buffer),
+             "select meter_mac_address from unsilenced_nodes_for_fuota where gateway_id = '%s' and Fuota_status <> 0;", gateway_id);
 
-    result = mysql_store_result(this->mysql);
+    int rows = this->query_each_row(query_buffer, [this, &routes](MYSQL_ROW row)
+                                    {
+                                        if (!(row[0])) // Skip incomplete rows
+                                        {
+                                            return;
+                                        }
 
-    if (result != nullptr)
-    {
-        uint8_t target_mac_address[17] = {0}; // Target meter MAC
-        uint8_t fuota_status;                 // FUOTA status flag
-        // uint8_t hop_count;                     // hop_count
+                                        uint8_t target_mac_address[17] = {0}; // Target meter MAC
+                                        memcpy(target_mac_address, (uint8_t *)row[0], strnlen(row[0], 16));
 
-        while ((row = mysql_fetch_row(result)) != nullptr)
-        {
-            if (!(row[0]) || !(row[1])) // Skip incomplete rows
-            {
-                continue;
-            }
+                                        this->print_and_log("target_mac_address: (%s)\n", target_mac_address);
 
-            fuota_status = static_cast<uint8_t>(atoi(row[1])); // Parse FUOTA status (col 2)
-            if (fuota_status)
-            {
-                memcpy(target_mac_address, (uint8_t *)row[0], 16); // Copy target MAC (col 1)
-                target_mac_address[16] = '\0';
+                                        auto it = routes.find(std::string((char *)target_mac_address, 16));
+                                        if (it == routes.end())
+                                        {
+                                            return;
+                                        }
+                                        silenceND &router_mac_add = it->second;
 
-                this->print_and_log("target_mac_address: (%s)\n", target_mac_address);
+                                        auto qsize = this->silencedNDQueue.size(); // Check unsilence queue
 
-                std::queue<silenceND> temp_queue = MySqlDatabase::pathSrcRouteQueue; // Copy queue again (original unchanged)
+                                        if (qsize >= 50) // Queue full → drop oldest
+                                        {
+                                            this->print_and_log("HES data queue full, dropping oldest packet\n");
+                                            this->silencedNDQueue.pop();
+                                        }
 
-                while (!temp_queue.empty())
-                {
-                    silenceND &router_mac_add = temp_queue.front(); // Get front queue element (meter record)
+                                        // Queue for 9B unsilence command: path_data, path_length, hop_count
+                                        this->silencedNDQueue.emplace(target_mac_address, 16, router_mac_add.path_record.data(), router_mac_add.hop_count * 8, router_mac_add.hop_count);
 
-                    if (memcmp((uint8_t *)router_mac_add.meter_mac_address.data(), target_mac_address, 16) == 0)
-                    {
-                        auto qsize = this->silencedNDQueue.size(); // Check unsilence queue
-
-                        if (qsize >= 50) // Queue full → drop oldest
-                        {
-                            this->print_and_log("HES data queue full, dropping oldest packet\n");
-                            this->silencedNDQueue.pop();
-                        }
-
-                        // Queue for 9B unsilence command: path_data, path_length, hop_count
-                        this->silencedNDQueue.emplace(target_mac_address, 16, router_mac_add.path_record.data(), router_mac_add.hop_count * 8, router_mac_add.hop_count);
-
-                        this->print_and_log("Queued destination_address %.*s, hop count: %d for (%.*s)\n",
-                                            static_cast<int>(router_mac_add.path_record.size()), (char *)router_mac_add.path_record.data(),
-                                            router_mac_add.hop_count,
-                                            16, (char *)target_mac_address);
-                        break; // Process first valid path only
-                    }
-                    temp_queue.pop(); // Remove processed meter from temporary queue
-                }
-            }
-        }
-        mysql_free_result(result); // Cleanup unsilenced nodes results
+                                        this->print_and_log("Queued destination_address %.*s, hop count: %d for (%.*s)\n",
+                                                            static_cast<int>(router_mac_add.path_record.size()), (char *)router_mac_add.path_record.data(),
+                                                            router_mac_add.hop_count,
+                                                            16, (char *)target_mac_address);
+                                    });
+    if (rows == FAILURE)
+    {
+        this->print_and_log("Query executed Failed.\n");
+        return FAILURE;
     }
     return SUCCESS; // Scan completed
 }
@@ -1529,7 +1551,7 @@ int MySqlDatabase::compare_schedule_time(const char *schedule_time_str, std::str
     }
 }
 
-int MySqlDatabase::get_nodes_info_from_src_route_network_db(std::map<std::array<uint8_t, 8>, NodeInfo> &nodes_info, const char *gateway_id)
+int MySqlDatabase::get_nodes_info_from_src_route_network_db(NodeMap &nodes_info, const char *gateway_id)
 {
     this->print_and_log("%s start\n", __FUNCTION__);
 
@@ -1569,7 +1591,7 @@ int MySqlDatabase::get_nodes_info_from_src_route_network_db(std::map<std::array<
         }
 
         // Create or reference existing node
-        NodeInfo &info = nodes_info[mac];
+        NodeInfo &info = nodes_info[PullData::mac_to_key(mac)];
         info.node_mac_address = mac;
         // Store into primary_path
         info.primary_path.hop_count = hop_count;
@@ -1587,6 +1609,39 @@ int MySqlDatabase::get_nodes_info_from_src_route_network_db(std::map<std::array<
     return SUCCESS;
 }
 
+int MySqlDatabase::get_topology_fingerprint(const char *gateway_id, std::string &fingerprint)
+{
+    this->print_and_log("%s start\n", __FUNCTION__);
+
+    fingerprint.clear();
+
+    // Row count + XOR of row checksums for both routing tables, changes whenever NMS rewrites a route
+    char query[1024];
+    snprintf(query, sizeof(query),
+             "SELECT (SELECT CONCAT(COUNT(*), ':', COALESCE(BIT_XOR(CRC32(CONCAT_WS(':', target_mac_address, hop_count, path, disconnected_from_gateway))), 0)) FROM source_route_network WHERE gateway_id = '%s'), "
+             "(SELECT CONCAT(COUNT(*), ':', COALESCE(BIT_XOR(CRC32(CONCAT_WS(':', target_mac_address, hop_count, path))), 0)) FROM alternate_source_route_network WHERE gateway_id = '%s');",
+             gateway_id, gateway_id);
+
+    if (this->execute_query(query))
+        return FAILURE;
+
+    MYSQL_RES *res = mysql_store_result(this->mysql);
+    if (!res)
+        return FAILURE;
+
+    MYSQL_ROW row = mysql_fetch_row(res);
+    if (row && row[0] && row[1])
+    {
+        fingerprint = std::string(row[0]) + "/" + std::string(row[1]);
+    }
+
+    mysql_free_result(res);
+
+    this->print_and_log("Topology fingerprint: %s\n", fingerprint.c_str());
+
+    return fingerprint.empty() ? FAILURE : SUCCESS;
+}
+
 int MySqlDatabase::get_alternate_path_for_node(NodeInfo &node, const char *gateway_id)
 {
     this->print_and_log("%s start\n", __FUNCTION__);
@@ -1925,6 +1980,91 @@ int MySqlDatabase::is_ifv_available_for_node(std::array<uint8_t, 8> node_mac_add
     return result;
 }
 
+int MySqlDatabase::load_coverage_index_from_db(const char *gateway_id)
+{
+    this->print_and_log("%s start\n", __FUNCTION__);
+
+    CoverageIndex &coverage = CoverageIndex::instance();
+
+    if (coverage.is_gateway_loaded(gateway_id))
+        return SUCCESS;
+
+    char query_buffer[1024];
+    MYSQL_RES *res = nullptr;
+    MYSQL_ROW row;
+    int rows = 0;
+
+    // IP cycles written in the last day
+    snprintf(query_buffer, sizeof(query_buffer), "SELECT DISTINCT meter_mac_address, cycle_id, UNIX_TIMESTAMP(updated_time) FROM dlms_ip_push_data WHERE gateway_id = '%s' AND updated_time >= NOW() - INTERVAL 1 DAY;", gateway_id);
+
+    if (this->execute_query(query_buffer) || !(res = mysql_store_result(this->mysql)))
+        return FAILURE;
+
+    while ((row = mysql_fetch_row(res)))
+    {
+        if (!row[0] || !row[1] || !row[2] || strlen(row[0]) != 16)
+            continue;
+
+        coverage.mark_ip_cycle(gateway_id, PullData::mac_from_hex(row[0]), atoi(row[1]), static_cast<std::time_t>(atoll(row[2])));
+        rows++;
+    }
+    mysql_free_result(res);
+
+    // Block load slots in the last day, one per 15 minutes is enough
+    snprintf(query_buffer, sizeof(query_buffer), "SELECT DISTINCT meter_mac_address, FLOOR(UNIX_TIMESTAMP(last_download_time) / 900) * 900 FROM dlms_block_load_push_profile WHERE gateway_id = '%s' AND last_download_time >= DATE_SUB(NOW(), INTERVAL 1 DAY) AND (cycle_id %% 4) = 0;", gateway_id);
+
+    if (this->execute_query(query_buffer) || !(res = mysql_store_result(this->mysql)))
+        return FAILURE;
+
+    while ((row = mysql_fetch_row(res)))
+    {
+        if (!row[0] || !row[1] || strlen(row[0]) != 16)
+            continue;
+
+        coverage.mark_blp(gateway_id, PullData::mac_from_hex(row[0]), static_cast<std::time_t>(atoll(row[1])));
+        rows++;
+    }
+    mysql_free_result(res);
+
+    // Daily load days of the last week
+    snprintf(query_buffer, sizeof(query_buffer), "SELECT DISTINCT meter_mac_address, UNIX_TIMESTAMP(DATE(real_time_clock)) FROM dlms_daily_load_push_profile WHERE gateway_id = '%s' AND real_time_clock >= DATE_SUB(CURDATE(), INTERVAL 7 DAY);", gateway_id);
+
+    if (this->execute_query(query_buffer) || !(res = mysql_store_result(this->mysql)))
+        return FAILURE;
+
+    while ((row = mysql_fetch_row(res)))
+    {
+        if (!row[0] || !row[1] || strlen(row[0]) != 16)
+            continue;
+
+        coverage.mark_dlp_day(gateway_id, PullData::mac_from_hex(row[0]), static_cast<std::time_t>(atoll(row[1])));
+        rows++;
+    }
+    mysql_free_result(res);
+
+    // Billing months from the previous month onwards
+    snprintf(query_buffer, sizeof(query_buffer), "SELECT DISTINCT meter_mac_address, YEAR(billing_date_import_mode), MONTH(billing_date_import_mode) FROM dlms_history_data WHERE gateway_id = '%s' AND billing_date_import_mode >= DATE_FORMAT(CURRENT_DATE - INTERVAL 1 MONTH, '%%Y-%%m-01');", gateway_id);
+
+    if (this->execute_query(query_buffer) || !(res = mysql_store_result(this->mysql)))
+        return FAILURE;
+
+    while ((row = mysql_fetch_row(res)))
+    {
+        if (!row[0] || !row[1] || !row[2] || strlen(row[0]) != 16)
+            continue;
+
+        coverage.mark_bhp_month(gateway_id, PullData::mac_from_hex(row[0]), atoi(row[1]), atoi(row[2]));
+        rows++;
+    }
+    mysql_free_result(res);
+
+    coverage.set_gateway_loaded(gateway_id);
+
+    this->print_and_log("Coverage index loaded for gateway %s (%d entries)\n", gateway_id, rows);
+
+    return SUCCESS;
+}
+
 int MySqlDatabase::delete_node_from_unsilence_nodes_from_fuota(std::array<uint8_t, 8> node_mac_address, const char *gateway_id)
 {
     this->print_and_log("%s start\n", __FUNCTION__);
@@ -2038,10 +2178,7 @@ int MySqlDatabase::insert_name_plate_data(std::array<uint8_t, 8> node_mac_addres
 
 int MySqlDatabase::calculate_cycle_id_for_block_load(void)
 {
-    std::time_t now = std::time(nullptr);
-    std::tm local_time{};
-
-    localtime_r(&now, &local_time); // thread-safe
+    std::tm local_time = WallClock::local_tm(WallClock::seconds());
 
     int hour = local_time.tm_hour; // 0–23
 
@@ -2057,13 +2194,12 @@ int MySqlDatabase::calculate_cycle_id(int subtract_cycles)
     // subtract_cycles represents how many 15-minute intervals to go back
     const std::time_t seconds_to_subtract = static_cast<std::time_t>(subtract_cycles) * 15 * 60;
 
-    std::time_t now = std::time(nullptr);
+    std::time_t now = WallClock::seconds();
 
     // apply subtraction
     now -= seconds_to_subtract;
 
-    std::tm local_time{};
-    localtime_r(&now, &local_time);
+    std::tm local_time = WallClock::local_tm(now);
 
     int hour = local_time.tm_hour;  // 0–23
     int minute = local_time.tm_min; // 0–59
@@ -2184,6 +2320,8 @@ int MySqlDatabase::insert_instantaneous_parameters_profile_data(std::array<uint8
     bool loadlimit_function_sts = DlmsValueExtractor::get_bool(rec, 0x14, false);
     float loadlimit_value_kw = DlmsValueExtractor::get_numeric_or_default(rec, 0x15) * convertScalar(getScalarValue(meter_serial_no, "0100", IP_LOAD_LIMIT_VALUE_KW));
 
+    std::string last_download_time = this->now();
+
     // Rest of SQL query...
     snprintf(query_buf, sizeof(query_buf),
              "INSERT INTO dlms_ip_push_data("
@@ -2205,10 +2343,38 @@ int MySqlDatabase::insert_instantaneous_parameters_profile_data(std::array<uint8
              cum_power_on_duration, cum_tamper_count, cum_billing_count, cum_programming_count,
              cum_energy_kwh_export, cum_energy_kvah_export,
              loadlimit_function_sts ? 1 : 0, loadlimit_value_kw,
-             this->now().c_str(), cycle, push_status ? 1 : 0, push_status ? 1 : 0);
+             last_download_time.c_str(), cycle, push_status ? 1 : 0, push_status ? 1 : 0);
 
     if (execute_query(query_buf) == SUCCESS)
     {
+        CoverageIndex::instance().mark_ip_cycle(gateway_id, node_mac_address, cycle, std::time(nullptr));
+
+        InstantaneousRecord record;
+        record.meter_rtc_time = meter_rtc_time;
+        record.voltage = voltage;
+        record.phase_current = phase_current;
+        record.neutral_current = neutral_current;
+        record.signed_powerfactor = signed_powerfactor;
+        record.frequency = frequency;
+        record.apparent_power_kva = apparent_power_kva;
+        record.active_power_kw = active_power_kw;
+        record.cum_energy_kwh_import = cum_energy_kwh_import;
+        record.cum_energy_kvah_import = cum_energy_kvah_import;
+        record.maximum_demand_kw = maximum_demand_kw;
+        record.md_kw_datetime = md_kw_datetime;
+        record.maximum_demand_kva = maximum_demand_kva;
+        record.md_kva_datetime = md_kva_datetime;
+        record.cum_power_on_duration = cum_power_on_duration;
+        record.cum_tamper_count = cum_tamper_count;
+        record.cum_billing_count = cum_billing_count;
+        record.cum_programming_count = cum_programming_count;
+        record.cum_energy_kwh_export = cum_energy_kwh_export;
+        record.cum_energy_kvah_export = cum_energy_kvah_export;
+        record.loadlimit_function_sts = loadlimit_function_sts ? 1 : 0;
+        record.loadlimit_value_kw = loadlimit_value_kw;
+        record.last_download_time = last_download_time;
+        ProfileCache::instance().store_ip(node_mac_address, record, push_status ? ProfileSource::PUSH : ProfileSource::PULL);
+
         // int freq_val = 0;
         int8_t frequency_offset = 0;
         int16_t temperature = 0;
@@ -2294,7 +2460,12 @@ int MySqlDatabase::insert_daily_load_profile_data(std::array<uint8_t, 8> node_ma
              /* push_alarm           */ push_status ? 1 : 0,
              /* error_code           */ push_status ? 1 : 0);
 
-    return execute_query(query_buf);
+    if (execute_query(query_buf) == FAILURE)
+        return FAILURE;
+
+    CoverageIndex::instance().mark_dlp_day(gateway_id, node_mac_address, static_cast<std::time_t>(rtc_raw));
+
+    return SUCCESS;
 }
 
 int MySqlDatabase::insert_block_load_profile_data(std::array<uint8_t, 8> node_mac_address, const char *gateway_id, int cycle_id, PacketBufferBlockLoad &block_load_buffer, bool push_status)
@@ -2349,6 +2520,10 @@ int MySqlDatabase::insert_block_load_profile_data(std::array<uint8_t, 8> node_ma
             this->print_and_log("Block load insert failed\n");
             return ret;
         }
+
+        // Only the hourly block (cycle_id % 4 == 0) counts, as in the SQL check and the seed query
+        if (cycle_id % 4 == 0)
+            CoverageIndex::instance().mark_blp(gateway_id, node_mac_address, std::time(nullptr));
     }
 
     return 0;
@@ -2451,13 +2626,125 @@ int MySqlDatabase::insert_billing_history_profile_data(std::array<uint8_t, 8> no
              push_status ? 1 : 0,
              push_status ? 1 : 0);
 
-    return execute_query(query_buf);
+    if (execute_query(query_buf) == FAILURE)
+        return FAILURE;
+
+    int billing_year = 0, billing_month = 0;
+    if (sscanf(billing_date_import_mode.c_str(), "%d-%d", &billing_year, &billing_month) == 2)
+    {
+        CoverageIndex::instance().mark_bhp_month(gateway_id, node_mac_address, billing_year, billing_month);
+    }
+
+    return SUCCESS;
+}
+
+// -1 until the first session checked dlms_on_demand_ping_request, then 0/1 for the whole process
+static std::atomic<int> ping_rtt_columns{-1};
+
+/**
+ * @brief Checks once per process whether dlms_on_demand_ping_request has the RTT distribution columns
+ *
+ * Deployments that have not run the ALTER adding ping_sent, ping_received,
+ * rtt_min_ms, rtt_p95_ms and loss_percent keep getting status and average only.
+ */
+int MySqlDatabase::detect_ping_summary_schema(void)
+{
+    if (ping_rtt_columns.load(std::memory_order_acquire) != -1)
+        return SUCCESS;
+
+    char query_buf[128] = {0};
+    snprintf(query_buf, sizeof(query_buf), "SHOW COLUMNS FROM dlms_on_demand_ping_request LIKE 'rtt_p95_ms';");
+
+    int rows = this->query_each_row(query_buf, [](MYSQL_ROW) {});
+    if (rows == FAILURE)
+        return FAILURE; // Asked again by the next session
+
+    ping_rtt_columns.store((rows > 0) ? 1 : 0, std::memory_order_release);
+    this->print_and_log("Ping summary RTT columns %s\n", (rows > 0) ? "present" : "missing, writing status and average only");
+    return SUCCESS;
+}
+
+bool MySqlDatabase::has_ping_rtt_columns(void) const
+{
+    return ping_rtt_columns.load(std::memory_order_acquire) == 1;
+}
+
+int MySqlDatabase::load_event_code_dictionary(void)
+{
+    EventCodeDictionary &dictionary = EventCodeDictionary::instance();
+
+    if (!dictionary.needs_refresh())
+        return SUCCESS;
+
+    // Another gateway thread is already loading, keep using the current table
+    if (!dictionary.begin_refresh())
+        return dictionary.is_loaded() ? SUCCESS : FAILURE;
+
+    this->print_and_log("%s start\n", __FUNCTION__);
+
+    try
+    {
+        dictionary.set_refresh_interval(Utility::readConfig<int>("HES.event_code_refresh_sec"));
+    }
+    catch (const std::exception &e)
+    {
+        this->print_and_log("Error: %s\n", e.what());
+    }
+
+    char query_buf[128] = {0};
+    snprintf(query_buf, sizeof(query_buf), "SELECT event_code, event_string FROM dlms_event_codes;");
+
+    MYSQL_RES *res = nullptr;
+    if (this->execute_query(query_buf) || !(res = mysql_store_result(this->mysql)))
+    {
+        dictionary.finish_refresh(nullptr);
+        return FAILURE;
+    }
+
+    auto table = std::make_shared<EventCodeDictionary::Table>(EVENT_CODE_TABLE_SIZE);
+    int count = 0;
+
+    MYSQL_ROW row;
+    while ((row = mysql_fetch_row(res)))
+    {
+        if (!row[0] || !row[1])
+            continue;
+
+        unsigned long code = strtoul(row[0], nullptr, 10);
+        if (code >= EVENT_CODE_TABLE_SIZE)
+            continue;
+
+        (*table)[code] = row[1];
+        count++;
+    }
+
+    mysql_free_result(res);
+
+    dictionary.finish_refresh(table);
+
+    this->print_and_log("Event code dictionary loaded: %d codes\n", count);
+
+    return SUCCESS;
 }
 
 std::string MySqlDatabase::get_event_code_string_from_event_code(uint16_t event_code)
 {
+    EventCodeDictionary &dictionary = EventCodeDictionary::instance();
+
+    int loaded = SUCCESS;
+    if (dictionary.needs_refresh())
+        loaded = this->load_event_code_dictionary();
+
+    if (dictionary.is_loaded())
+        return dictionary.lookup(event_code);
+
+    // Waiting out the retry interval of a failed load, no per-code query either
+    if (loaded == SUCCESS)
+        return "";
+
     this->print_and_log("%s start\n", __FUNCTION__);
 
+    // Dictionary not available (DB error at load), query the single code
     char query_buf[512] = {0};
 
     snprintf(query_buf, sizeof(query_buf), "SELECT event_string FROM dlms_event_codes WHERE event_code = %u", event_code);
@@ -2485,12 +2772,52 @@ int MySqlDatabase::insert_update_hes_nms_sync_time(const char *gateway_mac, int
 {
     this->print_and_log("%s start\n", __FUNCTION__);
 
-    char query_buffer[4096] = {0};
+    NmsLeaseManager &leases = NmsLeaseManager::instance();
+
+    if (status == 1)
+    {
+        this->print_and_log("HES trying to acquire the network\n");
+
+        // Watcher has not seen NMS release it yet, no need to ask the DB
+        if (leases.is_held_by_nms(gateway_mac))
+        {
+            this->print_and_log("NMS acquired this gateway\n");
+            return FAILURE;
+        }
+    }
+    else
+    {
+        this->print_and_log("HES releasing the network\n");
+    }
+
+    char query_buffer[512] = {0};
+
+    // Compare-and-set in one statement: acquire only while NMS does not hold the gateway
+    snprintf(query_buffer, sizeof(query_buffer),
+             "update hes_nms_sync_time set hes_last_rf_network_aquired_time='%s', gateway_aquired_by_hes='%d' where gateway_id='%s'%s;",
+             this->now().c_str(), status, gateway_mac,
+             (status != 0) ? " and COALESCE(gateway_aquired_by_nms, 0) <> 1" : "");
 
+    if (this->execute_query(query_buffer))
+    {
+        leases.set_state(gateway_mac, NmsLeaseState::UNKNOWN); // DB error, not an NMS hold
+        return FAILURE;
+    }
+
+    NmsLeaseState next_state = (status != 0) ? NmsLeaseState::HELD_BY_HES : NmsLeaseState::FREE;
+
+    if (mysql_affected_rows(this->mysql) > 0)
+    {
+        leases.set_state(gateway_mac, next_state);
+        return SUCCESS;
+    }
+
+    // Nothing changed: no row yet, NMS holds the gateway, or same value within the same second
     snprintf(query_buffer, sizeof(query_buffer), "select gateway_aquired_by_nms FROM hes_nms_sync_time where gateway_id='%s' ", gateway_mac);
 
     if (this->execute_query(query_buffer))
     {
+        leases.set_state(gateway_mac, NmsLeaseState::UNKNOWN);
         return FAILURE;
     }
 
@@ -2498,42 +2825,65 @@ int MySqlDatabase::insert_update_hes_nms_sync_time(const char *gateway_mac, int
     if (!result)
     {
         this->print_and_log("MySQL store result failed\n");
+        leases.set_state(gateway_mac, NmsLeaseState::UNKNOWN);
         return FAILURE;
     }
 
-    int num_row = mysql_num_rows(result);
+    MYSQL_ROW row = mysql_fetch_row(result);
+    bool row_exists = (row != nullptr);
+    int nms_status = (row && row[0]) ? atoi(row[0]) : 0;
+    mysql_free_result(result);
 
-    if (num_row == 1)
+    if (row_exists)
     {
-        MYSQL_ROW row = mysql_fetch_row(result);
-
-        if (status == 1)
-        {
-            this->print_and_log("HES trying to acquire the network\n");
-        }
-        else
-        {
-            this->print_and_log("HES releasing the network\n");
-        }
+        this->print_and_log("NMS status: %d\n", nms_status);
 
-        this->print_and_log("NMS status: %d\n", atoi(row[0]));
-
-        if ((status != 0) && (atoi(row[0]) == 1))
+        if ((status != 0) && (nms_status == 1))
         {
             this->print_and_log("NMS acquired this gateway\n");
-            mysql_free_result(result);
+            leases.set_state(gateway_mac, NmsLeaseState::HELD_BY_NMS);
             return FAILURE;
         }
 
-        snprintf(query_buffer, sizeof(query_buffer), "update hes_nms_sync_time set hes_last_rf_network_aquired_time='%s', gateway_aquired_by_hes='%d' where gateway_id='%s' ", this->now().c_str(), status, gateway_mac);
+        leases.set_state(gateway_mac, next_state);
+        return SUCCESS;
     }
-    else
+
+    snprintf(query_buffer, sizeof(query_buffer), "insert into hes_nms_sync_time(gateway_id, gateway_aquired_by_hes, hes_last_rf_network_aquired_time) values('%s','%d','%s')", gateway_mac, status, this->now().c_str());
+
+    if (this->execute_query(query_buffer))
     {
-        snprintf(query_buffer, sizeof(query_buffer), "insert into hes_nms_sync_time(gateway_id, gateway_aquired_by_hes, hes_last_rf_network_aquired_time) values('%s','%d','%s')", gateway_mac, status, this->now().c_str());
+        leases.set_state(gateway_mac, NmsLeaseState::UNKNOWN);
+        return FAILURE;
     }
 
-    mysql_free_result(result);
-    return this->execute_query(query_buffer);
+    leases.set_state(gateway_mac, next_state);
+    return SUCCESS;
+}
+
+int MySqlDatabase::get_nms_released_gateways(const std::vector<std::string> &gateway_ids, std::vector<std::string> &released)
+{
+    released.clear();
+
+    if (gateway_ids.empty())
+    {
+        return SUCCESS;
+    }
+
+    std::string query = "select gateway_id FROM hes_nms_sync_time where COALESCE(gateway_aquired_by_nms, 0) <> 1 and gateway_id in (";
+    for (size_t i = 0; i < gateway_ids.size(); i++)
+    {
+        query += (i ? ",'" : "'") + gateway_ids[i] + "'";
+    }
+    query += ");";
+
+    int rows = this->query_each_row(&query[0], [&released](MYSQL_ROW row)
+                                    {
+                                        if (row[0])
+                                            released.emplace_back(row[0]);
+                                    });
+
+    return (rows == FAILURE) ? FAILURE : SUCCESS;
 }
 
 #if PUSH_EVENT_DETAILED_PARSING
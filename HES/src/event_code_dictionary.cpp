@@ -0,0 +1,69 @@
+#include "../inc/event_code_dictionary.h"
+
+static int64_t steady_seconds(void)
+{
+    return std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+EventCodeDictionary &EventCodeDictionary::instance()
+{
+    static EventCodeDictionary dictionary;
+    return dictionary;
+}
+
+bool EventCodeDictionary::is_loaded() const
+{
+    return std::atomic_load(&this->table) != nullptr;
+}
+
+bool EventCodeDictionary::needs_refresh() const
+{
+    int64_t now = steady_seconds();
+
+    // DB outage: one attempt per retry interval, not one per lookup
+    int64_t failed_at = this->failed_at_sec.load();
+    if (failed_at != 0 && (now - failed_at) < EVENT_CODE_RETRY_SEC)
+        return false;
+
+    if (!this->is_loaded())
+        return true;
+
+    return (now - this->loaded_at_sec.load()) >= this->refresh_interval_sec.load();
+}
+
+bool EventCodeDictionary::begin_refresh()
+{
+    bool expected = false;
+    return this->refreshing.compare_exchange_strong(expected, true);
+}
+
+void EventCodeDictionary::finish_refresh(std::shared_ptr<const Table> new_table)
+{
+    if (new_table)
+    {
+        std::atomic_store(&this->table, new_table);
+        this->loaded_at_sec.store(steady_seconds());
+        this->failed_at_sec.store(0);
+    }
+    else
+    {
+        this->failed_at_sec.store(steady_seconds());
+    }
+
+    this->refreshing.store(false);
+}
+
+std::string EventCodeDictionary::lookup(uint16_t event_code) const
+{
+    std::shared_ptr<const Table> snapshot = std::atomic_load(&this->table);
+    if (!snapshot)
+        return "";
+
+    return (*snapshot)[event_code];
+}
+
+void EventCodeDictionary::set_refresh_interval(int seconds)
+{
+    if (seconds > 0)
+        this->refresh_interval_sec.store(seconds);
+}
@@ -0,0 +1,118 @@
+#include "../inc/frame_buffer.h"
+
+#include <cstring>
+#include <utility>
+
+FramePool &FramePool::local(void)
+{
+    thread_local FramePool pool;
+    return pool;
+}
+
+uint8_t *FramePool::acquire(void)
+{
+    if (this->spare.empty())
+        return new uint8_t[FRAME_BUFFER_SIZE];
+
+    uint8_t *buf = this->spare.back();
+    this->spare.pop_back();
+    return buf;
+}
+
+void FramePool::release(uint8_t *buf)
+{
+    if (this->spare.size() >= FRAME_POOL_MAX_SPARE)
+    {
+        delete[] buf;
+        return;
+    }
+
+    if (this->spare.capacity() == 0)
+        this->spare.reserve(FRAME_POOL_MAX_SPARE);
+    this->spare.push_back(buf);
+}
+
+FramePool::~FramePool()
+{
+    for (uint8_t *buf : this->spare)
+        delete[] buf;
+}
+
+FrameBuffer::FrameBuffer(FrameBuffer &&other) noexcept : buf(other.buf), length(other.length), overflow(other.overflow)
+{
+    other.buf = nullptr;
+    other.length = 0;
+    other.overflow = false;
+}
+
+FrameBuffer &FrameBuffer::operator=(FrameBuffer &&other) noexcept
+{
+    if (this != &other)
+    {
+        std::swap(this->buf, other.buf);
+        std::swap(this->length, other.length);
+        std::swap(this->overflow, other.overflow);
+    }
+    return *this;
+}
+
+FrameBuffer::~FrameBuffer()
+{
+    // Goes back to the pool of the thread destroying the frame, every buffer has the same size
+    if (this->buf)
+        FramePool::local().release(this->buf);
+}
+
+bool FrameBuffer::reserve(size_t length)
+{
+    if (length > FRAME_BUFFER_SIZE)
+    {
+        this->overflow = true;
+        return false;
+    }
+
+    if (!this->buf)
+        this->buf = FramePool::local().acquire();
+    return true;
+}
+
+uint8_t *FrameBuffer::data(void)
+{
+    this->reserve(0);
+    return this->buf;
+}
+
+void FrameBuffer::push(uint8_t value)
+{
+    if (this->reserve(this->length + 1))
+        this->buf[this->length++] = value;
+}
+
+void FrameBuffer::push(const void *src, size_t length)
+{
+    if (length == 0 || !this->reserve(this->length + length))
+        return;
+
+    memcpy(this->buf + this->length, src, length);
+    this->length += length;
+}
+
+void FrameBuffer::assign(const uint8_t *src, size_t length)
+{
+    this->length = 0;
+    this->push(src, length);
+}
+
+void FrameBuffer::resize(size_t length)
+{
+    if (length > FRAME_BUFFER_SIZE)
+    {
+        this->overflow = true;
+        length = FRAME_BUFFER_SIZE;
+    }
+    this->reserve(length);
+
+    if (length > this->length)
+        memset(this->buf + this->length, 0, length - this->length);
+    this->length = length;
+}
@@ -62,26 +62,12 @@ void Fuota::process_fuota_queue()
     if (this->pending_terminal_complete.load())
     {
         int pid = this->pending_terminal_request_id.load();
-        if (pid >= 0 && !client.RF_Meter_FUOTA.empty())
+        QueuedCommand *front = client.RF_Meter_FUOTA.front();
+        if (pid >= 0 && front && front->request_id == pid)
         {
-            const std::vector<uint8_t> &front_bytes = client.RF_Meter_FUOTA.front();
-            std::string front_cmd(front_bytes.begin(), front_bytes.end());
-            auto parts = client.split(front_cmd, ':');
-            if (!parts.empty())
-            {
-                try
-                {
-                    int front_req_id = std::stoi(parts[0]);
-                    if (front_req_id == pid)
-                    {
-                        this->print_and_log("(%s) [FUOTA] Dequeuing completed request %d as instructed by status update.\n", client.gateway_id, pid);
-                        client.RF_Meter_FUOTA.pop();
-                    }
-                }
-                catch (...)
-                {
-                }
-            }
+            this->print_and_log("(%s) [FUOTA] Dequeuing completed request %d as instructed by status update.\n", client.gateway_id, pid);
+            client.take_cancelled(pid);
+            client.RF_Meter_FUOTA.pop();
         }
         this->pending_terminal_complete.store(false);
         this->pending_terminal_request_id.store(-1);
@@ -95,22 +81,22 @@ void Fuota::process_fuota_queue()
     }
 
     // 🔥 Dequeue ONLY ONE command
-    if (!client.dequeue_fuota(this->cmd_bytes))
+    QueuedCommand cmd;
+    if (!client.dequeue_fuota(cmd))
         return;
 
-    std::string cmd(this->cmd_bytes.begin(), this->cmd_bytes.end());
-    auto parts = client.split(cmd, ':');
+    this->cmd_bytes = cmd.bytes();
 
-    if (parts.size() < 7)
+    if (cmd.field_count < 7)
     {
         print_and_log("Invalid FUOTA command format\n");
         return;
     }
 
-    client.request_id = std::stoi(parts[0]);
-    client.hop_count = std::stoi(parts[2]);
-    this->firmware_path = parts[5];
-    this->firmware_file = parts[6];
+    client.request_id = cmd.request_id;
+    client.hop_count = cmd.hop_count;
+    this->firmware_path = cmd.field(FIRMWARE_PATH);
+    this->firmware_file = cmd.field(FIRMWARE_FILE_NAME);
 
     print_and_log("[FUOTA] Dequeued REQ=%d FW=%s\n", client.request_id, this->firmware_file.c_str());
     ondemand_fuota_state = FUOTA_STATE::OPEN_FILE;
@@ -332,29 +318,10 @@ int Fuota::get_min_payload_size(int header_len)
 
 int Fuota::client_get_time(char *time_str)
 {
-    char rxd_time[26] = {0};
-    int millisec;
-    struct tm newtime;
-    time_t ltime;
-    struct timeval tv;
-    const char *fmt = "%Y-%m-%d %X";
-    gettimeofday(&tv, NULL);
-
-    millisec = lrint(tv.tv_usec / 1000.0); // Round to nearest millisec
-    if (millisec >= 1000)
-    {
-        millisec -= 1000;
-        tv.tv_sec++;
-    }
-    ltime = time(&ltime);
-    localtime_r(&ltime, &newtime);
+    int millisec = 0;
 
-    if (strftime(rxd_time, sizeof(rxd_time), fmt, &newtime) == 0)
-    {
-        fprintf(stderr, "strftime returned 0");
-        return -1;
-    }
-    sprintf(time_str, "%s", rxd_time);
+    // Same clock and format as the log/DB timestamps, seconds in time_str, milliseconds returned
+    sprintf(time_str, "%s", WallClock::now(&millisec));
     return millisec;
 }
 
@@ -506,7 +473,7 @@ LastSectorStatus Fuota::rffuota_read_lastsector_page_and_subpage_status()
 
         this->print_and_log("(%s) -> Attempt %d to read lastsector page\n", client.gateway_id, attempt);
         // --- TX ---
-        ssize_t sent = write(client.get_client_socket(), this->client_tx_buffer, this->client_tx_buffer[1] + 1);
+        ssize_t sent = client.gateway_io.send(this->client_tx_buffer, this->client_tx_buffer[1] + 1);
         if (sent < 0)
         {
 
@@ -523,7 +490,7 @@ LastSectorStatus Fuota::rffuota_read_lastsector_page_and_subpage_status()
 
         // --- RX ---
         uint8_t resp[512] = {0};
-        ssize_t rlen = read(client.get_client_socket(), resp, sizeof(resp));
+        ssize_t rlen = client.gateway_io.recv(resp, sizeof(resp));
 
         if (rlen <= 0)
         {
@@ -1605,7 +1572,7 @@ int Fuota::frame_a_retry_comamnd_for_pmesh_routine()
     {
         if (send_req_count < cntx.max_retries)
         {
-            l_written = send(client.get_client_socket(), last_command, last_command_length - 1, 0);
+            l_written = client.gateway_io.send(last_command, last_command_length - 1);
 
             gettimeofday(&this->startTime, nullptr);
             // page_ctx.current_page++;
@@ -3181,7 +3148,7 @@ unsigned int Fuota::fuota_uploading_process()
 
             this->print_and_log("\n");
 
-            int write_ret = write(client.get_client_socket(), this->image_tf_command, command_length);
+            int write_ret = client.gateway_io.send(this->image_tf_command, command_length);
             if (write_ret < 0)
             {
                 this->print_and_log("WriteFailed:%d\n", (unsigned char *)strerror(errno));
@@ -3189,7 +3156,7 @@ unsigned int Fuota::fuota_uploading_process()
                 return e_failure;
             }
             struct pollfd pfd{client.get_client_socket(), POLLIN, 0};
-            int poll_ret = poll(&pfd, 1, 12000);
+            int poll_ret = client.gateway_io.poll(&pfd, 1, 12000);
 
             if (poll_ret == 0)
             {
@@ -3198,7 +3165,7 @@ unsigned int Fuota::fuota_uploading_process()
                 continue;
             }
 
-            no_of_bytes_read_serial = read(client.get_client_socket(), this->fuota_rbuf, sizeof(this->fuota_rbuf));
+            no_of_bytes_read_serial = client.gateway_io.recv(this->fuota_rbuf, sizeof(this->fuota_rbuf));
 
             if (no_of_bytes_read_serial <= 0)
             {
@@ -3251,6 +3218,14 @@ unsigned int Fuota::fuota_uploading_process()
             }
         }
 
+        if (this->fuota_imagetf_retry_count < MAX_FUOTA_RETRIES)
+        {
+            static MetricCounter &subpages = Metrics::instance().counter("hes_fuota_subpages_total");
+            static MetricCounter &bytes = Metrics::instance().counter("hes_fuota_bytes_total");
+            subpages.fetch_add(1, std::memory_order_relaxed);
+            bytes.fetch_add(static_cast<uint64_t>(payload_len), std::memory_order_relaxed);
+        }
+
         /* ---------- ADVANCE PAGE / SUBPAGE ---------- */
         if (!last_subpage)
             subpage_count++;
@@ -4049,18 +4024,12 @@ bool Fuota::wait_for_socket_response(int timeout_secs)
 
     while (rf_retry_count < RFMAX_RETRIES)
     {
-        fd_set read_fds;
-        struct timeval timeout;
-        FD_ZERO(&read_fds);
-        FD_SET(sd, &read_fds);
-
-        timeout.tv_sec = timeout_secs;
-        timeout.tv_usec = 0;
+        pollfd read_fd{sd, POLLIN, 0};
 
-        int sel = select(sd + 1, &read_fds, NULL, NULL, &timeout);
+        int sel = client.gateway_io.poll(&read_fd, 1, timeout_secs * 1000);
         if (sel < 0)
         {
-            perror("select");
+            perror("poll");
             return false;
         }
         else if (sel == 0)
@@ -4076,7 +4045,7 @@ bool Fuota::wait_for_socket_response(int timeout_secs)
                 ssize_t tosend = this->client_tx_buffer[1] + 1;
                 if (tosend > 0)
                 {
-                    ssize_t s = write(sd, this->client_tx_buffer, tosend);
+                    ssize_t s = client.gateway_io.send(this->client_tx_buffer, tosend);
                     if (s < 0)
                     {
                         this->print_and_log("(%s) -> Error re-sending after select timeout: %s\n", client.gateway_id, strerror(errno));
@@ -4087,11 +4056,11 @@ bool Fuota::wait_for_socket_response(int timeout_secs)
             continue;
         }
 
-        if (!FD_ISSET(sd, &read_fds))
+        if (!(read_fd.revents & POLLIN))
             continue;
 
         unsigned char tmp[1024];
-        ssize_t len = recv(sd, tmp, sizeof(tmp), 0);
+        ssize_t len = client.gateway_io.recv(tmp, sizeof(tmp));
         if (len <= 0)
         {
             if (len == 0)
@@ -4147,7 +4116,7 @@ bool Fuota::wait_for_socket_response(int timeout_secs)
                     ssize_t tosend = this->client_tx_buffer[1] + 1;
                     if (tosend > 0)
                     {
-                        ssize_t s = write(sd, this->client_tx_buffer, tosend);
+                        ssize_t s = client.gateway_io.send(this->client_tx_buffer, tosend);
                         if (s < 0)
                         {
                             this->print_and_log("Error re-sending: %s\n", strerror(errno));
@@ -4170,7 +4139,7 @@ bool Fuota::wait_for_socket_response(int timeout_secs)
                     ssize_t tosend = this->client_tx_buffer[1] + 1;
                     if (tosend > 0)
                     {
-                        ssize_t s = write(sd, this->client_tx_buffer, tosend);
+                        ssize_t s = client.gateway_io.send(this->client_tx_buffer, tosend);
                         if (s < 0)
                         {
                             this->print_and_log("Error re-sending: %s\n", strerror(errno));
@@ -4435,27 +4404,18 @@ int Fuota::client_process_ondemand_data(void)
 
     memset(&this->router_path, 0, sizeof(path_details));
 
-    while (!client.RF_Meter_FUOTA.empty())
+    while (QueuedCommand *cmd = client.RF_Meter_FUOTA.front())
     {
-        this->cmd_bytes = client.RF_Meter_FUOTA.front();
-
-        std::string cmd_str(this->cmd_bytes.begin(), this->cmd_bytes.end());
-        std::vector<std::string> parts = client.split(cmd_str, ':');
-
-        int request_id = -1;
-        if (parts.size() > 0 && !parts[0].empty())
-            request_id = std::stoi(parts[0]);
-
-        std::vector<uint8_t> hex_data;
-        if (parts.size() > 5 && !parts[5].empty())
+        if (client.take_cancelled(cmd->request_id))
         {
-            std::string hex_field = parts[5];
-            for (size_t i = 0; i + 1 < hex_field.length(); i += 2)
-            {
-                std::string byte_str = hex_field.substr(i, 2);
-                hex_data.push_back(static_cast<uint8_t>(std::stoul(byte_str, nullptr, 16)));
-            }
+            client.RF_Meter_FUOTA.pop();
+            continue;
         }
+        this->cmd_bytes = cmd->bytes();
+
+        int request_id = cmd->request_id;
+
+        std::vector<uint8_t> hex_data(cmd->payload, cmd->payload + cmd->payload_len);
 
         this->print_and_log("FUOTA: RequestID = %d HexDataLen = %zu\n", request_id, hex_data.size());
 
@@ -0,0 +1,827 @@
+#include "../inc/gateway_io.h"
+
+#include <errno.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <iostream>
+#include <mutex>
+
+#include "../inc/utility.h"
+
+#ifdef HES_WITH_IO_URING
+#include <linux/io_uring.h>
+// Multishot receive and cancel-any arrived with the Linux 6.0 uapi headers, older ones build the poll/recv/send path alone
+#if defined(IORING_RECV_MULTISHOT) && defined(IORING_ASYNC_CANCEL_ANY) && defined(IORING_SETUP_COOP_TASKRUN)
+#define GATEWAY_IO_URING 1
+#endif
+#endif
+
+#ifdef GATEWAY_IO_URING
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#define GATEWAY_IO_FLUSH_MS  2000 // longest a detach waits for queued sends
+#define GATEWAY_IO_CANCEL_MS 1000 // then for the cancelled requests to give their buffers back
+
+static int remaining_ms(std::chrono::steady_clock::time_point deadline)
+{
+    auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+    return static_cast<int>(std::max<int64_t>(0, left));
+}
+
+enum GatewayIoOp : uint32_t
+{
+    OP_RECV = 1,
+    OP_SEND,
+    OP_POLL,
+    OP_CANCEL
+};
+
+static std::atomic<bool> uring_unusable{false}; // latched by the first session the kernel turned down
+
+// Opt-in: HES.io_uring must be set to true
+static bool uring_enabled(void)
+{
+    static const bool enabled = []() {
+        try
+        {
+            return Utility::readConfig<bool>("HES.io_uring");
+        }
+        catch (const std::exception &e)
+        {
+            std::cout << "HES.io_uring not set, gateway sockets use poll/recv/send" << std::endl;
+        }
+        return false;
+    }();
+
+    return enabled && !uring_unusable.load(std::memory_order_relaxed);
+}
+
+static void uring_turned_down(const char *what, int err)
+{
+    if (!uring_unusable.exchange(true))
+        std::cout << "io_uring unavailable (" << what << ": " << strerror(err) << "), gateway sockets use poll/recv/send" << std::endl;
+}
+
+static uint64_t op_tag(GatewayIoOp op, uint32_t index)
+{
+    return (static_cast<uint64_t>(op) << 32) | index;
+}
+
+struct GatewayIo::Uring
+{
+    struct Segment
+    {
+        uint16_t bid;
+        uint32_t offset, length;
+    };
+
+    struct Watch
+    {
+        int fd;
+        bool armed, fired;
+    };
+
+    int ring_fd = -1;
+    int socket_fd = -1;
+
+    uint8_t *rings = nullptr; // SQ and CQ rings share one mapping (IORING_FEAT_SINGLE_MMAP)
+    size_t rings_size = 0;
+    io_uring_sqe *sqes = nullptr;
+    size_t sqes_size = 0;
+    unsigned *sq_head = nullptr, *sq_tail = nullptr, *sq_array = nullptr;
+    unsigned sq_mask = 0, sq_entries = 0;
+    unsigned *cq_head = nullptr, *cq_tail = nullptr;
+    unsigned cq_mask = 0;
+    io_uring_cqe *cqes = nullptr;
+    unsigned in_flight = 0; // requests the kernel has not finished with
+    bool cancel_pending = false;
+
+    // Provided buffer group 0: the multishot receive picks a buffer for every completion
+    uint8_t *buf_ring = nullptr;
+    size_t buf_ring_size = 0;
+    uint8_t *rx_memory = nullptr;
+    uint16_t buf_tail = 0;
+    bool buf_ring_registered = false;
+
+    std::deque<Segment> rx; // received, not yet handed out, each holds its buffer
+    bool recv_armed = false, rx_eof = false, got_data = false, unsupported = false;
+    int rx_error = 0;
+
+    // Queued sends are coalesced into one SEND; a second batch waits for the first to complete
+    std::vector<uint8_t> tx_queued, tx_inflight;
+    size_t tx_offset = 0;
+    bool tx_busy = false;
+    int tx_error = 0;
+
+    std::vector<Watch> watches; // other fds polled next to the socket, armed once per session
+
+    static std::unique_ptr<Uring> open(int socket_fd, const char *&what, int &err);
+    static void park(std::unique_ptr<Uring> u);
+    ~Uring();
+
+    io_uring_sqe *get_sqe(void);
+    int enter(unsigned wait_nr, int timeout_ms);
+    void reap(void);
+    void pump(void);
+    void provide(uint16_t bid);
+    size_t take(uint8_t *buf, size_t length);
+    Watch &watch(int fd);
+    void cancel_all(void);
+};
+
+std::unique_ptr<GatewayIo::Uring> GatewayIo::Uring::open(int socket_fd, const char *&what, int &err)
+{
+    std::unique_ptr<Uring> u(new Uring());
+    u->socket_fd = socket_fd;
+
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_SUBMIT_ALL | IORING_SETUP_COOP_TASKRUN;
+    u->ring_fd = static_cast<int>(syscall(__NR_io_uring_setup, GATEWAY_IO_RING_ENTRIES, &params));
+    if (u->ring_fd < 0 && errno == EINVAL)
+    {
+        memset(&params, 0, sizeof(params));
+        u->ring_fd = static_cast<int>(syscall(__NR_io_uring_setup, GATEWAY_IO_RING_ENTRIES, &params));
+    }
+    if (u->ring_fd < 0)
+    {
+        what = "io_uring_setup";
+        err = errno;
+        return nullptr;
+    }
+
+    const unsigned required = IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP | IORING_FEAT_EXT_ARG;
+    if ((params.features & required) != required)
+    {
+        what = "ring features";
+        err = EOPNOTSUPP;
+        return nullptr;
+    }
+
+    u->rings_size = std::max<size_t>(params.sq_off.array + params.sq_entries * sizeof(unsigned), params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe));
+    void *rings = mmap(nullptr, u->rings_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, u->ring_fd, IORING_OFF_SQ_RING);
+    u->sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+    void *sqes = mmap(nullptr, u->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, u->ring_fd, IORING_OFF_SQES);
+    u->rings = rings == MAP_FAILED ? nullptr : static_cast<uint8_t *>(rings);
+    u->sqes = sqes == MAP_FAILED ? nullptr : static_cast<io_uring_sqe *>(sqes);
+    if (!u->rings || !u->sqes)
+    {
+        what = "mmap";
+        err = errno;
+        return nullptr;
+    }
+
+    u->sq_head = reinterpret_cast<unsigned *>(u->rings + params.sq_off.head);
+    u->sq_tail = reinterpret_cast<unsigned *>(u->rings + params.sq_off.tail);
+    u->sq_array = reinterpret_cast<unsigned *>(u->rings + params.sq_off.array);
+    u->sq_mask = *reinterpret_cast<unsigned *>(u->rings + params.sq_off.ring_mask);
+    u->sq_entries = *reinterpret_cast<unsigned *>(u->rings + params.sq_off.ring_entries);
+    u->cq_head = reinterpret_cast<unsigned *>(u->rings + params.cq_off.head);
+    u->cq_tail = reinterpret_cast<unsigned *>(u->rings + params.cq_off.tail);
+    u->cq_mask = *reinterpret_cast<unsigned *>(u->rings + params.cq_off.ring_mask);
+    u->cqes = reinterpret_cast<io_uring_cqe *>(u->rings + params.cq_off.cqes);
+
+    long page = sysconf(_SC_PAGESIZE);
+    u->buf_ring_size = (GATEWAY_IO_RX_BUFFERS * sizeof(io_uring_buf) + page - 1) / page * page;
+    void *buf_ring = mmap(nullptr, u->buf_ring_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (buf_ring == MAP_FAILED)
+    {
+        what = "mmap";
+        err = errno;
+        return nullptr;
+    }
+    u->buf_ring = static_cast<uint8_t *>(buf_ring);
+
+    io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = reinterpret_cast<uint64_t>(u->buf_ring);
+    reg.ring_entries = GATEWAY_IO_RX_BUFFERS;
+    reg.bgid = 0;
+    if (syscall(__NR_io_uring_register, u->ring_fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0)
+    {
+        what = "provided buffer ring";
+        err = errno;
+        return nullptr;
+    }
+    u->buf_ring_registered = true;
+
+    u->rx_memory = new uint8_t[GATEWAY_IO_RX_BUFFERS * GATEWAY_IO_RX_BUFFER_SIZE];
+    for (uint16_t bid = 0; bid < GATEWAY_IO_RX_BUFFERS; bid++)
+        u->provide(bid);
+
+    return u;
+}
+
+GatewayIo::Uring::~Uring()
+{
+    if (this->buf_ring_registered)
+    {
+        io_uring_buf_reg reg;
+        memset(&reg, 0, sizeof(reg));
+        reg.bgid = 0;
+        syscall(__NR_io_uring_register, this->ring_fd, IORING_UNREGISTER_PBUF_RING, &reg, 1);
+    }
+    if (this->sqes)
+        munmap(this->sqes, this->sqes_size);
+    if (this->rings)
+        munmap(this->rings, this->rings_size);
+    if (this->ring_fd >= 0)
+        close(this->ring_fd);
+    if (this->buf_ring)
+        munmap(this->buf_ring, this->buf_ring_size);
+    delete[] this->rx_memory; // park() holds a ring until no request is left to use it
+}
+
+/*
+ * A ring closed with requests the kernel has not given back yet cannot free
+ * the buffers they use. It stays here, ring fd open, and every later close
+ * cancels and reaps it again and frees it once nothing is pending, so only
+ * the sessions closed while the kernel was stuck are ever held.
+ */
+void GatewayIo::Uring::park(std::unique_ptr<Uring> u)
+{
+    static std::mutex parked_mutex;
+    // Never destroyed: detached gateway threads may still close their session during exit
+    static std::vector<std::unique_ptr<Uring>> *parked = new std::vector<std::unique_ptr<Uring>>();
+
+    std::lock_guard<std::mutex> lock(parked_mutex);
+
+    for (auto it = parked->begin(); it != parked->end();)
+    {
+        Uring &p = **it;
+        if (p.in_flight > 0 && !p.cancel_pending)
+            p.cancel_all();
+        if (p.enter(0, 0) >= 0)
+            p.reap();
+
+        if (p.in_flight == 0)
+            it = parked->erase(it);
+        else
+            ++it;
+    }
+
+    if (u && u->in_flight > 0)
+        parked->push_back(std::move(u));
+}
+
+io_uring_sqe *GatewayIo::Uring::get_sqe(void)
+{
+    unsigned tail = *this->sq_tail;
+    if (tail - __atomic_load_n(this->sq_head, __ATOMIC_ACQUIRE) >= this->sq_entries)
+        this->enter(0, 0);
+
+    unsigned index = tail & this->sq_mask;
+    io_uring_sqe *sqe = &this->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    this->sq_array[index] = index;
+    __atomic_store_n(this->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    this->in_flight++;
+    return sqe;
+}
+
+// Submits everything queued and, with wait_nr, waits up to timeout_ms (-1 forever) for completions
+int GatewayIo::Uring::enter(unsigned wait_nr, int timeout_ms)
+{
+    unsigned to_submit = *this->sq_tail - __atomic_load_n(this->sq_head, __ATOMIC_ACQUIRE);
+
+    io_uring_getevents_arg arg;
+    memset(&arg, 0, sizeof(arg));
+    __kernel_timespec ts;
+    ts.tv_sec = timeout_ms / 1000;
+    ts.tv_nsec = static_cast<long long>(timeout_ms % 1000) * 1000000;
+    arg.sigmask_sz = _NSIG / 8;
+    if (timeout_ms >= 0)
+        arg.ts = reinterpret_cast<uint64_t>(&ts);
+
+    int ret = static_cast<int>(syscall(__NR_io_uring_enter, this->ring_fd, to_submit, wait_nr, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(arg)));
+    if (ret < 0 && (errno == ETIME || errno == EINTR || errno == EAGAIN || errno == EBUSY))
+        return 0;
+    return ret;
+}
+
+void GatewayIo::Uring::reap(void)
+{
+    unsigned head = *this->cq_head;
+    unsigned tail = __atomic_load_n(this->cq_tail, __ATOMIC_ACQUIRE);
+
+    for (; head != tail; head++)
+    {
+        const io_uring_cqe &cqe = this->cqes[head & this->cq_mask];
+        GatewayIoOp op = static_cast<GatewayIoOp>(cqe.user_data >> 32);
+        uint32_t index = static_cast<uint32_t>(cqe.user_data);
+        bool more = cqe.flags & IORING_CQE_F_MORE;
+
+        if (op == OP_RECV)
+        {
+            if (cqe.flags & IORING_CQE_F_BUFFER)
+            {
+                uint16_t bid = static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+                if (cqe.res > 0)
+                    this->rx.push_back({bid, 0, static_cast<uint32_t>(cqe.res)});
+                else
+                    this->provide(bid);
+            }
+
+            if (cqe.res > 0)
+                this->got_data = true;
+            else if (cqe.res == 0)
+                this->rx_eof = true;
+            else if (cqe.res == -EINVAL && !this->got_data)
+                this->unsupported = true; // multishot receive needs Linux 6.0
+            else if (cqe.res != -ENOBUFS && cqe.res != -ECANCELED)
+                this->rx_error = -cqe.res;
+
+            if (!more)
+            {
+                this->recv_armed = false; // ENOBUFS: rearmed once a buffer is handed back
+                this->in_flight--;
+            }
+        }
+        else if (op == OP_SEND)
+        {
+            this->in_flight--;
+            if (cqe.res < 0)
+            {
+                this->tx_error = -cqe.res;
+                this->tx_busy = false;
+            }
+            else if ((this->tx_offset += static_cast<size_t>(cqe.res)) >= this->tx_inflight.size())
+            {
+                this->tx_busy = false;
+            }
+            else
+            {
+                this->tx_busy = false; // the rest goes out ahead of anything queued meanwhile
+                this->tx_queued.insert(this->tx_queued.begin(), this->tx_inflight.begin() + this->tx_offset, this->tx_inflight.end());
+            }
+        }
+        else if (op == OP_POLL)
+        {
+            if (index < this->watches.size())
+            {
+                if (cqe.res > 0)
+                    this->watches[index].fired = true;
+                if (!more)
+                    this->watches[index].armed = false;
+            }
+            if (!more)
+                this->in_flight--;
+        }
+        else
+        {
+            if (op == OP_CANCEL)
+                this->cancel_pending = false;
+            this->in_flight--;
+        }
+    }
+
+    __atomic_store_n(this->cq_head, head, __ATOMIC_RELEASE);
+}
+
+// Prepares what the next enter should submit: a send batch, the receive and the polls
+void GatewayIo::Uring::pump(void)
+{
+    if (!this->tx_busy && !this->tx_queued.empty() && this->tx_error == 0)
+    {
+        this->tx_inflight.swap(this->tx_queued);
+        this->tx_queued.clear();
+        this->tx_offset = 0;
+        this->tx_busy = true;
+
+        io_uring_sqe *sqe = this->get_sqe();
+        sqe->opcode = IORING_OP_SEND;
+        sqe->fd = this->socket_fd;
+        sqe->addr = reinterpret_cast<uint64_t>(this->tx_inflight.data());
+        sqe->len = static_cast<uint32_t>(this->tx_inflight.size());
+        sqe->msg_flags = MSG_NOSIGNAL; // a short send is requeued by reap
+        sqe->user_data = op_tag(OP_SEND, 0);
+    }
+
+    if (!this->recv_armed && !this->rx_eof && this->rx_error == 0 && this->rx.size() < GATEWAY_IO_RX_BUFFERS)
+    {
+        io_uring_sqe *sqe = this->get_sqe();
+        sqe->opcode = IORING_OP_RECV;
+        sqe->fd = this->socket_fd;
+        sqe->ioprio = IORING_RECV_MULTISHOT;
+        sqe->flags = IOSQE_BUFFER_SELECT;
+        sqe->buf_group = 0;
+        sqe->user_data = op_tag(OP_RECV, 0);
+        this->recv_armed = true;
+    }
+
+    for (size_t i = 0; i < this->watches.size(); i++)
+    {
+        if (this->watches[i].armed)
+            continue;
+
+        io_uring_sqe *sqe = this->get_sqe();
+        sqe->opcode = IORING_OP_POLL_ADD;
+        sqe->fd = this->watches[i].fd;
+        sqe->poll32_events = POLLIN;
+        sqe->len = IORING_POLL_ADD_MULTI;
+        sqe->user_data = op_tag(OP_POLL, static_cast<uint32_t>(i));
+        this->watches[i].armed = true;
+    }
+}
+
+void GatewayIo::Uring::provide(uint16_t bid)
+{
+    io_uring_buf *bufs = reinterpret_cast<io_uring_buf *>(this->buf_ring);
+    io_uring_buf &buf = bufs[this->buf_tail & (GATEWAY_IO_RX_BUFFERS - 1)];
+
+    // Only addr, len and bid: resv of the first entry is the ring tail
+    buf.addr = reinterpret_cast<uint64_t>(this->rx_memory + static_cast<size_t>(bid) * GATEWAY_IO_RX_BUFFER_SIZE);
+    buf.len = GATEWAY_IO_RX_BUFFER_SIZE;
+    buf.bid = bid;
+
+    this->buf_tail++;
+    __atomic_store_n(&reinterpret_cast<io_uring_buf_ring *>(this->buf_ring)->tail, this->buf_tail, __ATOMIC_RELEASE);
+}
+
+// Copies out as much as fits, as one recv would, and hands emptied buffers back to the kernel
+size_t GatewayIo::Uring::take(uint8_t *buf, size_t length)
+{
+    size_t copied = 0;
+
+    while (copied < length && !this->rx.empty())
+    {
+        Segment &seg = this->rx.front();
+        size_t n = std::min<size_t>(length - copied, seg.length - seg.offset);
+        memcpy(buf + copied, this->rx_memory + static_cast<size_t>(seg.bid) * GATEWAY_IO_RX_BUFFER_SIZE + seg.offset, n);
+        copied += n;
+        seg.offset += static_cast<uint32_t>(n);
+
+        if (seg.offset == seg.length)
+        {
+            this->provide(seg.bid);
+            this->rx.pop_front();
+        }
+    }
+
+    return copied;
+}
+
+GatewayIo::Uring::Watch &GatewayIo::Uring::watch(int fd)
+{
+    for (Watch &w : this->watches)
+    {
+        if (w.fd == fd)
+            return w;
+    }
+
+    // Checked with poll on first use, the multishot poll only reports later wakeups reliably
+    this->watches.push_back({fd, false, true});
+    return this->watches.back();
+}
+
+void GatewayIo::Uring::cancel_all(void)
+{
+    io_uring_sqe *sqe = this->get_sqe();
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->cancel_flags = IORING_ASYNC_CANCEL_ANY;
+    sqe->user_data = op_tag(OP_CANCEL, 0);
+    this->cancel_pending = true;
+}
+
+bool GatewayIo::use_uring(void)
+{
+    if (this->uring)
+        return true;
+    if (this->direct || this->fd < 0 || !uring_enabled())
+        return false;
+
+    const char *what = "";
+    int err = 0;
+    this->uring = Uring::open(this->fd, what, err);
+    if (!this->uring)
+    {
+        this->direct = true;
+        if (err == ENOSYS || err == EPERM || err == EINVAL || err == EOPNOTSUPP)
+            uring_turned_down(what, err);
+        return false;
+    }
+    return true;
+}
+
+// One io_uring_enter: queued sends go out and the call returns on the next completion or timeout_ms
+bool GatewayIo::wait(int timeout_ms)
+{
+    Uring &u = *this->uring;
+
+    u.pump();
+    this->corked = false;
+    int ret = u.enter(1, timeout_ms);
+    u.reap();
+
+    if (ret < 0 || u.unsupported)
+    {
+        if (u.unsupported)
+            uring_turned_down("multishot receive", EINVAL);
+        else
+            std::cout << "io_uring_enter: " << strerror(errno) << ", socket " << this->fd << " falls back to poll/recv/send" << std::endl;
+        this->close_uring();
+        this->direct = true;
+        return false;
+    }
+    return true;
+}
+
+void GatewayIo::submit(void)
+{
+    Uring &u = *this->uring;
+
+    u.pump();
+    if (u.enter(0, 0) < 0)
+    {
+        this->close_uring();
+        this->direct = true;
+        return;
+    }
+    u.reap();
+}
+
+/*
+ * Sends what is still queued, cancels the receive and the polls, and keeps
+ * whatever was read ahead in preloaded so nothing received is lost.
+ */
+void GatewayIo::close_uring(void)
+{
+    if (!this->uring)
+        return;
+
+    Uring &u = *this->uring;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(GATEWAY_IO_FLUSH_MS);
+
+    while ((u.tx_busy || !u.tx_queued.empty()) && u.tx_error == 0 && remaining_ms(deadline) > 0)
+    {
+        u.pump();
+        if (u.enter(1, remaining_ms(deadline)) < 0)
+            break;
+        u.reap();
+    }
+
+    // Own deadline: a flush that used up GATEWAY_IO_FLUSH_MS must not leave the cancellations unreaped
+    u.cancel_all();
+    deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(GATEWAY_IO_CANCEL_MS);
+    while (u.in_flight > 0 && remaining_ms(deadline) > 0)
+    {
+        if (u.enter(1, std::min(remaining_ms(deadline), 100)) < 0)
+            break;
+        u.reap();
+
+        // A request submitted together with the cancel may have started after it ran
+        if (u.in_flight > 0 && !u.cancel_pending)
+            u.cancel_all();
+    }
+
+    for (const Uring::Segment &seg : u.rx)
+    {
+        const uint8_t *data = u.rx_memory + static_cast<size_t>(seg.bid) * GATEWAY_IO_RX_BUFFER_SIZE;
+        this->preloaded.insert(this->preloaded.end(), data + seg.offset, data + seg.length);
+    }
+
+    if (u.in_flight > 0)
+        std::cout << "io_uring: " << u.in_flight << " requests still pending on socket " << this->fd << " at close, ring kept until they complete" << std::endl;
+
+    Uring::park(std::move(this->uring));
+}
+
+bool GatewayIo::uring_active(void) const
+{
+    return this->uring != nullptr;
+}
+
+#else // !GATEWAY_IO_URING
+
+struct GatewayIo::Uring
+{
+    bool tx_busy = false;
+};
+
+bool GatewayIo::use_uring(void)
+{
+    return false;
+}
+
+bool GatewayIo::wait(int)
+{
+    return false;
+}
+
+void GatewayIo::submit(void)
+{
+}
+
+void GatewayIo::close_uring(void)
+{
+}
+
+bool GatewayIo::uring_active(void) const
+{
+    return false;
+}
+
+#endif // GATEWAY_IO_URING
+
+GatewayIo::GatewayIo() = default;
+
+GatewayIo::~GatewayIo()
+{
+    this->close_uring();
+}
+
+void GatewayIo::attach(int socket_fd)
+{
+    this->close_uring();
+    this->fd = socket_fd;
+    this->recv_timeout_set = false;
+    this->corked = false;
+    this->direct = false;
+    this->preloaded.clear();
+}
+
+void GatewayIo::detach(void)
+{
+    this->close_uring();
+    this->fd = -1;
+}
+
+void GatewayIo::preload(const uint8_t *data, size_t length)
+{
+    this->preloaded.insert(this->preloaded.end(), data, data + length);
+}
+
+// SO_RCVTIMEO is kept in step either way, so a session that falls back to recv times out the same
+int GatewayIo::set_recv_timeout(uint32_t time_in_sec)
+{
+    if (this->recv_timeout_set && this->recv_timeout_sec == time_in_sec)
+        return 0;
+
+    timeval timeout;
+    timeout.tv_sec = time_in_sec;
+    timeout.tv_usec = 0;
+
+    if (setsockopt(this->fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) < 0)
+        return -1;
+
+    this->recv_timeout_sec = time_in_sec;
+    this->recv_timeout_set = true;
+    return 0;
+}
+
+ssize_t GatewayIo::recv(uint8_t *buf, size_t length)
+{
+    if (!this->preloaded.empty())
+    {
+        size_t n = std::min(length, this->preloaded.size());
+        memcpy(buf, this->preloaded.data(), n);
+        this->preloaded.erase(this->preloaded.begin(), this->preloaded.begin() + n);
+        return static_cast<ssize_t>(n);
+    }
+
+#ifdef GATEWAY_IO_URING
+    if (this->use_uring())
+    {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(this->recv_timeout_sec);
+
+        while (this->uring)
+        {
+            Uring &u = *this->uring;
+            u.reap();
+
+            if (!u.rx.empty())
+                return static_cast<ssize_t>(u.take(buf, length));
+            if (u.rx_eof)
+                return 0;
+            if (u.rx_error || u.tx_error)
+            {
+                errno = u.rx_error ? u.rx_error : u.tx_error;
+                return -1;
+            }
+
+            int timeout_ms = this->recv_timeout_sec ? remaining_ms(deadline) : -1;
+            if (timeout_ms == 0)
+            {
+                errno = EAGAIN;
+                return -1;
+            }
+
+            if (!this->wait(timeout_ms))
+                return this->recv(buf, length); // fell back, read ahead bytes come first
+        }
+    }
+#endif
+
+    return ::recv(this->fd, buf, length, 0);
+}
+
+ssize_t GatewayIo::send(const uint8_t *buf, size_t length)
+{
+#ifdef GATEWAY_IO_URING
+    if (this->use_uring())
+    {
+        Uring &u = *this->uring;
+        if (u.tx_error)
+        {
+            errno = u.tx_error;
+            return -1;
+        }
+
+        u.tx_queued.insert(u.tx_queued.end(), buf, buf + length);
+        if (!this->corked)
+            this->submit();
+        return static_cast<ssize_t>(length);
+    }
+#endif
+
+    return ::send(this->fd, buf, length, 0);
+}
+
+void GatewayIo::uncork(void)
+{
+    this->corked = false;
+    if (this->uring)
+        this->submit();
+}
+
+int GatewayIo::poll(pollfd *fds, nfds_t nfds, int timeout_ms)
+{
+    if (!this->preloaded.empty())
+    {
+        int ready = ::poll(fds, nfds, 0);
+        for (nfds_t i = 0; i < nfds; i++)
+        {
+            if (fds[i].fd == this->fd && fds[i].fd >= 0)
+            {
+                ready += fds[i].revents ? 0 : 1;
+                fds[i].revents |= POLLIN;
+            }
+        }
+        return std::max(ready, 1);
+    }
+
+#ifdef GATEWAY_IO_URING
+    if (this->use_uring())
+    {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(std::max(timeout_ms, 0));
+        bool waited = false;
+
+        while (this->uring)
+        {
+            Uring &u = *this->uring;
+            u.reap();
+
+            int ready = 0;
+            for (nfds_t i = 0; i < nfds; i++)
+            {
+                fds[i].revents = 0;
+                if (fds[i].fd < 0)
+                    continue;
+
+                if (fds[i].fd == this->fd)
+                {
+                    if (!u.rx.empty() || u.rx_eof || u.rx_error || u.tx_error)
+                        fds[i].revents = POLLIN;
+                }
+                else
+                {
+                    // Level-triggered like poll: a watch that fired is confirmed until the fd is drained
+                    Uring::Watch &w = u.watch(fds[i].fd);
+                    if (w.fired)
+                    {
+                        pollfd check{fds[i].fd, fds[i].events, 0};
+                        if (::poll(&check, 1, 0) > 0)
+                            fds[i].revents = check.revents;
+                        else
+                            w.fired = false;
+                    }
+                }
+
+                if (fds[i].revents)
+                    ready++;
+            }
+
+            if (ready > 0)
+                return ready;
+            if (waited && timeout_ms >= 0 && remaining_ms(deadline) == 0)
+                return 0;
+
+            waited = true;
+            if (!this->wait(timeout_ms < 0 ? -1 : remaining_ms(deadline)))
+                return this->poll(fds, nfds, timeout_ms < 0 ? -1 : remaining_ms(deadline));
+        }
+    }
+#endif
+
+    return ::poll(fds, nfds, timeout_ms);
+}
@@ -0,0 +1,285 @@
+#include "../inc/hot_restart.h"
+#include "../inc/utility.h"
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+
+HotRestart &HotRestart::instance()
+{
+    static HotRestart hot_restart;
+    return hot_restart;
+}
+
+HotRestart::HotRestart()
+{
+    this->path = HOT_RESTART_DEFAULT_PATH;
+
+    try
+    {
+        this->path = Utility::readConfig<std::string>("HES.hot_restart_socket");
+        this->drain_sec = Utility::readConfig<int>("HES.hot_restart_drain_sec");
+    }
+    catch (const std::exception &e)
+    {
+        std::cout << "Hot restart config incomplete, using " << this->path << " and " << this->drain_sec << " s drain" << std::endl;
+    }
+}
+
+// One SOCK_SEQPACKET message: the JSON text, with fd attached when it is not -1
+static bool send_message(int conn, const nlohmann::json &message, int fd)
+{
+    std::string text = message.dump();
+    if (text.size() > HOT_RESTART_MAX_MESSAGE)
+        return false;
+
+    iovec iov{const_cast<char *>(text.data()), text.size()};
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {0};
+    if (fd >= 0)
+    {
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+        memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+    }
+
+    return sendmsg(conn, &msg, MSG_NOSIGNAL) == static_cast<ssize_t>(text.size());
+}
+
+// Returns false on EOF, error or a message that is not JSON; fd is -1 when none came with it
+static bool receive_message(int conn, nlohmann::json &message, int &fd)
+{
+    char text[HOT_RESTART_MAX_MESSAGE + 1];
+    iovec iov{text, HOT_RESTART_MAX_MESSAGE};
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {0};
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    fd = -1;
+    ssize_t n = recvmsg(conn, &msg, MSG_CMSG_CLOEXEC);
+    if (n <= 0)
+        return false;
+
+    for (cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg))
+    {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS)
+            memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+    }
+
+    message = nlohmann::json::parse(text, text + n, nullptr, false);
+    return !message.is_discarded();
+}
+
+static bool unix_address(const std::string &path, sockaddr_un &addr)
+{
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(addr.sun_path))
+        return false;
+
+    memcpy(addr.sun_path, path.c_str(), path.size());
+    return true;
+}
+
+void HotRestart::start_listener(int server_fd, int metrics_fd, std::function<size_t(void)> live_sessions, std::function<void(void)> wake_sessions)
+{
+    sockaddr_un addr;
+    if (!unix_address(this->path, addr))
+    {
+        std::cout << "Hot restart disabled, no usable socket path" << std::endl;
+        return;
+    }
+
+    int listen_fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (listen_fd < 0)
+    {
+        std::cout << "Hot restart socket creation error" << std::endl;
+        return;
+    }
+
+    unlink(this->path.c_str()); // left behind by the process this one took over from, or by a crash
+    if (bind(listen_fd, (sockaddr *)&addr, sizeof(addr)) < 0 || listen(listen_fd, 1) < 0)
+    {
+        std::cout << "Hot restart failed to bind " << this->path << ": " << strerror(errno) << std::endl;
+        close(listen_fd);
+        return;
+    }
+    chmod(this->path.c_str(), S_IRUSR | S_IWUSR);
+
+    this->live_sessions = std::move(live_sessions);
+    this->wake_sessions = std::move(wake_sessions);
+
+    std::cout << "Hot restart listening on " << this->path << std::endl;
+    std::thread(&HotRestart::serve, this, listen_fd, server_fd, metrics_fd).detach();
+}
+
+void HotRestart::serve(int listen_fd, int server_fd, int metrics_fd)
+{
+    while (true)
+    {
+        int conn = accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (conn < 0)
+        {
+            if (errno != EINTR && errno != ECONNABORTED)
+            {
+                std::cout << "Hot restart accept failed: " << strerror(errno) << std::endl;
+                std::this_thread::sleep_for(std::chrono::seconds(1)); // e.g. EMFILE, retrying at once would spin
+            }
+            continue;
+        }
+
+        // Only a process of the same user may take the sockets over
+        ucred peer{};
+        socklen_t len = sizeof(peer);
+        if (getsockopt(conn, SOL_SOCKET, SO_PEERCRED, &peer, &len) < 0 || peer.uid != getuid())
+        {
+            std::cout << "Hot restart: rejected takeover from uid " << peer.uid << std::endl;
+            close(conn);
+            continue;
+        }
+
+        this->hand_off(conn, server_fd, metrics_fd);
+    }
+}
+
+void HotRestart::hand_off(int conn, int server_fd, int metrics_fd)
+{
+    std::cout << "Hot restart: successor connected, draining gateway sessions" << std::endl;
+    this->pending.store(true, std::memory_order_release);
+
+    // Registered gateways park at their next idle point, poke them so none waits for its poll timeout
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(this->drain_sec);
+    auto next_wake = std::chrono::steady_clock::now();
+    {
+        std::unique_lock<std::mutex> lock(this->park_mutex);
+        while (this->live_sessions() > 0 && std::chrono::steady_clock::now() < deadline)
+        {
+            if (std::chrono::steady_clock::now() >= next_wake)
+            {
+                lock.unlock();
+                this->wake_sessions();
+                lock.lock();
+                next_wake = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+            }
+            this->parked_cv.wait_for(lock, std::chrono::milliseconds(200));
+        }
+    }
+
+    std::unique_lock<std::mutex> lock(this->park_mutex);
+    this->abandon.store(true, std::memory_order_release); // no more parking, park() answers false from here on
+    size_t left_behind = this->live_sessions();
+
+    bool sent = send_message(conn, {{"type", "listener"}}, server_fd);
+    if (sent && metrics_fd >= 0)
+        sent = send_message(conn, {{"type", "metrics"}}, metrics_fd);
+
+    size_t handed = 0;
+    for (const HandedSession &session : this->parked)
+    {
+        if (!sent || !send_message(conn, {{"type", "session"}, {"session", session.snapshot}}, session.fd))
+        {
+            sent = false;
+            break;
+        }
+        handed++;
+    }
+
+    if (sent)
+        sent = send_message(conn, {{"type", "end"}, {"sessions", handed}}, -1);
+
+    std::cout << "Hot restart: handed over " << handed << " of " << this->parked.size() << " parked sessions, " << left_behind << " busy gateways will reconnect" << std::endl;
+
+    if (!sent)
+        std::cout << "Hot restart: handoff incomplete, the successor starts cold for what was not sent" << std::endl;
+    lock.unlock();
+
+    // Busy gateways see abandoning() and end their session as on a disconnect, so their requests get GW_DISCONNECTED
+    deadline = std::chrono::steady_clock::now() + std::chrono::seconds(HOT_RESTART_ABANDON_SEC);
+    while (this->live_sessions() > 0 && std::chrono::steady_clock::now() < deadline)
+    {
+        this->wake_sessions();
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    }
+    std::cout << "Hot restart: " << this->live_sessions() << " gateways still busy, exiting" << std::endl;
+
+    // No atexit handlers: they would shut down sockets the successor now shares
+    _exit(EXIT_SUCCESS);
+}
+
+bool HotRestart::park(int fd, nlohmann::json snapshot)
+{
+    std::lock_guard<std::mutex> lock(this->park_mutex);
+    if (this->abandoning())
+        return false; // Parked sessions are already sent
+
+    this->parked.push_back({fd, std::move(snapshot)});
+    this->parked_cv.notify_all();
+    return true;
+}
+
+bool HotRestart::take_over(int &server_fd, int &metrics_fd, std::vector<HandedSession> &sessions)
+{
+    server_fd = -1;
+    metrics_fd = -1;
+
+    sockaddr_un addr;
+    if (!unix_address(this->path, addr))
+        return false;
+
+    int conn = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (conn < 0)
+        return false;
+
+    if (connect(conn, (sockaddr *)&addr, sizeof(addr)) < 0)
+    {
+        std::cout << "Hot restart: no running process on " << this->path << ", starting cold" << std::endl;
+        close(conn);
+        return false;
+    }
+
+    std::cout << "Hot restart: taking over from the running process" << std::endl;
+
+    nlohmann::json message;
+    int fd = -1;
+    bool complete = false;
+    while (receive_message(conn, message, fd))
+    {
+        std::string type = message.value("type", "");
+
+        if (type == "listener")
+            server_fd = fd;
+        else if (type == "metrics")
+            metrics_fd = fd;
+        else if (type == "session" && fd >= 0)
+            sessions.push_back({fd, message.value("session", nlohmann::json::object())});
+        else if (fd >= 0)
+            close(fd);
+
+        if (type == "end")
+        {
+            complete = true;
+            break;
+        }
+    }
+    close(conn);
+
+    std::cout << "Hot restart: received " << sessions.size() << " sessions" << (complete ? "" : " (handoff cut short)") << std::endl;
+    return server_fd >= 0;
+}
@@ -0,0 +1,136 @@
+#include "../inc/init_admission.h"
+#include "../inc/utility.h"
+
+#include <algorithm>
+#include <iostream>
+
+InitAdmission &InitAdmission::instance()
+{
+    static InitAdmission admission;
+    return admission;
+}
+
+InitAdmission::InitAdmission()
+{
+    try
+    {
+        this->max_concurrent = std::max(1, Utility::readConfig<int>("HES.init_max_concurrent"));
+        this->rate = std::max(0.1, Utility::readConfig<double>("HES.init_rate_per_sec"));
+        this->burst = std::max(1, Utility::readConfig<int>("HES.init_burst"));
+        this->valid_for = std::chrono::seconds(std::max(0, Utility::readConfig<int>("HES.init_valid_sec")));
+    }
+    catch (const std::exception &e)
+    {
+        std::cout << "Init admission config incomplete, using " << this->max_concurrent << " concurrent, " << this->rate << "/s, burst " << this->burst << std::endl;
+    }
+
+    this->tokens = this->burst;
+}
+
+void InitAdmission::refill(std::chrono::steady_clock::time_point now)
+{
+    double elapsed = std::chrono::duration<double>(now - this->refilled_at).count();
+    this->tokens = std::min(this->burst, this->tokens + elapsed * this->rate);
+    this->refilled_at = now;
+}
+
+bool InitAdmission::init_still_valid(const char *gateway_id)
+{
+    std::lock_guard<std::mutex> lock(this->admission_mutex);
+
+    auto it = this->history.find(gateway_id);
+    if (it == this->history.end() || !it->second.init_done || !it->second.reusable)
+        return false;
+
+    return std::chrono::steady_clock::now() - it->second.init_done_at < this->valid_for;
+}
+
+bool InitAdmission::acquire(const char *gateway_id, const std::function<bool(void)> &give_up)
+{
+    std::unique_lock<std::mutex> lock(this->admission_mutex);
+
+    auto now = std::chrono::steady_clock::now();
+    auto it = this->history.find(gateway_id);
+    bool never_seen = (it == this->history.end());
+    int64_t last_seen_ms = never_seen ? 0 : std::chrono::duration_cast<std::chrono::milliseconds>(it->second.last_seen.time_since_epoch()).count();
+
+    Key key{never_seen, -last_seen_ms, this->sequence++};
+    this->queue.insert(key);
+
+    while (true)
+    {
+        now = std::chrono::steady_clock::now();
+        this->refill(now);
+
+        if (*this->queue.begin() == key && this->in_init < this->max_concurrent && this->tokens >= 1.0)
+            break;
+
+        // Next token due, or woken earlier by a release or wake_waiters()
+        auto wait = std::chrono::duration<double>((1.0 - std::min(this->tokens, 1.0)) / this->rate);
+        auto recheck = std::chrono::duration<double>(INIT_ADMISSION_RECHECK_MS / 1000.0);
+        this->admission_cv.wait_for(lock, std::max(std::chrono::duration<double>(0.01), std::min(wait, recheck)));
+
+        lock.unlock();
+        bool leaving = give_up();
+        lock.lock();
+
+        if (leaving)
+        {
+            this->queue.erase(key);
+            this->admission_cv.notify_all(); // The next one may be the head now
+            return false;
+        }
+    }
+
+    this->queue.erase(key);
+    this->tokens -= 1.0;
+    this->in_init++;
+    this->history[gateway_id].last_seen = now;
+
+    // The new head may be admissible right away
+    this->admission_cv.notify_all();
+    return true;
+}
+
+void InitAdmission::wake_waiters(void)
+{
+    std::lock_guard<std::mutex> lock(this->admission_mutex);
+    this->admission_cv.notify_all();
+}
+
+void InitAdmission::release(const char *gateway_id, bool completed)
+{
+    std::lock_guard<std::mutex> lock(this->admission_mutex);
+
+    if (this->in_init > 0)
+        this->in_init--;
+
+    History &entry = this->history[gateway_id];
+    entry.init_done = completed;
+    entry.reusable = completed;
+    if (completed)
+        entry.init_done_at = std::chrono::steady_clock::now();
+
+    this->admission_cv.notify_all();
+}
+
+void InitAdmission::session_ended(const char *gateway_id, bool reusable)
+{
+    std::lock_guard<std::mutex> lock(this->admission_mutex);
+
+    History &entry = this->history[gateway_id];
+    entry.last_seen = std::chrono::steady_clock::now();
+    entry.reusable = entry.init_done && reusable;
+}
+
+size_t InitAdmission::waiting(void)
+{
+    std::lock_guard<std::mutex> lock(this->admission_mutex);
+    return this->queue.size();
+}
+
+size_t InitAdmission::running(void)
+{
+    std::lock_guard<std::mutex> lock(this->admission_mutex);
+    return this->in_init;
+}
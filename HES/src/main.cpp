@@ -46,9 +46,12 @@ void CloseAllFdsAtExit() {
     [[maybe_unused]] int len = write(STDOUT_FILENO, msg, sizeof(msg) - 1);
 }
 
-int main() {
+int main(int argc, char* argv[]) {
     std::cout << "HES Service" << std::endl;
 
+    // --takeover: adopt the listening socket and gateway sessions of the running instance
+    bool takeover = (argc > 1 && strcmp(argv[1], "--takeover") == 0);
+
     struct sigaction sa{};
 
     sa.sa_handler = signalHandler;
@@ -60,7 +63,7 @@ int main() {
     sigaction(SIGSEGV, &sa, nullptr);
     sigaction(SIGABRT, &sa, nullptr);
 
-    std::unique_ptr<Server> server = std::make_unique<Server>();
+    std::unique_ptr<Server> server = std::make_unique<Server>(takeover);
 
     if (atexit(CloseAllFdsAtExit) != 0) {
         std::cout << "Failed to register atexit handler" << std::endl;
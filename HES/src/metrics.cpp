@@ -0,0 +1,385 @@
+#include "../inc/metrics.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+/* ================= LatencyHistogram ================= */
+
+int LatencyHistogram::bucket_index(uint64_t value_us)
+{
+    if (value_us < static_cast<uint64_t>(SUB_BUCKETS))
+        return static_cast<int>(value_us);
+
+    int exponent = 63 - __builtin_clzll(value_us);
+    if (exponent > MAX_EXPONENT)
+        return BUCKETS - 1;
+
+    int sub = static_cast<int>((value_us >> (exponent - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1));
+    return (exponent - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + sub;
+}
+
+uint64_t LatencyHistogram::bucket_upper_bound(int index)
+{
+    if (index < SUB_BUCKETS)
+        return static_cast<uint64_t>(index);
+
+    int exponent = index / SUB_BUCKETS - 1 + SUB_BUCKET_BITS;
+    uint64_t sub = static_cast<uint64_t>(index % SUB_BUCKETS);
+    return ((SUB_BUCKETS + sub + 1) << (exponent - SUB_BUCKET_BITS)) - 1;
+}
+
+void LatencyHistogram::observe_us(uint64_t value_us)
+{
+    this->buckets[bucket_index(value_us)].fetch_add(1, std::memory_order_relaxed);
+    this->total_count.fetch_add(1, std::memory_order_relaxed);
+    this->total_sum_us.fetch_add(value_us, std::memory_order_relaxed);
+}
+
+void LatencyHistogram::observe_since(std::chrono::steady_clock::time_point start)
+{
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    this->observe_us(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count()));
+}
+
+uint64_t LatencyHistogram::cumulative_count_le(uint64_t bound_us) const
+{
+    uint64_t total = 0;
+    for (int i = 0; i < BUCKETS && bucket_upper_bound(i) <= bound_us; i++)
+        total += this->buckets[i].load(std::memory_order_relaxed);
+    return total;
+}
+
+/* ================= Metrics registry ================= */
+
+Metrics &Metrics::instance()
+{
+    static Metrics metrics;
+    return metrics;
+}
+
+Metrics::Metrics()
+{
+    this->help = {
+        {"hes_connected_gateways", {"gauge", "Gateways currently registered in Server::g_clients"}},
+        {"hes_accepted_connections_total", {"counter", "Gateway connections accepted per listener shard"}},
+        {"hes_rf_round_trip_seconds", {"histogram", "RF command to response time per gateway"}},
+        {"hes_rf_transmits_total", {"counter", "RF frames written to the gateway"}},
+        {"hes_rf_retries_total", {"counter", "RF retransmissions after timeout or failed response"}},
+        {"hes_rf_timeouts_total", {"counter", "RF receive or mesh timeouts"}},
+        {"hes_db_query_seconds", {"histogram", "MySQL query latency per statement"}},
+        {"hes_db_query_errors_total", {"counter", "MySQL queries that failed after reconnect"}},
+        {"hes_push_frames_total", {"counter", "Push frames received per profile"}},
+        {"hes_odm_queue_depth", {"gauge", "On-demand requests waiting per gateway"}},
+        {"hes_odm_wait_seconds", {"histogram", "Time an on-demand request waited before processing"}},
+        {"hes_odm_coalesced_total", {"counter", "On-demand reads answered from another request's RF exchange"}},
+        {"hes_fuota_subpages_total", {"counter", "FUOTA sub-pages acknowledged by the node"}},
+        {"hes_fuota_bytes_total", {"counter", "FUOTA image bytes acknowledged by the node"}},
+    };
+}
+
+MetricCounter &Metrics::counter(const std::string &name, const std::string &labels)
+{
+    SeriesKey key(name, labels);
+    {
+        std::shared_lock<std::shared_timed_mutex> lock(this->registry_mutex);
+        auto it = this->counters.find(key);
+        if (it != this->counters.end())
+            return *it->second;
+    }
+
+    std::unique_lock<std::shared_timed_mutex> lock(this->registry_mutex);
+    std::unique_ptr<MetricCounter> &series = this->counters[key];
+    if (!series)
+        series.reset(new MetricCounter(0));
+    return *series;
+}
+
+MetricGauge &Metrics::gauge(const std::string &name, const std::string &labels)
+{
+    SeriesKey key(name, labels);
+    {
+        std::shared_lock<std::shared_timed_mutex> lock(this->registry_mutex);
+        auto it = this->gauges.find(key);
+        if (it != this->gauges.end())
+            return *it->second;
+    }
+
+    std::unique_lock<std::shared_timed_mutex> lock(this->registry_mutex);
+    std::unique_ptr<MetricGauge> &series = this->gauges[key];
+    if (!series)
+        series.reset(new MetricGauge(0));
+    return *series;
+}
+
+LatencyHistogram &Metrics::histogram(const std::string &name, const std::string &labels)
+{
+    SeriesKey key(name, labels);
+    {
+        std::shared_lock<std::shared_timed_mutex> lock(this->registry_mutex);
+        auto it = this->histograms.find(key);
+        if (it != this->histograms.end())
+            return *it->second;
+    }
+
+    std::unique_lock<std::shared_timed_mutex> lock(this->registry_mutex);
+    std::unique_ptr<LatencyHistogram> &series = this->histograms[key];
+    if (!series)
+        series.reset(new LatencyHistogram());
+    return *series;
+}
+
+void Metrics::gauge_callback(const std::string &name, std::function<int64_t(void)> read)
+{
+    std::unique_lock<std::shared_timed_mutex> lock(this->registry_mutex);
+    this->callbacks[name] = std::move(read);
+}
+
+std::string Metrics::label(const char *key, const std::string &value)
+{
+    std::string out = std::string(key) + "=\"";
+    for (char c : value)
+    {
+        if (c == '\0')
+            break;
+        if (c == '"' || c == '\\')
+            out += '\\';
+        out += c;
+    }
+    return out + "\"";
+}
+
+// "INSERT name_plate_data", "SELECT source_route_network", ... bounded by the table count
+std::string Metrics::statement_label(const char *query)
+{
+    auto next_word = [](const char *&p) {
+        while (*p && (isspace(static_cast<unsigned char>(*p)) || *p == '`' || *p == '('))
+            p++;
+        std::string word;
+        while (*p && (isalnum(static_cast<unsigned char>(*p)) || *p == '_' || *p == '.'))
+            word += static_cast<char>(*p++);
+        if (*p == '`')
+            p++;
+        return word;
+    };
+    auto upper = [](std::string s) {
+        for (char &c : s)
+            c = static_cast<char>(toupper(static_cast<unsigned char>(c)));
+        return s;
+    };
+
+    const char *p = query;
+    std::string verb = upper(next_word(p));
+    const char *marker = nullptr;
+
+    if (verb == "SELECT" || verb == "DELETE")
+        marker = "FROM";
+    else if (verb == "INSERT" || verb == "REPLACE")
+        marker = "INTO";
+    else if (verb != "UPDATE")
+        return verb.empty() ? "OTHER" : verb;
+
+    if (marker)
+    {
+        std::string word;
+        while (!(word = next_word(p)).empty() || *p)
+        {
+            if (upper(word) == marker)
+                break;
+            if (word.empty())
+                p++; // punctuation such as ',' '*' '='
+        }
+    }
+
+    std::string table = next_word(p);
+    return table.empty() ? verb : verb + " " + table;
+}
+
+std::string Metrics::render(void)
+{
+    static const uint64_t bounds_us[] = {1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 500000,
+                                         1000000, 2500000, 5000000, 10000000, 30000000, 60000000};
+
+    std::ostringstream out;
+    std::string last_name;
+
+    auto header = [&](const std::string &name, const char *type) {
+        if (name == last_name)
+            return;
+        last_name = name;
+        auto it = this->help.find(name);
+        if (it != this->help.end())
+            out << "# HELP " << name << " " << it->second.second << "\n";
+        out << "# TYPE " << name << " " << type << "\n";
+    };
+    auto series = [](const std::string &name, const std::string &labels, const std::string &extra = "") {
+        std::string joined = labels;
+        if (!extra.empty())
+            joined = joined.empty() ? extra : joined + "," + extra;
+        return joined.empty() ? name : name + "{" + joined + "}";
+    };
+
+    std::map<std::string, std::function<int64_t(void)>> callbacks_copy;
+    {
+        std::shared_lock<std::shared_timed_mutex> lock(this->registry_mutex);
+
+        for (const auto &kv : this->counters)
+        {
+            header(kv.first.first, "counter");
+            out << series(kv.first.first, kv.first.second) << " " << kv.second->load(std::memory_order_relaxed) << "\n";
+        }
+
+        for (const auto &kv : this->gauges)
+        {
+            header(kv.first.first, "gauge");
+            out << series(kv.first.first, kv.first.second) << " " << kv.second->load(std::memory_order_relaxed) << "\n";
+        }
+
+        for (const auto &kv : this->histograms)
+        {
+            const std::string &name = kv.first.first;
+            const std::string &labels = kv.first.second;
+            const LatencyHistogram &h = *kv.second;
+
+            header(name, "histogram");
+            for (uint64_t bound : bounds_us)
+            {
+                char le[32];
+                snprintf(le, sizeof(le), "le=\"%g\"", static_cast<double>(bound) / 1e6);
+                out << series(name + "_bucket", labels, le) << " " << h.cumulative_count_le(bound) << "\n";
+            }
+            out << series(name + "_bucket", labels, "le=\"+Inf\"") << " " << h.count() << "\n";
+            out << series(name + "_sum", labels) << " " << static_cast<double>(h.sum_us()) / 1e6 << "\n";
+            out << series(name + "_count", labels) << " " << h.count() << "\n";
+        }
+
+        callbacks_copy = this->callbacks;
+    }
+
+    // Callbacks may take other locks (Server::clients_mutex), run them outside the registry lock
+    for (const auto &kv : callbacks_copy)
+    {
+        header(kv.first, "gauge");
+        out << kv.first << " " << kv.second() << "\n";
+    }
+
+    return out.str();
+}
+
+/* ================= HTTP endpoint ================= */
+
+void Metrics::start_http_server(int port)
+{
+    if (port <= 0 || this->http_started.exchange(true))
+        return;
+
+    int listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_fd < 0)
+    {
+        std::cout << "Metrics socket creation error" << std::endl;
+        return;
+    }
+
+    int yes = 1;
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+
+    if (bind(listen_fd, (sockaddr *)&addr, sizeof(addr)) < 0 || listen(listen_fd, 8) < 0)
+    {
+        std::cout << "Metrics endpoint failed to bind 127.0.0.1:" << port << std::endl;
+        close(listen_fd);
+        return;
+    }
+
+    std::cout << "Metrics endpoint listening on 127.0.0.1:" << port << "/metrics" << std::endl;
+    this->http_fd = listen_fd;
+    std::thread(&Metrics::serve_http, this, listen_fd).detach();
+}
+
+void Metrics::adopt_http_server(int listen_fd)
+{
+    if (listen_fd < 0 || this->http_started.exchange(true))
+        return;
+
+    std::cout << "Metrics endpoint taken over, fd " << listen_fd << std::endl;
+    this->http_fd = listen_fd;
+    std::thread(&Metrics::serve_http, this, listen_fd).detach();
+}
+
+void Metrics::serve_http(int listen_fd)
+{
+    while (true)
+    {
+        int fd = accept(listen_fd, nullptr, nullptr);
+        if (fd < 0)
+        {
+            if (errno != EINTR && errno != ECONNABORTED)
+            {
+                std::cout << "Metrics accept failed: " << strerror(errno) << std::endl;
+                std::this_thread::sleep_for(std::chrono::seconds(1)); // e.g. EMFILE, retrying at once would spin
+            }
+            continue;
+        }
+
+        timeval tv{2, 0};
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+        char request[1024] = {0};
+        ssize_t n = recv(fd, request, sizeof(request) - 1, 0);
+
+        std::string body;
+        const char *status = "200 OK";
+        if (n > 0 && (strncmp(request, "GET /metrics", 12) == 0 || strncmp(request, "GET / ", 6) == 0))
+        {
+            body = this->render();
+        }
+        else
+        {
+            status = "404 Not Found";
+            body = "not found\n";
+        }
+
+        std::string response = std::string("HTTP/1.1 ") + status +
+                               "\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: " + std::to_string(body.size()) +
+                               "\r\nConnection: close\r\n\r\n" + body;
+
+        size_t sent = 0;
+        while (sent < response.size())
+        {
+            ssize_t w = send(fd, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+            if (w <= 0)
+                break;
+            sent += static_cast<size_t>(w);
+        }
+        close(fd);
+    }
+}
+
+/* ================= GatewayMetrics ================= */
+
+void GatewayMetrics::bind(const char *gateway_id)
+{
+    Metrics &metrics = Metrics::instance();
+    std::string labels = Metrics::label("gateway", gateway_id);
+
+    this->rf_rtt = &metrics.histogram("hes_rf_round_trip_seconds", labels);
+    this->rf_transmits = &metrics.counter("hes_rf_transmits_total", labels);
+    this->rf_retries = &metrics.counter("hes_rf_retries_total", labels);
+    this->rf_timeouts = &metrics.counter("hes_rf_timeouts_total", labels);
+    this->odm_queue_depth = &metrics.gauge("hes_odm_queue_depth", labels);
+    this->odm_wait = &metrics.histogram("hes_odm_wait_seconds", labels);
+    this->odm_coalesced = &metrics.counter("hes_odm_coalesced_total", labels);
+}
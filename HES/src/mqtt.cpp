@@ -2,11 +2,8 @@
 #include "../inc/String_functions.h"
 #include "../inc/client.h"
 
-// Helper for deque lookup (O(n) but n<=2 → fast)
-bool MQTTClient::contains(const std::deque<std::string> &dq, const std::string &id)
-{
-    return std::find(dq.begin(), dq.end(), id) != dq.end();
-}
+#include <charconv>
+#include <string_view>
 
 MQTTClient::MQTTClient()
 {
@@ -39,8 +36,10 @@ void MQTTClient::set_mqtt_topic_and_client_id(const char *gateway_id)
 {
     snprintf(this->MqttTopic, sizeof(this->MqttTopic), "%.*s/ONDEMAND_REQUEST", 16, gateway_id);
     snprintf(this->ClientID, sizeof(this->ClientID), "%.*s/CLIENT_ID", 16, gateway_id);
+    snprintf(this->ResponseTopic, sizeof(this->ResponseTopic), "%.*s/ONDEMAND_RESPONSE", 16, gateway_id);
 
     this->print_and_log("Mqtt topic: %s\n", this->MqttTopic);
+    this->print_and_log("Mqtt response topic: %s\n", this->ResponseTopic);
     this->print_and_log("Mqtt client ID: %s\n", this->ClientID);
 }
 
@@ -50,6 +49,8 @@ void MQTTClient::load_mqtt_config_from_file(void)
     {
         this->mqtt_host = Utility::readConfig<std::string>("MQTT.host");
         this->mqtt_port = Utility::readConfig<int>("MQTT.port");
+        this->request_index.set_seen_ttl(Utility::readConfig<int>("MQTT.request_id_ttl_sec"));
+        this->results_enabled = Utility::readConfig<bool>("MQTT.publish_results");
     }
 
     catch (const std::exception &e)
@@ -147,20 +148,12 @@ void MQTTClient::on_message(mosquitto *mosq, void *obj, const mosquitto_message
     /* =======================
        Timestamp generation
        ======================= */
-    auto now = std::chrono::system_clock::now();
-    auto time_t = std::chrono::system_clock::to_time_t(now);
-    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()).count() % 1000;
-    std::tm tm{};
-    localtime_r(&time_t, &tm); // localtime_s(&time_t, &tm) on Windows
-    std::ostringstream oss;
-    oss << std::put_time(&tm, "%Y-%m-%d %H:%M:%S") << "."
-        << std::setfill('0') << std::setw(3) << ms;
-    std::string time_str = oss.str();
+    const char *time_str = WallClock::now_ms();
 
     /* =======================
    Debug log
    ======================= */
-    client->print_and_log("[%s] Received message on topic : %s : %s\n", time_str.c_str(), msg->topic, client->ondemand_data.data());
+    client->print_and_log("[%s] Received message on topic : %s : %s\n", time_str, msg->topic, client->ondemand_data.data());
 
     /* =======================
     Validate request IDs
@@ -170,257 +163,245 @@ void MQTTClient::on_message(mosquitto *mosq, void *obj, const mosquitto_message
     /* =======================
     Notify main loop
     ======================= */
-    eventfd_write(client->mqtt_socket, 1);
+    client->signal_ondemand();
 }
 
 // Enqueue successful On-Demand (ODM) command*+
-void MQTTClient::enqueue_odm(const std::string &cmd)
+void MQTTClient::enqueue_odm(const QueuedCommand &queued)
 {
-    std::vector<uint8_t> cmd_bytes(cmd.begin(), cmd.end());
-    if (ODM.size() >= MAX_QUEUE_SIZE)
-        ODM.pop(); // Drop oldest if full
-    ODM.emplace(std::move(cmd_bytes));
+    // Indexed before the push, the gateway thread may dequeue it right away
+    this->request_index.queued(queued.request_id);
+    if (!this->ODM.push(queued))
+    {
+        this->request_index.unqueued(queued.request_id);
+        this->print_and_log("❌ ODM queue full (%zu) → FAILED QUEUE | REQ_ID=%d\n", this->ODM.capacity(), queued.request_id);
+        this->enqueue_failed(queued);
+    }
 }
 
 // Enqueue failed commands
-void MQTTClient::enqueue_failed(const std::string &cmd)
+void MQTTClient::enqueue_failed(const QueuedCommand &cmd)
 {
-    std::vector<uint8_t> cmd_bytes(cmd.begin(), cmd.end());
-    if (Failed.size() >= MAX_QUEUE_SIZE)
-        Failed.pop();
-    Failed.emplace(std::move(cmd_bytes));
+    FailedCommand failed;
+    failed.request_id = cmd.request_id;
+    failed.download_data_type = cmd.download_data_type;
+
+    if (this->Failed.push(failed))
+        return;
+
+    // Ring full: keep it for the gateway thread, it still owes the request its FAILED status
+    std::lock_guard<std::mutex> lock(this->failed_overflow_mtx);
+    this->failed_overflow.push_back(failed);
+    this->print_and_log("❌ Failed queue full (%zu), REQ_ID=%d kept in overflow (%zu)\n", this->Failed.capacity(), cmd.request_id, this->failed_overflow.size());
+}
+
+// Gateway thread: moves the Failed overflow into out, false when there was none
+bool MQTTClient::take_failed_overflow(std::deque<FailedCommand> &out)
+{
+    std::lock_guard<std::mutex> lock(this->failed_overflow_mtx);
+    if (this->failed_overflow.empty())
+        return false;
+
+    out.swap(this->failed_overflow);
+    return true;
 }
 
 // Enqueue RF & Meter FUOTA commands
-void MQTTClient::enqueue_fuota(const std::string &cmd)
+void MQTTClient::enqueue_fuota(const QueuedCommand &queued)
 {
-    std::vector<uint8_t> cmd_bytes(cmd.begin(), cmd.end());
-    if (RF_Meter_FUOTA.size() >= MAX_QUEUE_SIZE)
-        RF_Meter_FUOTA.pop();
-    RF_Meter_FUOTA.emplace(std::move(cmd_bytes));
+    this->request_index.queued(queued.request_id);
+    if (!this->RF_Meter_FUOTA.push(queued))
+    {
+        this->request_index.unqueued(queued.request_id);
+        this->print_and_log("❌ FUOTA queue full (%zu) → FAILED QUEUE | REQ_ID=%d\n", this->RF_Meter_FUOTA.capacity(), queued.request_id);
+        this->enqueue_failed(queued);
+    }
 }
 
-void MQTTClient::remove_commands_by_req_id(std::queue<std::vector<uint8_t>> &queue,
-                                           const std::unordered_set<std::string> &cancel_req_ids)
+// Wake the gateway thread, at most one eventfd write until it reads the eventfd again
+void MQTTClient::signal_ondemand(void)
 {
-    // Temporary queue to hold commands that are not cancelled
-    std::queue<std::vector<uint8_t>> temp_queue;
+    if (!this->ondemand_wakeup_pending.exchange(true, std::memory_order_acq_rel))
+        eventfd_write(this->mqtt_socket, 1);
+}
 
-    // Process each command in the original queue
-    while (!queue.empty())
-    {
-        // Reference to the front command bytes in the queue
-        const std::vector<uint8_t> &cmd_bytes = queue.front();
+// Gateway thread: consume the wake-up before draining the queues, later enqueues signal again
+void MQTTClient::ack_ondemand_signal(void)
+{
+    eventfd_t value;
+    eventfd_read(this->mqtt_socket, &value);
+    this->ondemand_wakeup_pending.exchange(false, std::memory_order_acq_rel);
+}
+
+// Gateway thread: true (and forgotten) when a queued request was cancelled before it was processed
+bool MQTTClient::take_cancelled(int request_id)
+{
+    if (!this->request_index.take(request_id))
+        return false;
 
-        // Convert command bytes to a string for parsing
-        std::string cmd_str(cmd_bytes.begin(), cmd_bytes.end());
+    this->print_and_log("Cancelling queued command with Request ID: %d\n", request_id);
+    return true;
+}
 
-        // Split the command string by ':' delimiter to extract parts
-        std::vector<std::string> cmd_parts = explode(cmd_str, ':');
+// Download types accepted in parts[4], bit N set = "NN" allowed (00..31)
+static constexpr uint32_t ALLOWED_DOWNLOAD_TYPES = 0xFFFFFFFFu;
 
-        // If command is empty or request ID is not in cancel list, keep the command
-        if (cmd_parts.empty() || cancel_req_ids.find(cmd_parts[0]) == cancel_req_ids.end())
-        {
-            temp_queue.emplace(cmd_bytes);
-        }
-        else
-        {
-            // Log the cancellation for traceability with the request ID
-            this->print_and_log("Cancelling queued command with Request ID: %s\n", cmd_parts[0].c_str());
-        }
+static bool is_allowed_download_type(std::string_view type)
+{
+    if (type.size() != 2 || !isdigit(static_cast<unsigned char>(type[0])) || !isdigit(static_cast<unsigned char>(type[1])))
+        return false;
 
-        // Remove the processed command from the original queue
-        queue.pop();
-    }
+    int value = (type[0] - '0') * 10 + (type[1] - '0');
+    return (value < 32) && (ALLOWED_DOWNLOAD_TYPES & (1u << value));
+}
 
-    // Replace the original queue with the filtered queue containing only non-cancelled commands
-    queue = std::move(temp_queue);
+static bool is_all_digits(std::string_view text)
+{
+    return !text.empty() && std::all_of(text.begin(), text.end(), [](char c)
+                                         { return isdigit(static_cast<unsigned char>(c)) != 0; });
 }
 
 // Validate request IDs from a message payload.
 // IDs are hyphen-separated and that each ID should be 16 characters.
-// Returns true if all IDs are valid, false otherwise.
+// The payload is tokenized in place, each command is parsed once into the
+// QueuedCommand that is queued and later framed without parsing it again.
 void MQTTClient::validate_request_ids(const char *message, const char *gateway_id, MQTTClient *client)
 {
-    // Convert input message into std::string for easy manipulation.
-    std::string msg_str(message);
+    std::string_view msg(message);
 
-    if (msg_str.find('-') != std::string::npos)
-    {
-        msg_str = msg_str.substr(msg_str.find(':') + 1); // remove group ID
-        this->print_and_log("[WITHOUT GROUP ID] = %s\n", msg_str.c_str());
-    }
-    // Split multiple commands separated by hyphen '-'.
-    std::vector<std::string> commands = explode(msg_str, '-');
-    if (commands.empty())
+    if (msg.find('-') != std::string_view::npos)
     {
-        client->print_and_log("❌ NO COMMANDS - EXIT\n");
-        return;
+        msg = msg.substr(msg.find(':') + 1); // remove group ID
+        this->print_and_log("[WITHOUT GROUP ID] = %.*s\n", static_cast<int>(msg.size()), msg.data());
     }
 
-    // Allowed command codes, used to validate commands' type in parts[4].
-    static const std::set<std::string> allowed_cmds{
-        "00", "01", "02", "03", "04", "05", "06", "07", "08", "09",
-        "10", "11", "12", "13", "14", "15", "16", "17", "18", "19",
-        "20", "21", "22", "23", "24", "25", "26", "27", "28", "29", "30", "31"};
+    const std::string_view gateway(gateway_id);
 
-    // Process each command one by one
-    for (const auto &cmd : commands)
+    // Process each command one by one, commands are separated by hyphen '-'
+    size_t next = 0;
+    while (next <= msg.size())
     {
-        // Divide command into parts delimited by ':'
-        std::vector<std::string> parts = explode(cmd, ':');
+        size_t end = msg.find('-', next);
+        if (end == std::string_view::npos)
+            end = msg.size();
+
+        const std::string_view cmd = msg.substr(next, end - next);
+        const int cmd_len = static_cast<int>(cmd.size());
+        next = end + 1;
 
         // Special Handling: Check if command is a CANCEL request
-        if (!parts.empty() && parts[0] == "CANCEL")
+        if (cmd.substr(0, cmd.find(':')) == "CANCEL")
         {
             client->print_and_log("✅ CANCEL CMD - SKIPPING VALIDATION\n");
-            // Collect all request IDs to be cancelled
-            std::unordered_set<std::string> cancel_req_ids(parts.begin() + 1, parts.end());
-
-            // Remove matching commands from ODM and FUOTA queues
-            remove_commands_by_req_id(client->ODM, cancel_req_ids);
-            remove_commands_by_req_id(client->RF_Meter_FUOTA, cancel_req_ids);
 
-            // Store cancelled request IDs for DB update in a thread-safe manner
+            // Store cancelled request IDs for DB update in a thread-safe manner,
+            // queued commands are tombstoned and skipped when the gateway thread dequeues them
             std::lock_guard<std::mutex> lock(client->cancelled_mutex);
-            for (const auto &id : cancel_req_ids)
+            size_t cancelled = 0;
+            size_t id_start = cmd.find(':');
+            while (id_start != std::string_view::npos)
             {
-                client->cancelled_requests.push(id);
+                size_t id_end = cmd.find(':', id_start + 1);
+                std::string_view id = cmd.substr(id_start + 1, (id_end == std::string_view::npos) ? std::string_view::npos : id_end - id_start - 1);
+                id_start = id_end;
+
+                client->cancelled_requests.emplace(id);
+
+                int request_id;
+                if (is_all_digits(id) && std::from_chars(id.data(), id.data() + id.size(), request_id).ec == std::errc() &&
+                    client->request_index.cancel(request_id))
+                    client->print_and_log("CANCEL: REQ_ID=%d still queued, tombstoned\n", request_id);
+                cancelled++;
             }
-            client->print_and_log("CANCEL: Queued %zu request IDs for DB update\n", cancel_req_ids.size());
+            client->print_and_log("CANCEL: Queued %zu request IDs for DB update\n", cancelled);
             // After cancellation, skip further validation for this command
             continue;
         }
 
-        // Reject and enqueue as failed if command parts are empty
-        if (parts.empty())
+        QueuedCommand parts;
+        if (!parts.parse(cmd))
         {
-            client->print_and_log("❌ EMPTY PARTS → FAILED QUEUE\n");
-            client->enqueue_failed(cmd);
+            client->print_and_log("❌ COMMAND LONGER THAN %d BYTES → FAILED QUEUE\n", COMMAND_TEXT_MAX - 1);
+            client->enqueue_failed(parts);
             continue;
         }
 
         // Accept only commands with 7 or 8 parts, else treat as invalid
-        if (!(parts.size() == 6 || parts.size() == 7 || parts.size() == 8))
+        if (!(parts.part_count == 6 || parts.part_count == 7 || parts.part_count == 8))
         {
-            client->print_and_log("❌ INVALID PARTS COUNT (%zu) → FAILED QUEUE\n", parts.size());
-            client->enqueue_failed(cmd);
+            client->print_and_log("❌ INVALID PARTS COUNT (%u) → FAILED QUEUE\n", parts.part_count);
+            client->enqueue_failed(parts);
             continue;
         }
-        if (parts.size() == 6)
+        if (parts.part_count == 6 && parts.view(DOWNLOAD_DATA_TYPE) == "13")
         {
-            if (parts[4] == "13")
-            {
-                if (parts.size() != 8)
-                {
-                    client->print_and_log("❌ INVALID PARTS COUNT FOR PING NODE (%zu) → FAILED QUEUE\n", parts.size());
-                    client->enqueue_failed(cmd);
-                    continue;
-                }
-            }
+            client->print_and_log("❌ INVALID PARTS COUNT FOR PING NODE (%u) → FAILED QUEUE\n", parts.part_count);
+            client->enqueue_failed(parts);
+            continue;
         }
-        client->print_and_log("[PARTS SIZE] = %d\n", parts.size() - 1);
+        client->print_and_log("[PARTS SIZE] = %d\n", parts.part_count - 1);
 
         // Assume command is valid initially
         bool command_valid = true;
 
         // Validate each part against expected rules
-        for (size_t idx = 0; idx < parts.size() && command_valid; ++idx)
+        for (int idx = 0; idx < parts.field_count && command_valid; ++idx)
         {
             switch (idx)
             {
                 case REQUEST_ID: {
-                    client->print_and_log("[idx] = %d, REQ_ID = %s\n", idx, parts[REQUEST_ID].c_str());
+                    client->print_and_log("[idx] = %d, REQ_ID = %s\n", idx, parts.field(REQUEST_ID));
 
                     // LEVEL 1: Basic numeric validation
-                    if (!std::all_of(parts[REQUEST_ID].begin(), parts[REQUEST_ID].end(), ::isdigit))
+                    if (!is_all_digits(parts.view(REQUEST_ID)))
                     {
-                        client->print_and_log("Enqueueing command to Failed queue (REQ_ID not numeric): %s\n", cmd.c_str());
+                        client->print_and_log("Enqueueing command to Failed queue (REQ_ID not numeric): %.*s\n", cmd_len, cmd.data());
                         command_valid = false;
                         break;
                     }
 
-                    // LEVEL 2: GLOBAL DUPLICATE CHECK
+                    // LEVEL 2: DUPLICATE CHECK, request IDs seen within the TTL per category
                     {
-                        std::lock_guard<std::mutex> lock(global_id_mutex);
-
-                        // 🔥 DEBUG: Print BEFORE check
-                        client->print_and_log("🔍 BEFORE CHECK - OTHER_REQ_IDS size=%zu: [", global_seen_req_ids.size());
-                        for (const auto &id : global_seen_req_ids)
-                            client->print_and_log("%s ", id.c_str());
-                        client->print_and_log("]\n");
-
-                        bool is_duplicate = false;
-                        std::deque<std::string> *target_set = nullptr;
-
-                        if (parts[DOWNLOAD_DATA_TYPE] == "13" || parts[DOWNLOAD_DATA_TYPE] == "14")
-                        {
-                            target_set = &special_req_ids;
-                            is_duplicate = contains(*target_set, parts[REQUEST_ID]);
-                        }
-                        else if (parts[DOWNLOAD_DATA_TYPE] == "27")
-                        {
-                            target_set = &FUOTA_req_ids;
-                            is_duplicate = contains(*target_set, parts[REQUEST_ID]);
-                        }
-                        else
-                        {
-                            target_set = &global_seen_req_ids;
-                            is_duplicate = contains(*target_set, parts[REQUEST_ID]);
-                        }
-                        client->print_and_log("🔍 CHECK '%s' → %s\n", parts[REQUEST_ID].c_str(),
+                        RequestCategory category = RequestCategory::ODM;
+                        if (parts.view(DOWNLOAD_DATA_TYPE) == "13" || parts.view(DOWNLOAD_DATA_TYPE) == "14")
+                            category = RequestCategory::PING;
+                        else if (parts.view(DOWNLOAD_DATA_TYPE) == "27")
+                            category = RequestCategory::FUOTA;
+
+                        bool is_duplicate = !client->request_index.remember(category, parts.view(REQUEST_ID));
+                        client->print_and_log("🔍 CHECK '%s' → %s\n", parts.field(REQUEST_ID),
                                               is_duplicate ? "DUPLICATE (REJECT)" : "OK");
 
                         if (is_duplicate)
                         {
-                            client->print_and_log("🚫 GLOBAL DUPLICATE REQ_ID '%s' - REJECTED!\n", parts[REQUEST_ID].c_str());
+                            client->print_and_log("🚫 GLOBAL DUPLICATE REQ_ID '%s' - REJECTED!\n", parts.field(REQUEST_ID));
                             command_valid = false;
                             break;
                         }
-
-                        // ✅ APPROVED - Add to END (newest)
-                        target_set->push_back(parts[REQUEST_ID]);
-                        client->print_and_log("✅ INSERTED '%s' → size=%zu\n", parts[REQUEST_ID].c_str(), target_set->size());
-
-                        // Cleanup: Keep only LAST 2 (remove oldest from front)
-                        while (target_set->size() > 2)
-                        {
-                            target_set->pop_front();
-                            client->print_and_log("🧹 Removed OLDEST → size=%zu\n", target_set->size());
-                        }
-
-                        // 🔥 DEBUG: Print AFTER cleanup
-                        client->print_and_log("🔍 DEBUG AFTER CLEANUP - OTHER_REQ_IDS: [");
-                        for (const auto &id : global_seen_req_ids)
-                            client->print_and_log("%s ", id.c_str());
-                        client->print_and_log("]\n");
+                        client->print_and_log("✅ INSERTED '%s' → seen=%zu\n", parts.field(REQUEST_ID), client->request_index.seen_count());
                     }
                     break;
                 }
 
                 case GATEWAY_ID:
-                    client->print_and_log("[idx] = %d, GATEWAY_ID = %s\n", idx, parts[GATEWAY_ID].c_str());
+                    client->print_and_log("[idx] = %d, GATEWAY_ID = %s\n", idx, parts.field(GATEWAY_ID));
                     // Payload ID must have length 16 and match GATEWAY ID
-                    if (parts[GATEWAY_ID].length() != 16 || parts[GATEWAY_ID].substr(0, 16) != gateway_id)
+                    if (parts.field_size(GATEWAY_ID) != 16 || parts.view(GATEWAY_ID) != gateway || !parts.gateway_ok)
                     {
-                        client->print_and_log("Enqueueing command to Failed queue (Wrong Gateway ID): %s\n", cmd.c_str());
+                        client->print_and_log("Enqueueing command to Failed queue (Wrong Gateway ID): %.*s\n", cmd_len, cmd.data());
                         command_valid = false;
                     }
                     break;
                 case HOP_COUNT:
-                    client->print_and_log("[idx] = %d, HOP_COUNT = %s\n", idx, parts[HOP_COUNT].c_str());
+                    client->print_and_log("[idx] = %d, HOP_COUNT = %s\n", idx, parts.field(HOP_COUNT));
                     break;
                 case DEST_ADDR: {
-                    client->print_and_log("[idx] = %d, DEST_ADDRESS = %s\n", idx, parts[DEST_ADDR].c_str());
+                    client->print_and_log("[idx] = %d, DEST_ADDRESS = %s\n", idx, parts.field(DEST_ADDR));
                     // Hop count integer check and address validation
-                    int hop_count;
-                    try
-                    {
-                        hop_count = std::stoi(parts[HOP_COUNT]);
-                    }
-                    catch (...)
+                    int hop_count = parts.number(HOP_COUNT, -1);
+                    if (hop_count < 0)
                     {
-                        client->print_and_log("🚫 HOP COUNT INVALID | CMD='%s' | HOPS:'%s' → FAILED\n", cmd.c_str(), parts[HOP_COUNT].c_str());
+                        client->print_and_log("🚫 HOP COUNT INVALID | CMD='%.*s' | HOPS:'%s' → FAILED\n", cmd_len, cmd.data(), parts.field(HOP_COUNT));
                         command_valid = false;
                         break;
                     }
@@ -428,45 +409,52 @@ void MQTTClient::validate_request_ids(const char *message, const char *gateway_i
 
                     if (hop_count == 0)
                     {
-                        if (parts[GATEWAY_ID] != parts[DEST_ADDR])
+                        if (parts.view(GATEWAY_ID) != parts.view(DEST_ADDR))
                         {
-                            client->print_and_log("🚫 DEST PATH MISMATCH | CMD='%s' | "
-                                                  "REQ:'%s' | GW:'%s' | DEST:'%s'(len=%zu) | "
+                            client->print_and_log("🚫 DEST PATH MISMATCH | CMD='%.*s' | "
+                                                  "REQ:'%s' | GW:'%s' | DEST:'%.16s'(len=%zu) | "
                                                   "HOPS:0 → FAILED QUEUE\n",
-                                                  cmd.c_str(),
-                                                  parts[0].c_str(),               // Request ID ✓
-                                                  parts[1].c_str(),               // Gateway ID ✓
-                                                  parts[3].substr(0, 16).c_str(), // Dest preview ✓
-                                                  parts[3].length());             // Dest length ✓
+                                                  cmd_len, cmd.data(),
+                                                  parts.field(REQUEST_ID),     // Request ID ✓
+                                                  parts.field(GATEWAY_ID),     // Gateway ID ✓
+                                                  parts.field(DEST_ADDR),      // Dest preview ✓
+                                                  parts.field_size(DEST_ADDR)); // Dest length ✓
                             command_valid = false;
                         }
                     }
                     else
                     {
-                        if ((parts[DEST_ADDR].length() != expected_len) || (parts[DEST_ADDR].substr(0, 16) != gateway_id))
+                        if ((parts.field_size(DEST_ADDR) != expected_len) || (parts.view(DEST_ADDR).substr(0, 16) != gateway))
                         {
-                            client->print_and_log("🚫 DEST PATH INVALID | CMD='%s' | "
-                                                  "REQ:'%s' | GW:'%s' | DEST:'%s'(len=%zu/%zu) | "
+                            client->print_and_log("🚫 DEST PATH INVALID | CMD='%.*s' | "
+                                                  "REQ:'%s' | GW:'%s' | DEST:'%.16s'(len=%zu/%zu) | "
                                                   "HOPS:%d → FAILED QUEUE\n",
-                                                  cmd.c_str(),
-                                                  parts[0].c_str(),               // Request ID ✓
-                                                  gateway_id,                     // Expected GW ✓
-                                                  parts[3].substr(0, 16).c_str(), // Got GW preview ✓
-                                                  parts[3].length(),              // Actual len ✓
-                                                  expected_len,                   // Expected len ✓
-                                                  hop_count);                     // Hops ✓
+                                                  cmd_len, cmd.data(),
+                                                  parts.field(REQUEST_ID),      // Request ID ✓
+                                                  gateway_id,                   // Expected GW ✓
+                                                  parts.field(DEST_ADDR),       // Got GW preview ✓
+                                                  parts.field_size(DEST_ADDR),  // Actual len ✓
+                                                  expected_len,                 // Expected len ✓
+                                                  hop_count);                   // Hops ✓
                             command_valid = false;
                         }
                     }
+
+                    // Decoded path must fit the PMESH frame
+                    if (command_valid && !parts.path_ok)
+                    {
+                        client->print_and_log("🚫 DEST PATH NOT HEX OR LONGER THAN %d BYTES | CMD='%.*s' → FAILED QUEUE\n", COMMAND_PATH_MAX, cmd_len, cmd.data());
+                        command_valid = false;
+                    }
                     break;
                 }
 
                 case DOWNLOAD_DATA_TYPE:
-                    client->print_and_log("[idx] = %d, DOWNLOAD_DATA_TYPE = %s\n", idx, parts[DOWNLOAD_DATA_TYPE].c_str());
+                    client->print_and_log("[idx] = %d, DOWNLOAD_DATA_TYPE = %s\n", idx, parts.field(DOWNLOAD_DATA_TYPE));
                     // Data type must be one of allowed commands
-                    if (allowed_cmds.find(parts[DOWNLOAD_DATA_TYPE]) == allowed_cmds.end())
+                    if (!is_allowed_download_type(parts.view(DOWNLOAD_DATA_TYPE)))
                     {
-                        client->print_and_log("🚫[INVALID DOWNLOAD DATA TYPE]: %s\n", parts[DOWNLOAD_DATA_TYPE].c_str());
+                        client->print_and_log("🚫[INVALID DOWNLOAD DATA TYPE]: %s\n", parts.field(DOWNLOAD_DATA_TYPE));
                         command_valid = false;
                     }
                     break;
@@ -474,64 +462,60 @@ void MQTTClient::validate_request_ids(const char *message, const char *gateway_i
                 case COMMAND:
                     // Only validate this part for commands which actually have 6 or 7 parts AND require validation here
 
-                    client->print_and_log("[idx] = %d, COMMAND = %s\n", idx, parts[COMMAND].c_str());
+                    client->print_and_log("[idx] = %d, COMMAND = %s\n", idx, parts.field(COMMAND));
                     if (Validate_command(parts) == false)
                     {
-                        client->print_and_log("[🚫 INVALID COMMAND]: %s\n", cmd.c_str());
+                        client->print_and_log("[🚫 INVALID COMMAND]: %.*s\n", cmd_len, cmd.data());
                         command_valid = false;
                     }
                     break;
                 case PING_COUNT:
 
-                    if (parts[DOWNLOAD_DATA_TYPE] == "13") // Example: Ping Node command
+                    if (parts.view(DOWNLOAD_DATA_TYPE) == "13") // Example: Ping Node command
                     {
-                        client->print_and_log("[idx] = %d, PING_COUNT = %s\n", idx, parts[PING_COUNT].c_str());
-                        try
+                        client->print_and_log("[idx] = %d, PING_COUNT = %s\n", idx, parts.field(PING_COUNT));
+                        int ping_count = parts.number(PING_COUNT, -1);
+                        if (ping_count == -1)
                         {
-                            int ping_count = std::stoi(parts[PING_COUNT]);
-                            if (ping_count < 1 || ping_count > 3)
-                            {
-                                client->print_and_log("Enqueueing command to Failed queue (Ping count out of range): %s\n", cmd.c_str());
-                                command_valid = false;
-                            }
+                            client->print_and_log("Enqueueing command to Failed queue (Invalid ping count): %.*s\n", cmd_len, cmd.data());
+                            command_valid = false;
                         }
-                        catch (...)
+                        else if (ping_count < 1 || ping_count > 3)
                         {
-                            client->print_and_log("Enqueueing command to Failed queue (Invalid ping count): %s\n", cmd.c_str());
+                            client->print_and_log("Enqueueing command to Failed queue (Ping count out of range): %.*s\n", cmd_len, cmd.data());
                             command_valid = false;
                         }
                     }
                     else
                     {
-                        client->print_and_log("[idx] = %d, PING_COUNT = %s\n", idx, parts[PING_COUNT].c_str());
+                        // Same position carries MAX_STALENESS for ODM reads
+                        client->print_and_log("[idx] = %d, PING_COUNT/MAX_STALENESS = %s\n", idx, parts.field(PING_COUNT));
                         break;
                     }
                     break;
                 case PING_INTERVAL:
                     // Only validate if parts.size() > 6
 
-                    if (parts[DOWNLOAD_DATA_TYPE] == "13") // Ping Node command
+                    if (parts.view(DOWNLOAD_DATA_TYPE) == "13") // Ping Node command
                     {
-                        client->print_and_log("[idx] = %d, PING_INTERVAL = %s\n", idx, parts[PING_INTERVAL].c_str());
-                        try
+                        client->print_and_log("[idx] = %d, PING_INTERVAL = %s\n", idx, parts.field(PING_INTERVAL));
+                        int ping_interval = parts.number(PING_INTERVAL, -1);
+                        if (ping_interval == -1)
                         {
-                            int ping_interval = std::stoi(parts[PING_INTERVAL]);
-                            if (ping_interval < 1 || ping_interval > 3)
-                            {
-                                client->print_and_log("Enqueueing command to Failed queue (Ping interval out of range): %s\n", cmd.c_str());
-                                command_valid = false;
-                            }
+                            client->print_and_log("Enqueueing command to Failed queue (Invalid ping interval): %.*s\n", cmd_len, cmd.data());
+                            command_valid = false;
                         }
-                        catch (...)
+                        else if (ping_interval < 1 || ping_interval > 3)
                         {
-                            client->print_and_log("Enqueueing command to Failed queue (Invalid ping interval): %s\n", cmd.c_str());
+                            client->print_and_log("Enqueueing command to Failed queue (Ping interval out of range): %.*s\n", cmd_len, cmd.data());
                             command_valid = false;
                         }
                     }
                     else
                     {
+                        // Same position carries DEADLINE for other ODM commands
+                        client->print_and_log("[idx] = %d, PING_INTERVAL/DEADLINE = %s\n", idx, parts.field(PING_INTERVAL));
                         break;
-                        // Other command-specific validations for parts[6]
                     }
                     break;
 
@@ -546,265 +530,202 @@ void MQTTClient::validate_request_ids(const char *message, const char *gateway_i
                 break; // Exit validation on first failure
         }
         // Log the received message with timestamp
-        auto now = std::chrono::system_clock::now();
-        auto time_t = std::chrono::system_clock::to_time_t(now);
-        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()).count() % 1000;
-        std::tm tm{};
-        localtime_r(&time_t, &tm); // localtime_s(&time_t, &tm) on Windows
-        std::ostringstream oss;
-        oss << std::put_time(&tm, "%Y-%m-%d %H:%M:%S") << "."
-            << std::setfill('0') << std::setw(3) << ms;
-        std::string time_str = oss.str();
+        const char *time_str = WallClock::now_ms();
         // Enqueue and signal the appropriate queue based on the final validation status and command type
         if (command_valid)
         {
-            if (parts[DOWNLOAD_DATA_TYPE] == "27" || parts[DOWNLOAD_DATA_TYPE] == "28") // 27 is RF FUOTA, 28 is Meter FUOTA
+            if (parts.download_data_type == DATA_TYPE_RF_FIRMWARE_UPGRADE || parts.download_data_type == DATA_TYPE_METER_FIRMWARE_UPGRADE) // 27 is RF FUOTA, 28 is Meter FUOTA
             {
-                client->print_and_log("[%s][Enqueueing command to FUOTA queue] (success): %s\n", time_str.c_str(), cmd.c_str());
-                client->enqueue_fuota(cmd); // FUOTA Queue
+                client->print_and_log("[%s][Enqueueing command to FUOTA queue] (success): %.*s\n", time_str, cmd_len, cmd.data());
+                client->enqueue_fuota(parts); // FUOTA Queue
             }
             else
             {
-                client->print_and_log("[%s][Enqueueing command to ODM queue] (success): %s\n", time_str.c_str(), cmd.c_str());
-                client->enqueue_odm(cmd); // ODM Queue
+                client->print_and_log("[%s][Enqueueing command to ODM queue] (success): %.*s\n", time_str, cmd_len, cmd.data());
+                client->enqueue_odm(parts); // ODM Queue
             }
         }
         else
         {
-            client->print_and_log("[%s][Enqueueing command to Failed queue] (invalid): %s\n", time_str.c_str(), cmd.c_str());
-            client->enqueue_failed(cmd); // Failed Queue
+            client->print_and_log("[%s][Enqueueing command to Failed queue] (invalid): %.*s\n", time_str, cmd_len, cmd.data());
+            client->enqueue_failed(parts); // Failed Queue
         }
     }
     client->ODM_Flag = 1;
     this->print_and_log("[ODM Flag] =%d\n", client->ODM_Flag);
 }
 
-bool MQTTClient::hex_to_bytes(const std::string &hex, std::vector<uint8_t> &out)
+enum class CommandRule : uint8_t
 {
-    if (hex.size() % 2 != 0)
-        return false;
-
-    out.clear();
-    out.reserve(hex.size() / 2);
-
-    for (size_t i = 0; i < hex.size(); i += 2)
-    {
-        const std::string byteStr = hex.substr(i, 2);
-        uint8_t b = static_cast<uint8_t>(std::stoi(byteStr, nullptr, 16)); // base 16
-        out.push_back(b);
-    }
-    return true;
-}
+    UNKNOWN,         // download type not supported by ODM
+    COMMAND_IS_TYPE, // command byte equals the download type (scalar profiles)
+    COMMAND_SUB,     // command / sub-command pair
+    PACKET_TYPE      // PMESH packet type (ping node)
+};
 
-bool MQTTClient::Validate_command(const std::vector<std::string> &parts)
+struct CommandCheck
 {
-    uint8_t download_data_type = static_cast<uint8_t>(std::stoi(parts[DOWNLOAD_DATA_TYPE]));
-    // 2) Get command hex string from parts[5]
-    const std::string &cmd_hex = parts[COMMAND];
+    CommandRule rule;
+    uint8_t command;
+    uint8_t sub_command;
+};
+
+// Expected command bytes per download data type, indexed by DATA_TYPE_*
+static constexpr CommandCheck COMMAND_CHECKS[] = {
+    {CommandRule::COMMAND_IS_TYPE, 0x00, 0x00}, // DATA_TYPE_NP
+    {CommandRule::COMMAND_IS_TYPE, 0x00, 0x00}, // DATA_TYPE_IP
+    {CommandRule::COMMAND_IS_TYPE, 0x00, 0x00}, // DATA_TYPE_BHP
+    {CommandRule::COMMAND_IS_TYPE, 0x00, 0x00}, // DATA_TYPE_DLP
+    {CommandRule::COMMAND_IS_TYPE, 0x00, 0x00}, // DATA_TYPE_BLP
+    {CommandRule::COMMAND_SUB, 0x08, 0x00},     // DATA_TYPE_ALL_EVENTS
+    {CommandRule::COMMAND_SUB, 0x08, 0x01},     // DATA_TYPE_VOLTAGE_EVENTS
+    {CommandRule::COMMAND_SUB, 0x08, 0x02},     // DATA_TYPE_CURRENT_EVENTS
+    {CommandRule::COMMAND_SUB, 0x08, 0x03},     // DATA_TYPE_POWER_EVENTS
+    {CommandRule::COMMAND_SUB, 0x08, 0x04},     // DATA_TYPE_TRANSACTIONAL_EVENTS
+    {CommandRule::COMMAND_SUB, 0x08, 0x05},     // DATA_TYPE_OTHER_EVENTS
+    {CommandRule::COMMAND_SUB, 0x08, 0x06},     // DATA_TYPE_NON_ROLL_OVER_EVENTS
+    {CommandRule::COMMAND_SUB, 0x08, 0x07},     // DATA_TYPE_CONTROL_EVENTS
+    {CommandRule::PACKET_TYPE, 0x0D, 0x00},     // DATA_TYPE_PING_NODE
+    {CommandRule::COMMAND_SUB, 0x00, 0x09},     // DATA_TYPE_PING_METER
+    {CommandRule::COMMAND_SUB, 0x00, 0x02},     // DATA_TYPE_RTC_READ
+    {CommandRule::COMMAND_SUB, 0x01, 0x02},     // DATA_TYPE_RTC_WRITE
+    {CommandRule::COMMAND_SUB, 0x00, 0x01},     // DATA_TYPE_DEMAND_INTEGRATION_PERIOD_READ
+    {CommandRule::COMMAND_SUB, 0x01, 0x01},     // DATA_TYPE_DEMAND_INTEGRATION_PERIOD_READ_WRITE
+    {CommandRule::COMMAND_SUB, 0x00, 0x01},     // DATA_TYPE_CAPTURE_PERIOD_READ
+    {CommandRule::COMMAND_SUB, 0x01, 0x01},     // DATA_TYPE_CAPTURE_PERIOD_READ_WRITE
+    {CommandRule::COMMAND_SUB, 0x00, 0x08},     // DATA_TYPE_LOAD_LIMIT_READ
+    {CommandRule::COMMAND_SUB, 0x01, 0x08},     // DATA_TYPE_LOAD_LIMIT_WRITE
+    {CommandRule::COMMAND_SUB, 0x00, 0x09},     // DATA_TYPE_LOAD_STATUS_READ
+    {CommandRule::COMMAND_SUB, 0x01, 0x09},     // DATA_TYPE_LOAD_STATUS_WRITE
+    {CommandRule::COMMAND_SUB, 0x01, 0x07},     // DATA_TYPE_ACTION_SCHEDULER_READ
+};
+static_assert(sizeof(COMMAND_CHECKS) / sizeof(COMMAND_CHECKS[0]) == DATA_TYPE_ACTION_SCHEDULER_READ + 1,
+              "COMMAND_CHECKS must have one entry per download data type up to ACTION_SCHEDULER_READ");
+
+bool MQTTClient::Validate_command(const QueuedCommand &cmd)
+{
+    uint8_t download_data_type = static_cast<uint8_t>(cmd.download_data_type);
 
-    std::vector<uint8_t> cmd_bytes;
-    if (!hex_to_bytes(cmd_hex, cmd_bytes))
+    // Command hex of parts[5] was decoded when the command was parsed
+    if (!cmd.payload_ok)
     {
-        print_and_log("❌ Invalid hex in command: %s\n", cmd_hex.c_str());
+        print_and_log("❌ Invalid hex in command: %s\n", cmd.field(COMMAND));
         return false;
     }
 
     // Need at least 8 bytes
-    if (cmd_bytes.size() < 8)
+    if (cmd.payload_len < 8)
     {
-        print_and_log("❌ Command too short: len=%zu (need >=8)\n", cmd_bytes.size());
+        print_and_log("❌ Command too short: len=%zu (need >=8)\n", static_cast<size_t>(cmd.payload_len));
         return false;
     }
-    uint8_t command = cmd_bytes[4];
-    uint8_t sub_command = cmd_bytes[5];
-    uint8_t packet_type = cmd_bytes[2];
+    uint8_t command = cmd.payload[4];
+    uint8_t sub_command = cmd.payload[5];
+    uint8_t packet_type = cmd.payload[2];
+
+    const size_t checks = sizeof(COMMAND_CHECKS) / sizeof(COMMAND_CHECKS[0]);
+    CommandCheck check = (download_data_type < checks) ? COMMAND_CHECKS[download_data_type] : CommandCheck{CommandRule::UNKNOWN, 0, 0};
 
-    switch (download_data_type)
+    switch (check.rule)
     {
-        case DATA_TYPE_NP:
-        case DATA_TYPE_IP:
-        case DATA_TYPE_BHP:
-        case DATA_TYPE_DLP:
-        case DATA_TYPE_BLP: { // Read Scalar List
+        case CommandRule::COMMAND_IS_TYPE: // Read Scalar List
             if (command != download_data_type)
             {
                 print_and_log("❌ [COMMAND NOT MATCHING DOWNLOAD DATA TYPE] CMD=%02X, TYPE=%02X\n", command, download_data_type);
                 return false;
             }
             return true;
-        }
-        case DATA_TYPE_ALL_EVENTS: {
-            if (command != 0x08 && sub_command != 0x00)
-            {
-                print_and_log("❌ [COMMAND NOT MATCHING DOWNLOAD DATA TYPE] CMD=%02X, SUBCMD=%02X, TYPE=%02X\n", command, sub_command, download_data_type);
-                return false;
-            }
-            return true;
-        }
-        case DATA_TYPE_VOLTAGE_EVENTS: {
-            if (command != 0x08 && sub_command != 0x01)
-            {
-                print_and_log("❌ [COMMAND NOT MATCHING DOWNLOAD DATA TYPE] CMD=%02X, SUBCMD=%02X, TYPE=%02X\n", command, sub_command, download_data_type);
-                return false;
-            }
-            return true;
-        }
-        case DATA_TYPE_CURRENT_EVENTS: {
-            if (command != 0x08 && sub_command != 0x02)
-            {
-                print_and_log("❌ [COMMAND NOT MATCHING DOWNLOAD DATA TYPE] CMD=%02X, SUBCMD=%02X, TYPE=%02X\n", command, sub_command, download_data_type);
-                return false;
-            }
-            return true;
-        }
-        case DATA_TYPE_POWER_EVENTS: {
-            if (command != 0x08 && sub_command != 0x03)
-            {
-                print_and_log("❌ [COMMAND NOT MATCHING DOWNLOAD DATA TYPE] CMD=%02X, SUBCMD=%02X, TYPE=%02X\n", command, sub_command, download_data_type);
-                return false;
-            }
-            return true;
-        }
-        case DATA_TYPE_TRANSACTIONAL_EVENTS: {
-            if (command != 0x08 && sub_command != 0x04)
-            {
-                print_and_log("❌ [COMMAND NOT MATCHING DOWNLOAD DATA TYPE] CMD=%02X, SUBCMD=%02X, TYPE=%02X\n", command, sub_command, download_data_type);
-                return false;
-            }
-            return true;
-        }
-        case DATA_TYPE_OTHER_EVENTS: {
-            if (command != 0x08 && sub_command != 0x05)
-            {
-                print_and_log("❌ [COMMAND NOT MATCHING DOWNLOAD DATA TYPE] CMD=%02X, SUBCMD=%02X, TYPE=%02X\n", command, sub_command, download_data_type);
-                return false;
-            }
-            return true;
-        }
-        case DATA_TYPE_NON_ROLL_OVER_EVENTS: {
-            if (command != 0x08 && sub_command != 0x06)
+        case CommandRule::COMMAND_SUB:
+            if (command != check.command && sub_command != check.sub_command)
             {
                 print_and_log("❌ [COMMAND NOT MATCHING DOWNLOAD DATA TYPE] CMD=%02X, SUBCMD=%02X, TYPE=%02X\n", command, sub_command, download_data_type);
                 return false;
             }
             return true;
-        }
-        case DATA_TYPE_CONTROL_EVENTS: {
-            if (command != 0x08 && sub_command != 0x07)
-            {
-                print_and_log("❌ [COMMAND NOT MATCHING DOWNLOAD DATA TYPE] CMD=%02X, SUBCMD=%02X, TYPE=%02X\n", command, sub_command, download_data_type);
-                return false;
-            }
-            return true;
-        }
-        case DATA_TYPE_PING_NODE: {
-            if (packet_type != 0x0D)
+        case CommandRule::PACKET_TYPE:
+            if (packet_type != check.command)
             {
                 print_and_log("❌ [PACKET TYPE NOT MATCHING DOWNLOAD DATA TYPE] PACKET_TYPE=%02X, TYPE=%02X\n", packet_type, download_data_type);
                 return false;
             }
             return true;
-        }
-        case DATA_TYPE_RTC_READ: {
-            if (command != 0x00 && sub_command != 0x02)
-            {
-                print_and_log("❌ [COMMAND NOT MATCHING DOWNLOAD DATA TYPE] CMD=%02X, SUBCMD=%02X, TYPE=%02X\n", command, sub_command, download_data_type);
-                return false;
-            }
-            return true;
-        }
-        case DATA_TYPE_RTC_WRITE: {
-            if (command != 0x01 && sub_command != 0x02)
-            {
-                print_and_log("❌ [COMMAND NOT MATCHING DOWNLOAD DATA TYPE] CMD=%02X, SUBCMD=%02X, TYPE=%02X\n", command, sub_command, download_data_type);
-                return false;
-            }
-            return true;
-        }
-        case DATA_TYPE_DEMAND_INTEGRATION_PERIOD_READ:
-        case DATA_TYPE_CAPTURE_PERIOD_READ: {
-            if (command != 0x00 && sub_command != 0x01)
-            {
-                print_and_log("❌ [COMMAND NOT MATCHING DOWNLOAD DATA TYPE] CMD=%02X, SUBCMD=%02X, TYPE=%02X\n", command, sub_command, download_data_type);
-                return false;
-            }
-            return true;
-        }
-        case DATA_TYPE_DEMAND_INTEGRATION_PERIOD_READ_WRITE:
-        case DATA_TYPE_CAPTURE_PERIOD_READ_WRITE: {
-            if (command != 0x01 && sub_command != 0x01)
-            {
-                print_and_log("❌ [COMMAND NOT MATCHING DOWNLOAD DATA TYPE] CMD=%02X, SUBCMD=%02X, TYPE=%02X\n", command, sub_command, download_data_type);
-                return false;
-            }
-            return true;
-        }
-        case DATA_TYPE_LOAD_LIMIT_READ: {
-            if (command != 0x00 && sub_command != 0x08)
-            {
-                print_and_log("❌ [COMMAND NOT MATCHING DOWNLOAD DATA TYPE] CMD=%02X, SUBCMD=%02X, TYPE=%02X\n", command, sub_command, download_data_type);
-                return false;
-            }
-            return true;
-        }
-        case DATA_TYPE_LOAD_LIMIT_WRITE: {
-            if (command != 0x01 && sub_command != 0x08)
-            {
-                print_and_log("❌ [COMMAND NOT MATCHING DOWNLOAD DATA TYPE] CMD=%02X, SUBCMD=%02X, TYPE=%02X\n", command, sub_command, download_data_type);
-                return false;
-            }
-            return true;
-        }
-        case DATA_TYPE_LOAD_STATUS_READ:
-        case DATA_TYPE_PING_METER: {
-            if (command != 0x00 && sub_command != 0x09)
-            {
-                print_and_log("❌ [COMMAND NOT MATCHING DOWNLOAD DATA TYPE] CMD=%02X, SUBCMD=%02X, TYPE=%02X\n", command, sub_command, download_data_type);
-                return false;
-            }
-            return true;
-        }
-        case DATA_TYPE_LOAD_STATUS_WRITE: {
-            if (command != 0x01 && sub_command != 0x09)
-            {
-                print_and_log("❌ [COMMAND NOT MATCHING DOWNLOAD DATA TYPE] CMD=%02X, SUBCMD=%02X, TYPE=%02X\n", command, sub_command, download_data_type);
-                return false;
-            }
-            return true;
-        }
-        case DATA_TYPE_ACTION_SCHEDULER_READ: {
-            if (command != 0x01 && sub_command != 0x07)
-            {
-                print_and_log("❌ [COMMAND NOT MATCHING DOWNLOAD DATA TYPE] CMD=%02X, SUBCMD=%02X, TYPE=%02X\n", command, sub_command, download_data_type);
-                return false;
-            }
-            return true;
-        }
         default:
             print_and_log("❌ Unknown download data type: %02X\n", download_data_type);
             return false;
     }
 }
 
+// Queues the completion event of one request, published with the others on the next publish_odm_results()
+void MQTTClient::add_odm_result(bool ping, unsigned int req_id, int status, uint16_t err_code, const nlohmann::json &values)
+{
+    if (!this->results_enabled)
+        return;
+
+    nlohmann::json result = {{"request_id", req_id}, {"status", status}, {"error_code", err_code}};
+    if (ping)
+        result["ping"] = true;
+    if (!values.is_null())
+        result["values"] = values;
+
+    this->pending_results.push_back(std::move(result));
+
+    if (this->pending_results.size() >= ODM_RESULTS_PER_MESSAGE)
+        this->publish_odm_results();
+}
+
+/*
+ * Publishes the queued completion events as one QoS 1 message on
+ * <gateway>/ONDEMAND_RESPONSE: {"gateway_id", "time", "results": [...]}.
+ * mosquitto keeps QoS 1 messages queued across a broker reconnect.
+ */
+void MQTTClient::publish_odm_results(void)
+{
+    if (this->pending_results.empty())
+        return;
+
+    nlohmann::json message = {{"gateway_id", this->gatewayIdStr}, {"time", WallClock::now_ms()}, {"results", std::move(this->pending_results)}};
+    this->pending_results = nlohmann::json::array();
+
+    std::string payload = message.dump();
+    int rc = this->mosq ? mosquitto_publish(this->mosq, nullptr, this->ResponseTopic, static_cast<int>(payload.size()), payload.data(), 1, false) : MOSQ_ERR_NO_CONN;
+
+    if (rc == MOSQ_ERR_SUCCESS)
+        this->print_and_log("[MQTT] 📤 %s : %zu results\n", this->ResponseTopic, message["results"].size());
+    else
+        this->print_and_log("[MQTT] ❌ publish on %s failed: %s | %zu results dropped\n", this->ResponseTopic, mosquitto_strerror(rc), message["results"].size());
+}
+
 bool MQTTClient::check_rf_fuota_queue_empty()
 {
     return RF_Meter_FUOTA.empty();
 }
 // Dequeue FUOTA command
-bool MQTTClient::dequeue_fuota(std::vector<uint8_t> &out_cmd)
+bool MQTTClient::dequeue_fuota(QueuedCommand &out_cmd)
 {
     this->print_and_log("(%s) -> %s Start, Dequeuing FUOTA command\n", this->dcuIdStr.c_str(), __FUNCTION__);
-    std::lock_guard<std::mutex> lock(fuota_queue_mtx);
 
-    if (RF_Meter_FUOTA.empty())
+    while (QueuedCommand *front = RF_Meter_FUOTA.front())
     {
-        this->print_and_log("Empty queue\n");
-        return false;
+        bool cancelled = this->take_cancelled(front->request_id);
+        if (!cancelled)
+            out_cmd = *front;
+
+        RF_Meter_FUOTA.pop();
+        if (!cancelled)
+            return true;
     }
 
-    out_cmd = std::move(RF_Meter_FUOTA.front());
+    this->print_and_log("Empty queue\n");
+    return false;
+}
+
+bool MQTTClient::dequeue_fuota(std::vector<uint8_t> &out_cmd)
+{
+    QueuedCommand cmd;
+    if (!this->dequeue_fuota(cmd))
+        return false;
 
-    RF_Meter_FUOTA.pop();
+    out_cmd = cmd.bytes();
     return true;
 }
 
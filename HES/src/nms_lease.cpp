@@ -0,0 +1,176 @@
+#include "../inc/nms_lease.h"
+#include "../inc/database.h"
+
+#include <sys/eventfd.h>
+
+#include <algorithm>
+#include <memory>
+#include <thread>
+
+NmsLeaseManager &NmsLeaseManager::instance()
+{
+    static NmsLeaseManager manager;
+    return manager;
+}
+
+NmsLeaseState NmsLeaseManager::get_state(const char *gateway_id)
+{
+    std::lock_guard<std::mutex> lock(this->lease_mutex);
+
+    auto it = this->leases.find(gateway_id);
+    return (it == this->leases.end()) ? NmsLeaseState::UNKNOWN : it->second.state;
+}
+
+void NmsLeaseManager::set_state(const char *gateway_id, NmsLeaseState state)
+{
+    std::lock_guard<std::mutex> lock(this->lease_mutex);
+
+    Lease &lease = this->leases[gateway_id];
+    lease.state = state;
+
+    if (state != NmsLeaseState::HELD_BY_NMS)
+        return;
+
+    // Hold of this gateway seen from the DB just now
+    lease.observed_at = std::chrono::steady_clock::now();
+
+    if (!this->watcher_started)
+    {
+        this->watcher_started = true;
+        std::thread(&NmsLeaseManager::watch_nms_releases, this).detach();
+    }
+    this->watch_cv.notify_one();
+}
+
+bool NmsLeaseManager::is_held_by_nms(const char *gateway_id)
+{
+    std::lock_guard<std::mutex> lock(this->lease_mutex);
+
+    auto it = this->leases.find(gateway_id);
+    if (it == this->leases.end() || it->second.state != NmsLeaseState::HELD_BY_NMS)
+        return false;
+
+    // Neither the watcher nor a gateway thread has confirmed the hold lately (DB down) → let the caller ask the DB
+    return (std::chrono::steady_clock::now() - it->second.observed_at) < this->max_hold_age();
+}
+
+std::chrono::milliseconds NmsLeaseManager::max_hold_age(void) const
+{
+    return std::chrono::milliseconds(std::max(2000, 4 * this->poll_interval_ms));
+}
+
+bool NmsLeaseManager::add_waiter(const char *gateway_id, int event_fd)
+{
+    std::lock_guard<std::mutex> lock(this->lease_mutex);
+
+    Lease &lease = this->leases[gateway_id];
+    if (lease.state != NmsLeaseState::HELD_BY_NMS)
+        return false;
+
+    if (std::find(lease.waiters.begin(), lease.waiters.end(), event_fd) == lease.waiters.end())
+        lease.waiters.push_back(event_fd);
+
+    return true;
+}
+
+void NmsLeaseManager::remove_waiter(const char *gateway_id, int event_fd)
+{
+    std::lock_guard<std::mutex> lock(this->lease_mutex);
+
+    auto it = this->leases.find(gateway_id);
+    if (it == this->leases.end())
+        return;
+
+    std::vector<int> &waiters = it->second.waiters;
+    waiters.erase(std::remove(waiters.begin(), waiters.end(), event_fd), waiters.end());
+}
+
+void NmsLeaseManager::set_poll_interval(int milliseconds)
+{
+    std::lock_guard<std::mutex> lock(this->lease_mutex);
+
+    if (milliseconds > 0)
+        this->poll_interval_ms = milliseconds;
+}
+
+bool NmsLeaseManager::any_held_by_nms(void) const
+{
+    for (const auto &kv : this->leases)
+    {
+        if (kv.second.state == NmsLeaseState::HELD_BY_NMS)
+            return true;
+    }
+    return false;
+}
+
+void NmsLeaseManager::watch_nms_releases(void)
+{
+    try
+    {
+        this->set_poll_interval(Utility::readConfig<int>("HES.nms_lease_poll_ms"));
+    }
+    catch (const std::exception &e)
+    {
+        std::cout << "Error: " << e.what() << std::endl;
+    }
+
+    // Own connection, the gateway threads keep theirs for their own queries
+    auto db = std::make_unique<MySqlDatabase>();
+    db->load_mysql_config_from_file();
+
+    while (true)
+    {
+        std::vector<std::string> held;
+        int interval_ms;
+        {
+            std::unique_lock<std::mutex> lock(this->lease_mutex);
+            this->watch_cv.wait(lock, [this]
+                                { return this->any_held_by_nms(); });
+
+            for (const auto &kv : this->leases)
+            {
+                if (kv.second.state == NmsLeaseState::HELD_BY_NMS)
+                    held.push_back(kv.first);
+            }
+            interval_ms = this->poll_interval_ms;
+        }
+
+        std::vector<std::string> released;
+        if (db->get_nms_released_gateways(held, released) == SUCCESS)
+        {
+            std::lock_guard<std::mutex> lock(this->lease_mutex);
+            auto now = std::chrono::steady_clock::now();
+
+            for (const std::string &gateway_id : held)
+                this->leases[gateway_id].observed_at = now;
+
+            for (const std::string &gateway_id : released)
+            {
+                Lease &lease = this->leases[gateway_id];
+                if (lease.state != NmsLeaseState::HELD_BY_NMS)
+                    continue;
+
+                lease.state = NmsLeaseState::FREE;
+                for (int fd : lease.waiters)
+                    eventfd_write(fd, 1);
+            }
+        }
+        else
+        {
+            // Watcher cannot see the DB: once a hold is stale its waiters go back to asking the DB themselves
+            std::lock_guard<std::mutex> lock(this->lease_mutex);
+            auto now = std::chrono::steady_clock::now();
+
+            for (auto &kv : this->leases)
+            {
+                if (kv.second.state != NmsLeaseState::HELD_BY_NMS || now - kv.second.observed_at < this->max_hold_age())
+                    continue;
+
+                for (int fd : kv.second.waiters)
+                    eventfd_write(fd, 1);
+            }
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(interval_ms));
+    }
+}
@@ -0,0 +1,79 @@
+#include "../inc/odm_scheduler.h"
+#include "../inc/client.h"
+
+#include <iterator>
+
+OdmPriority OdmScheduler::priority_of(int download_data_type)
+{
+    switch (download_data_type)
+    {
+        case DATA_TYPE_LOAD_LIMIT_WRITE:
+        case DATA_TYPE_LOAD_STATUS_WRITE: // load connect / disconnect
+            return OdmPriority::URGENT;
+        case DATA_TYPE_BHP:
+        case DATA_TYPE_DLP:
+        case DATA_TYPE_BLP:
+        case DATA_TYPE_ALL_EVENTS:
+        case DATA_TYPE_VOLTAGE_EVENTS:
+        case DATA_TYPE_CURRENT_EVENTS:
+        case DATA_TYPE_POWER_EVENTS:
+        case DATA_TYPE_TRANSACTIONAL_EVENTS:
+        case DATA_TYPE_OTHER_EVENTS:
+        case DATA_TYPE_NON_ROLL_OVER_EVENTS:
+        case DATA_TYPE_CONTROL_EVENTS:
+            return OdmPriority::BULK;
+        case DATA_TYPE_PING_NODE:
+        case DATA_TYPE_PING_METER:
+            return OdmPriority::PING;
+        default:
+            return OdmPriority::INTERACTIVE;
+    }
+}
+
+std::chrono::seconds OdmScheduler::default_deadline(OdmPriority priority)
+{
+    switch (priority)
+    {
+        case OdmPriority::URGENT:
+            return std::chrono::seconds(30);
+        case OdmPriority::INTERACTIVE:
+            return std::chrono::seconds(120);
+        case OdmPriority::BULK:
+            return std::chrono::seconds(900);
+        default:
+            return std::chrono::seconds(300);
+    }
+}
+
+std::unique_ptr<QueuedCommand> OdmScheduler::admit(const QueuedCommand &cmd, int deadline_sec)
+{
+    OdmPriority priority = priority_of(cmd.download_data_type);
+    std::chrono::seconds budget = (deadline_sec > 0) ? std::chrono::seconds(deadline_sec) : default_deadline(priority);
+    Key key(static_cast<uint8_t>(priority), cmd.enqueued_at + budget, this->sequence++);
+
+    if (this->pending.size() >= ODM_SCHEDULE_CAPACITY)
+    {
+        auto last = std::prev(this->pending.end());
+        if (!(key < last->first))
+            return std::make_unique<QueuedCommand>(cmd);
+
+        std::unique_ptr<QueuedCommand> evicted = std::move(last->second);
+        this->pending.erase(last);
+        this->pending.emplace(key, std::make_unique<QueuedCommand>(cmd));
+        return evicted;
+    }
+
+    this->pending.emplace(key, std::make_unique<QueuedCommand>(cmd));
+    return nullptr;
+}
+
+std::unique_ptr<QueuedCommand> OdmScheduler::next(void)
+{
+    if (this->pending.empty())
+        return nullptr;
+
+    auto first = this->pending.begin();
+    std::unique_ptr<QueuedCommand> cmd = std::move(first->second);
+    this->pending.erase(first);
+    return cmd;
+}
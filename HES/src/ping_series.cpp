@@ -0,0 +1,51 @@
+#include "../inc/ping_series.h"
+
+#include <algorithm>
+
+void RttSeries::sent(std::chrono::steady_clock::time_point now)
+{
+    this->sent_count++;
+    this->sent_at = now;
+    this->waiting = true;
+}
+
+uint32_t RttSeries::answered(std::chrono::steady_clock::time_point now)
+{
+    uint32_t rtt = static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::milliseconds>(now - this->sent_at).count());
+    this->rtt_ms.push_back(rtt);
+    this->waiting = false;
+    return rtt;
+}
+
+void RttSeries::lost(void)
+{
+    this->waiting = false;
+}
+
+PingSummary RttSeries::summary(void) const
+{
+    PingSummary out;
+    out.sent = this->sent_count;
+    out.received = static_cast<uint16_t>(this->rtt_ms.size());
+
+    if (out.sent > 0)
+        out.loss_percent = static_cast<uint8_t>((out.sent - out.received) * 100 / out.sent);
+
+    if (this->rtt_ms.empty())
+        return out;
+
+    std::vector<uint32_t> sorted(this->rtt_ms);
+    std::sort(sorted.begin(), sorted.end());
+
+    uint64_t total = 0;
+    for (uint32_t rtt : sorted)
+        total += rtt;
+
+    // Nearest rank: smallest sample with at least 95% of the samples at or below it
+    size_t rank = (sorted.size() * 95 + 99) / 100;
+
+    out.rtt_min_ms = sorted.front();
+    out.rtt_avg_ms = static_cast<uint32_t>(total / sorted.size());
+    out.rtt_p95_ms = sorted[rank - 1];
+    return out;
+}
@@ -0,0 +1,36 @@
+#include "../inc/profile_cache.h"
+
+ProfileCache &ProfileCache::instance()
+{
+    static ProfileCache cache;
+    return cache;
+}
+
+void ProfileCache::store_ip(const std::array<uint8_t, 8> &mac, const InstantaneousRecord &record, ProfileSource source)
+{
+    std::lock_guard<std::mutex> lock(this->cache_mutex);
+
+    CachedInstantaneous &entry = this->instantaneous[mac];
+    entry.record = record;
+    entry.source = source;
+    entry.stored_at = std::chrono::steady_clock::now();
+}
+
+bool ProfileCache::lookup_ip(const std::array<uint8_t, 8> &mac, int max_age_sec, InstantaneousRecord &record, ProfileSource &source)
+{
+    if (max_age_sec <= 0)
+        return false;
+
+    std::lock_guard<std::mutex> lock(this->cache_mutex);
+
+    auto it = this->instantaneous.find(mac);
+    if (it == this->instantaneous.end())
+        return false;
+
+    if (std::chrono::steady_clock::now() - it->second.stored_at > std::chrono::seconds(max_age_sec))
+        return false;
+
+    record = it->second.record;
+    source = it->second.source;
+    return true;
+}
@@ -22,6 +22,16 @@ void PullData::mac_to_hex(const std::array<uint8_t, 8> &mac, char *out16)
     out16[16] = '\0'; // Null terminate
 }
 
+uint64_t PullData::mac_to_key(const std::array<uint8_t, 8> &mac)
+{
+    uint64_t key = 0;
+    for (int i = 0; i < 8; ++i)
+    {
+        key = (key << 8) | mac[i];
+    }
+    return key;
+}
+
 bool PullData::extract_path(const std::string &hex_path, int hop_count, std::vector<uint8_t> &out)
 {
     out.clear();
@@ -168,7 +178,7 @@ int PullData::process_nameplate_data(NodeInfo *node, uint8_t *buff, ssize_t leng
 
     this->print_and_log("[NameplateProfile] Node %s\n", Utility::mac_to_string(mac.data()).c_str());
 
-    std::vector<uint8_t> v(buff, buff + length);
+    ByteSpan v(buff, length);
     int ret_val = this->parseDLMSRecords(v, resp->dlms.no_of_records, node->profile_data.name_plate_profile);
 
     if (ret_val == SUCCESS)
@@ -230,7 +240,7 @@ int PullData::process_daily_load_data(NodeInfo *node, uint8_t *buff, ssize_t len
         return FAILURE;
     }
 
-    std::vector<uint8_t> v(buff, buff + length);
+    ByteSpan v(buff, length);
     int ret_val = this->parseDLMSRecords(v, resp->dlms.no_of_records, node->profile_data.daily_load_profile);
 
     if (ret_val == SUCCESS)
@@ -292,7 +302,7 @@ int PullData::process_block_load_data(NodeInfo *node, uint8_t *buff, ssize_t len
         return FAILURE;
     }
 
-    std::vector<uint8_t> v(buff, buff + length);
+    ByteSpan v(buff, length);
     int ret_val = this->parseBlockLoadDLMSRecords(v, resp->dlms.no_of_records, node->profile_data.block_load_profile);
 
     if (ret_val == SUCCESS)
@@ -354,7 +364,7 @@ int PullData::process_billing_history_data(NodeInfo *node, uint8_t *buff, ssize_
         return FAILURE;
     }
 
-    std::vector<uint8_t> v(buff, buff + length);
+    ByteSpan v(buff, length);
     int ret_val = this->parseDLMSRecords(v, resp->dlms.no_of_records, node->profile_data.billing_history);
 
     if (ret_val == SUCCESS)
@@ -416,7 +426,7 @@ int PullData::process_ip_profile_data(NodeInfo *node, uint8_t *buff, ssize_t len
         return FAILURE;
     }
 
-    std::vector<uint8_t> v(buff, buff + length);
+    ByteSpan v(buff, length);
     int ret_val = this->parseDLMSRecords(v, resp->dlms.no_of_records, node->profile_data.instantaneous_profile);
 
     if (ret_val == SUCCESS)
@@ -1,4 +1,5 @@
 #include "../inc/push.h"
+#include "../inc/metrics.h"
 
 std::array<uint8_t, 8> PushData::to_mac_array(const uint8_t mac[4])
 {
@@ -89,27 +90,38 @@ void PushData::process_push_data(uint8_t *buff, ssize_t length, const char *gate
 
     auto *resp = reinterpret_cast<const PushDataResponse *>(buff);
 
+    static MetricCounter &ip_frames = Metrics::instance().counter("hes_push_frames_total", Metrics::label("profile", "ip"));
+    static MetricCounter &blp_frames = Metrics::instance().counter("hes_push_frames_total", Metrics::label("profile", "blp"));
+    static MetricCounter &dlp_frames = Metrics::instance().counter("hes_push_frames_total", Metrics::label("profile", "dlp"));
+    static MetricCounter &bhp_frames = Metrics::instance().counter("hes_push_frames_total", Metrics::label("profile", "bhp"));
+    static MetricCounter &power_on_frames = Metrics::instance().counter("hes_push_frames_total", Metrics::label("profile", "power_on_event"));
+    static MetricCounter &power_off_frames = Metrics::instance().counter("hes_push_frames_total", Metrics::label("profile", "power_off_event"));
+
     switch (resp->dlms.frame_id)
     {
         case FI_INSTANT_DATA: {
             switch (resp->dlms.command)
             {
                 case COMMAND_IP_PROFILE: {
+                    ip_frames.fetch_add(1, std::memory_order_relaxed);
                     this->process_IP_push_data(buff, length, gateway_id);
                     break;
                 }
 
                 case COMMAND_BLOCK_LOAD_PROFILE: {
+                    blp_frames.fetch_add(1, std::memory_order_relaxed);
                     this->process_BLP_push_data(buff, length, gateway_id);
                     break;
                 }
 
                 case COMMAND_DAILY_LOAD_PROFILE: {
+                    dlp_frames.fetch_add(1, std::memory_order_relaxed);
                     this->process_DLP_push_data(buff, length, gateway_id);
                     break;
                 }
 
                 case COMMAND_BILLING_PROFILE: {
+                    bhp_frames.fetch_add(1, std::memory_order_relaxed);
                     this->process_BHP_push_data(buff, length, gateway_id);
                     break;
                 }
@@ -121,11 +133,13 @@ void PushData::process_push_data(uint8_t *buff, ssize_t length, const char *gate
         }
 
         case FI_INSTANT_EVENT_OBJECT_READ: {
+            power_on_frames.fetch_add(1, std::memory_order_relaxed);
             this->process_power_on_event(buff, length, gateway_id);
             break;
         }
 
         case FI_INSTANT_POWERFAIL_OBJECT_READ: {
+            power_off_frames.fetch_add(1, std::memory_order_relaxed);
             this->process_power_off_event(buff, length, gateway_id);
             break;
         }
@@ -137,7 +151,7 @@ void PushData::process_push_data(uint8_t *buff, ssize_t length, const char *gate
     }
 }
 
-int PushData::parseDLMSRecords(const std::vector<uint8_t> &data, const uint8_t &number_of_records, PacketBuffer<DlmsRecordMap> &records)
+int PushData::parseDLMSRecords(ByteSpan data, const uint8_t &number_of_records, PacketBuffer<DlmsRecordMap> &records)
 {
     this->print_and_log("%s start\n", __FUNCTION__);
 
@@ -197,7 +211,7 @@ int PushData::parseDLMSRecords(const std::vector<uint8_t> &data, const uint8_t &
     return FAILURE;
 }
 
-int PushData::parseBlockLoadDLMSRecords(const std::vector<uint8_t> &data, const uint8_t &number_of_records, PacketBufferBlockLoad &records)
+int PushData::parseBlockLoadDLMSRecords(ByteSpan data, const uint8_t &number_of_records, PacketBufferBlockLoad &records)
 {
     this->print_and_log("%s start\n", __FUNCTION__);
 
@@ -282,7 +296,7 @@ void PushData::process_IP_push_data(uint8_t *buff, ssize_t length, const char *g
 
     this->print_and_log("[InstantaneousProfile] Node %s\n", Utility::mac_to_string(mac.data()).c_str());
 
-    std::vector<uint8_t> v(buff, buff + length);
+    ByteSpan v(buff, length);
     int ret_val = this->parseDLMSRecords(v, resp->dlms.no_of_records, node.instantaneous_profile);
 
     if (ret_val == SUCCESS)
@@ -342,7 +356,7 @@ void PushData::process_DLP_push_data(uint8_t *buff, ssize_t length, const char *
 
     this->print_and_log("[DailyLoadProfile] Node %s\n", Utility::mac_to_string(mac.data()).c_str());
 
-    std::vector<uint8_t> v(buff, buff + length);
+    ByteSpan v(buff, length);
     int ret_val = this->parseDLMSRecords(v, resp->dlms.no_of_records, node.daily_load_profile);
 
     if (ret_val == SUCCESS)
@@ -400,7 +414,7 @@ void PushData::process_BLP_push_data(uint8_t *buff, ssize_t length, const char *
 
     this->print_and_log("[BlockLoadProfile] Node %s\n", Utility::mac_to_string(mac.data()).c_str());
 
-    std::vector<uint8_t> v(buff, buff + length);
+    ByteSpan v(buff, length);
     int ret_val = this->parseBlockLoadDLMSRecords(v, resp->dlms.no_of_records, node.block_load_profile);
 
     if (ret_val == SUCCESS)
@@ -463,7 +477,7 @@ void PushData::process_BHP_push_data(uint8_t *buff, ssize_t length, const char *
 
     this->print_and_log("[BillingProfile] Node %s\n", Utility::mac_to_string(mac.data()).c_str());
 
-    std::vector<uint8_t> v(buff, buff + length);
+    ByteSpan v(buff, length);
     int ret_val = this->parseDLMSRecords(v, resp->dlms.no_of_records, node.billing_history);
 
     if (ret_val == SUCCESS)
@@ -800,7 +814,7 @@ void PushData::process_power_on_event(uint8_t *buff, ssize_t length, const char
 
     this->print_and_log("[PowerOnEvent] Node %s\n", Utility::mac_to_string(mac.data()).c_str());
 
-    std::vector<uint8_t> v(buff, buff + length);
+    ByteSpan v(buff, length);
     int ret_val = this->parseDLMSRecords(v, resp->dlms.no_of_records, node.power_on_event);
 
     if (ret_val == SUCCESS)
@@ -856,7 +870,7 @@ void PushData::process_power_off_event(uint8_t *buff, ssize_t length, const char
 
     this->print_and_log("[PowerOffEvent] Node %s\n", Utility::mac_to_string(mac.data()).c_str());
 
-    std::vector<uint8_t> v(buff, buff + length);
+    ByteSpan v(buff, length);
     int ret_val = this->parseDLMSRecords(v, resp->dlms.no_of_records, node.power_off_event);
 
     if (ret_val == SUCCESS)
@@ -0,0 +1,82 @@
+#include "../inc/request_index.h"
+
+bool RequestIndex::remember(RequestCategory category, std::string_view request_id)
+{
+    std::lock_guard<std::mutex> lock(this->index_mutex);
+
+    auto now = std::chrono::steady_clock::now();
+    this->expire_seen(now);
+
+    auto &seen = this->seen[static_cast<int>(category)];
+    auto inserted = seen.emplace(std::string(request_id), now + this->seen_ttl);
+    if (!inserted.second)
+        return false;
+
+    this->seen_order.push_back({inserted.first->second, category, inserted.first->first});
+    return true;
+}
+
+size_t RequestIndex::seen_count(void)
+{
+    std::lock_guard<std::mutex> lock(this->index_mutex);
+
+    size_t count = 0;
+    for (const auto &seen : this->seen)
+        count += seen.size();
+    return count;
+}
+
+void RequestIndex::set_seen_ttl(int seconds)
+{
+    std::lock_guard<std::mutex> lock(this->index_mutex);
+
+    if (seconds > 0)
+        this->seen_ttl = std::chrono::seconds(seconds);
+}
+
+void RequestIndex::expire_seen(std::chrono::steady_clock::time_point now)
+{
+    while (!this->seen_order.empty() && this->seen_order.front().expires_at <= now)
+    {
+        const SeenEntry &oldest = this->seen_order.front();
+        this->seen[static_cast<int>(oldest.category)].erase(oldest.request_id);
+        this->seen_order.pop_front();
+    }
+}
+
+void RequestIndex::queued(int request_id)
+{
+    std::lock_guard<std::mutex> lock(this->index_mutex);
+    this->queue_states[request_id] = QueueState::QUEUED;
+}
+
+void RequestIndex::unqueued(int request_id)
+{
+    std::lock_guard<std::mutex> lock(this->index_mutex);
+    this->queue_states.erase(request_id);
+}
+
+bool RequestIndex::cancel(int request_id)
+{
+    std::lock_guard<std::mutex> lock(this->index_mutex);
+
+    auto it = this->queue_states.find(request_id);
+    if (it == this->queue_states.end())
+        return false;
+
+    it->second = QueueState::CANCELLED;
+    return true;
+}
+
+bool RequestIndex::take(int request_id)
+{
+    std::lock_guard<std::mutex> lock(this->index_mutex);
+
+    auto it = this->queue_states.find(request_id);
+    if (it == this->queue_states.end())
+        return false;
+
+    bool cancelled = (it->second == QueueState::CANCELLED);
+    this->queue_states.erase(it);
+    return cancelled;
+}
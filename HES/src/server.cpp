@@ -1,61 +1,133 @@
 #include "../inc/server.h"
 
 #include "../inc/client.h"
+#include "../inc/init_admission.h"
+#include "../inc/metrics.h"
 
 std::mutex Server::clients_mutex;
 std::map<std::array<char, 16>, Client *> Server::g_clients;
 
-Server::Server()
+Server::Server(bool takeover)
 {
     std::cout << "Server constructor called" << std::endl;
 
     mosquitto_lib_init();
     mysql_library_init(0, nullptr, nullptr);
 
+    int metrics_port = METRICS_DEFAULT_PORT;
+
     try
     {
         this->server_port = Utility::readConfig<int>("HES.port");
+        metrics_port = Utility::readConfig<int>("HES.metrics_port");
+    }
+    catch (const std::exception &e)
+    {
+        std::cout << "Error: " << e.what() << std::endl;
+    }
+
+    try
+    {
+        this->accept_shards = std::min(std::max(Utility::readConfig<int>("HES.accept_shards"), 1), ACCEPT_SHARDS_MAX);
+        this->listen_backlog = std::max(Utility::readConfig<int>("HES.listen_backlog"), 1);
     }
     catch (const std::exception &e)
     {
         std::cout << "Error: " << e.what() << std::endl;
     }
 
-    this->server_socket = socket(AF_INET, SOCK_STREAM, 0);
-    if (this->server_socket == -1)
+    Metrics::instance().gauge_callback("hes_connected_gateways", []() {
+        std::lock_guard<std::mutex> lock(Server::clients_mutex);
+        return static_cast<int64_t>(Server::g_clients.size());
+    });
+    Metrics::instance().gauge_callback("hes_init_admission_waiting", []() { return static_cast<int64_t>(InitAdmission::instance().waiting()); });
+    Metrics::instance().gauge_callback("hes_init_admission_running", []() { return static_cast<int64_t>(InitAdmission::instance().running()); });
+    Metrics::instance().gauge_callback("hes_client_sessions", []() { return static_cast<int64_t>(Client::session_pool().in_use()); });
+    Metrics::instance().gauge_callback("hes_client_session_capacity", []() { return static_cast<int64_t>(Client::session_pool().capacity()); });
+
+    // Port shared only by our own shard listeners, or with the process handing over to us
+    bool reuse_port = (this->accept_shards > 1 || takeover);
+
+    int metrics_fd = -1;
+    if (takeover && HotRestart::instance().take_over(this->server_socket, metrics_fd, this->handed_sessions))
+    {
+        std::cout << "Server took over the listening socket for port: " << this->server_port << std::endl;
+        Metrics::instance().adopt_http_server(metrics_fd);
+    }
+    else
+    {
+        this->server_socket = this->open_listening_socket(reuse_port);
+        if (this->server_socket < 0)
+            exit(EXIT_FAILURE);
+    }
+
+    // The first listener is the one handed over on hot restart, the others join its SO_REUSEPORT group
+    fcntl(this->server_socket, F_SETFL, fcntl(this->server_socket, F_GETFL) | O_NONBLOCK);
+    for (int shard = 1; shard < this->accept_shards; shard++)
+    {
+        int fd = this->open_listening_socket(reuse_port);
+        if (fd < 0)
+        {
+            std::cout << "Accepting on " << shard << " of " << this->accept_shards << " listeners" << std::endl;
+            break;
+        }
+        this->shard_sockets.push_back(fd);
+    }
+    std::cout << "Server is listening on port: " << this->server_port << " listeners: " << (this->shard_sockets.size() + 1) << " backlog: " << this->listen_backlog << std::endl;
+    Metrics::instance().start_http_server(metrics_port); // 0 disables the endpoint, no-op once adopted
+
+    HotRestart::instance().start_listener(
+        this->server_socket, Metrics::instance().http_socket(),
+        []() {
+            std::lock_guard<std::mutex> lock(Server::clients_mutex);
+            return Server::g_clients.size();
+        },
+        []() {
+            InitAdmission::instance().wake_waiters(); // gateways still queued for init give up
+            std::lock_guard<std::mutex> lock(Server::clients_mutex);
+            for (auto &entry : Server::g_clients)
+                entry.second->signal_ondemand();
+        });
+}
+
+int Server::open_listening_socket(bool reuse_port)
+{
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd == -1)
     {
         std::cout << "Socket creation error" << std::endl;
-        exit(EXIT_FAILURE);
+        return -1;
     }
 
+    sockaddr_in server_addr;
     memset(&server_addr, 0, sizeof(server_addr));
     server_addr.sin_family = AF_INET;
     server_addr.sin_addr.s_addr = INADDR_ANY;
     server_addr.sin_port = htons(this->server_port);
 
     int yes = 1;
-    if (setsockopt(this->server_socket, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes)) < 0)
+    if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes)) < 0 || (reuse_port && setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &yes, sizeof(yes)) < 0))
     {
         std::cout << "setsockopt failed" << std::endl;
-        close(this->server_socket);
-        exit(EXIT_FAILURE);
+        close(fd);
+        return -1;
     }
 
-    if (bind(this->server_socket, (sockaddr *)&server_addr, sizeof(server_addr)) < 0)
+    if (bind(fd, (sockaddr *)&server_addr, sizeof(server_addr)) < 0)
     {
-        std::cout << "Failed to bind" << std::endl;
-        close(this->server_socket);
-        exit(EXIT_FAILURE);
+        std::cout << "Failed to bind: " << strerror(errno) << std::endl;
+        close(fd);
+        return -1;
     }
 
-    if (listen(this->server_socket, 256) < 0)
+    if (listen(fd, this->listen_backlog) < 0)
     {
         std::cout << "Listen failed" << std::endl;
-        close(this->server_socket);
-        exit(EXIT_FAILURE);
+        close(fd);
+        return -1;
     }
 
-    std::cout << "Server is listening on port: " << this->server_port << std::endl;
+    return fd;
 }
 
 Server::~Server()
@@ -116,45 +188,95 @@ void Server::accept_and_dispatch(void)
 {
     std::cout << __FUNCTION__ << " start" << std::endl;
 
-    socklen_t client_size = sizeof(sockaddr_in);
+    for (HandedSession &session : this->handed_sessions)
+    {
+        auto client = std::make_unique<Client>();
+        client->set_mqtt_socket(eventfd(0, EFD_NONBLOCK));
+        client->set_client_socket(session.fd);
+        std::thread(resume_client, std::move(client), std::move(session.snapshot)).detach();
+    }
+    this->handed_sessions.clear();
+
+    std::cout << "Waiting for client connection..." << std::endl;
+
+    for (size_t i = 0; i < this->shard_sockets.size(); i++)
+        std::thread(&Server::accept_loop, this, this->shard_sockets[i], static_cast<int>(i + 1)).detach();
+
+    this->accept_loop(this->server_socket, 0);
+}
+
+void Server::accept_loop(int listen_fd, int shard)
+{
+    MetricCounter &accepted = Metrics::instance().counter("hes_accepted_connections_total", Metrics::label("shard", std::to_string(shard)));
 
     while (true)
     {
-        auto client = std::make_unique<Client>();
+        // Wake up every second, once a successor takes over this process stops accepting
+        pollfd listen_pfd{listen_fd, POLLIN, 0};
+        int pollret = poll(&listen_pfd, 1, 1000);
 
-        if (!client)
+        if (HotRestart::instance().handoff_pending())
         {
-            std::cout << "Memory allocation failed" << std::endl;
-            exit(EXIT_FAILURE);
+            // Only the first listener is handed over, close the others so the kernel stops routing connections to them
+            if (listen_fd != this->server_socket)
+            {
+                close(listen_fd);
+                return;
+            }
+            continue;
         }
 
-        int mqtt_socket = eventfd(0, EFD_NONBLOCK);
-        client->set_mqtt_socket(mqtt_socket);
+        if (pollret <= 0)
+            continue;
 
-        std::cout << "Waiting for client connection..." << std::endl;
-        int client_sock_fd = accept(this->server_socket, (sockaddr *)&client_addr, &client_size);
+        sockaddr_in client_addr;
+        socklen_t client_size = sizeof(client_addr);
+
+        // Gateway sockets stay blocking, the session code relies on SO_RCVTIMEO
+        int client_sock_fd = accept4(listen_fd, (sockaddr *)&client_addr, &client_size, SOCK_CLOEXEC);
 
         if (client_sock_fd < 0)
         {
-            std::cout << "Accept failed" << std::endl;
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != ECONNABORTED && errno != EINTR)
+                std::cout << "Accept failed: " << strerror(errno) << std::endl;
             continue;
         }
+        accepted.fetch_add(1, std::memory_order_relaxed);
 
         std::cout << "Client connected" << std::endl;
         std::cout << "Client fd after accept: " << client_sock_fd << std::endl;
 
-        client->set_client_socket(client_sock_fd);
-
         if (!configure_socket_options(client_sock_fd))
         {
             close(client_sock_fd);
             continue;
         }
 
+        auto client = std::make_unique<Client>();
+
+        if (!client)
+        {
+            std::cout << "Memory allocation failed" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+
+        int mqtt_socket = eventfd(0, EFD_NONBLOCK);
+        client->set_mqtt_socket(mqtt_socket);
+        client->set_client_socket(client_sock_fd);
+
         std::thread(handle_client, std::move(client)).detach();
     }
 }
 
+void Server::resume_client(std::unique_ptr<Client> client, nlohmann::json snapshot)
+{
+    // On failure the Client destructor closes the socket and the gateway reconnects
+    if (!client->resume_session(snapshot))
+        return;
+
+    handle_client(std::move(client));
+}
+
 void Server::handle_client(std::unique_ptr<Client> client)
 {
     client->pfd[0].fd = client->get_client_socket();
@@ -169,6 +291,27 @@ void Server::handle_client(std::unique_ptr<Client> client)
     {
         int pollret = 0;
 
+        if (HotRestart::instance().handoff_pending() && client->ready_for_handoff())
+        {
+            client->print_and_log("[HOT RESTART] parking session %s for the successor process\n", client->gateway_id);
+            client->flush_status_journal();
+            client->publish_odm_results();
+            int fd = client->release_client_socket(); // before the snapshot, it carries what was read ahead
+            if (HotRestart::instance().park(fd, client->session_snapshot()))
+            {
+                client->unregister_client(client->gateway_id, client.get()); // no GW_DISCONNECTED, the gateway stays connected
+                return;
+            }
+            client->set_client_socket(fd); // Too late for the successor, ended below like a busy session
+        }
+
+        if (HotRestart::instance().abandoning())
+        {
+            client->print_and_log("[HOT RESTART] successor took over, ending busy session %s\n", client->gateway_id);
+            client->gatewayStatus = Status::DISCONNECTED;
+            continue;
+        }
+
         if (client->duplicate_gateway == true)
         {
             client->print_and_log("Duplicate gateway ID socket: %s\n", client->gateway_id);
@@ -181,7 +324,7 @@ void Server::handle_client(std::unique_ptr<Client> client)
             client->set_poll_timeout(15);
         }
 
-        pollret = poll(client->pfd, 2, client->polltimeout);
+        pollret = client->gateway_io.poll(client->pfd, 2, client->polltimeout);
 
         if (pollret == 0)
         {
@@ -209,26 +352,15 @@ void Server::handle_client(std::unique_ptr<Client> client)
     client->update_into_gateway_status_info((const uint8_t *)client->pgwid, Status::DISCONNECTED, client->val1, client->val2, client->val3);
     client->print_and_log("[❌GW_DISCONNECTED][%s]\n", client->gateway_id);
     client->update_dlms_mqtt_info(client->gateway_id, 0);
-    while (!client->ODM.empty())
+    client->drain_odm_ring();
+    while (std::unique_ptr<QueuedCommand> cmd = client->odm_schedule.next())
     {
-        // Get a const reference to the first command's byte vector in the ODM queue
-        const std::vector<uint8_t> &cmd_bytes = client->ODM.front();
-        // Convert the vector of bytes into a std::string for easier processing and parsing
-        std::string cmd_str(cmd_bytes.begin(), cmd_bytes.end());
-
-        // Split the converted command string by ':' delimiter into individual parts/fields
-        std::vector<std::string> parts = client->split(cmd_str, ':');
-        // Initialize request_id to invalid/default value
-        int request_id = -1;
-
-        // If the parts vector is non-empty and first part is not empty, convert first part to integer request ID
-        if (parts.size() > 0 && !parts[0].empty())
-            request_id = std::stoi(parts[0]);
-
-        client->Update_dlms_on_demand_request_status(request_id, GW_DISCONNECTED, 0);
-
-        // Remove the processed command from the front of the ODM queue
-        client->ODM.pop();
+        // Request ID parsed when the command was queued
+        if (!cmd->answered && !client->take_cancelled(cmd->request_id))
+            client->Update_dlms_on_demand_request_status(cmd->request_id, GW_DISCONNECTED, 0);
     }
+    client->flush_status_journal(); // every GW_DISCONNECTED above in one UPDATE
+    if (client->gateway_id[0] != '\0')
+        InitAdmission::instance().session_ended(client->gateway_id, client->init_reusable());
     client->unregister_client(client->gateway_id, client.get()); // Delete gateway info from Server::g_clients
 }
@@ -0,0 +1,75 @@
+#include "../inc/slab_pool.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <new>
+
+SlabPool::SlabPool(size_t block_size, size_t objects_per_slab, size_t alignment)
+{
+    // Never below what operator new would have given; a block size that is a multiple keeps every block aligned
+    this->block_align = std::max(alignment, alignof(std::max_align_t));
+    this->block_size = (std::max(block_size, sizeof(FreeBlock)) + this->block_align - 1) / this->block_align * this->block_align;
+    this->objects_per_slab = (objects_per_slab > 0) ? objects_per_slab : 1;
+}
+
+SlabPool::~SlabPool()
+{
+    for (unsigned char *slab : this->slabs)
+        ::operator delete(slab, std::align_val_t{this->block_align});
+}
+
+void *SlabPool::allocate(size_t size)
+{
+    if (size > this->block_size)
+        return nullptr;
+
+    std::lock_guard<std::mutex> lock(this->pool_mutex);
+
+    if (!this->free_list)
+        this->add_slab();
+
+    FreeBlock *block = this->free_list;
+    this->free_list = block->next;
+    this->used++;
+    return block;
+}
+
+void SlabPool::release(void *ptr)
+{
+    if (!ptr)
+        return;
+
+    std::lock_guard<std::mutex> lock(this->pool_mutex);
+
+    FreeBlock *block = static_cast<FreeBlock *>(ptr);
+    block->next = this->free_list;
+    this->free_list = block;
+    this->used--;
+}
+
+size_t SlabPool::in_use(void) const
+{
+    std::lock_guard<std::mutex> lock(this->pool_mutex);
+    return this->used;
+}
+
+size_t SlabPool::capacity(void) const
+{
+    std::lock_guard<std::mutex> lock(this->pool_mutex);
+    return this->slabs.size() * this->objects_per_slab;
+}
+
+void SlabPool::add_slab(void)
+{
+    this->slabs.reserve(this->slabs.size() + 1); // a throwing push_back would leak the slab
+
+    unsigned char *slab = static_cast<unsigned char *>(::operator new(this->block_size * this->objects_per_slab, std::align_val_t{this->block_align}));
+
+    for (size_t i = this->objects_per_slab; i-- > 0;)
+    {
+        FreeBlock *block = reinterpret_cast<FreeBlock *>(slab + i * this->block_size);
+        block->next = this->free_list;
+        this->free_list = block;
+    }
+    this->slabs.push_back(slab);
+}
@@ -0,0 +1,89 @@
+#include "../inc/status_journal.h"
+
+#include <algorithm>
+
+bool StatusJournal::record(StatusTable table, unsigned int req_id, int status, uint16_t err_code)
+{
+    std::lock_guard<std::mutex> lock(this->journal_mutex);
+
+    auto now = std::chrono::steady_clock::now();
+    if (this->pending_count == 0)
+        this->oldest = now;
+
+    auto inserted = this->pending[static_cast<int>(table)].insert_or_assign(req_id, Pending{status, err_code, std::time(nullptr)});
+    if (inserted.second)
+        this->pending_count++;
+
+    return this->due_locked(now);
+}
+
+bool StatusJournal::due(void)
+{
+    std::lock_guard<std::mutex> lock(this->journal_mutex);
+    return this->due_locked(std::chrono::steady_clock::now());
+}
+
+bool StatusJournal::empty(void)
+{
+    std::lock_guard<std::mutex> lock(this->journal_mutex);
+    return this->pending_count == 0;
+}
+
+void StatusJournal::set_window(int ms)
+{
+    std::lock_guard<std::mutex> lock(this->journal_mutex);
+
+    if (ms >= 0)
+        this->window = std::chrono::milliseconds(ms);
+}
+
+bool StatusJournal::due_locked(std::chrono::steady_clock::time_point now) const
+{
+    if (this->pending_count == 0)
+        return false;
+    return this->pending_count >= STATUS_JOURNAL_MAX_PENDING || now - this->oldest >= this->window;
+}
+
+void StatusJournal::restore(const StatusBatch &batch, size_t first, size_t last)
+{
+    std::lock_guard<std::mutex> lock(this->journal_mutex);
+
+    if (this->pending_count == 0)
+        this->oldest = std::chrono::steady_clock::now();
+
+    for (size_t i = first; i < last && i < batch.request_ids.size(); i++)
+    {
+        if (this->pending[static_cast<int>(batch.table)].emplace(batch.request_ids[i], Pending{batch.status, batch.err_code, batch.at}).second)
+            this->pending_count++;
+    }
+}
+
+std::vector<StatusBatch> StatusJournal::take(void)
+{
+    std::lock_guard<std::mutex> lock(this->journal_mutex);
+
+    // (table, status, error code) -> batch
+    std::map<std::tuple<int, int, uint16_t>, StatusBatch> groups;
+
+    for (int table = 0; table < static_cast<int>(StatusTable::COUNT); table++)
+    {
+        for (const auto &entry : this->pending[table])
+        {
+            const Pending &p = entry.second;
+            StatusBatch &batch = groups[std::make_tuple(table, p.status, p.err_code)];
+            batch.table = static_cast<StatusTable>(table);
+            batch.status = p.status;
+            batch.err_code = p.err_code;
+            batch.at = std::max(batch.at, p.at);
+            batch.request_ids.push_back(entry.first);
+        }
+        this->pending[table].clear();
+    }
+    this->pending_count = 0;
+
+    std::vector<StatusBatch> batches;
+    batches.reserve(groups.size());
+    for (auto &group : groups)
+        batches.push_back(std::move(group.second));
+    return batches;
+}
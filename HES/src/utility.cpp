@@ -1,5 +1,8 @@
 #include "../inc/utility.h"
 
+#include <chrono>
+#include <cstring>
+
 nlohmann::json Utility::configData;
 std::once_flag Utility::configFlag;
 
@@ -41,40 +44,97 @@ void Utility::loadConfig()
     });
 }
 
-std::string TimeUtility::now()
+namespace
+{
+struct WallClockCache
+{
+    std::time_t sec = -1;
+    std::tm tm{};
+    int ms = 0;
+    char date_time[20] = {0};    // YYYY-mm-dd HH:MM:SS
+    char date_time_ms[24] = {0}; // YYYY-mm-dd HH:MM:SS.mmm
+};
+
+thread_local WallClockCache wall_clock_cache;
+
+WallClockCache &wall_clock_refresh(void)
 {
     using namespace std::chrono;
 
+    WallClockCache &cache = wall_clock_cache;
+
     auto now = system_clock::now();
-    auto t = system_clock::to_time_t(now);
+    auto ms_since_epoch = duration_cast<milliseconds>(now.time_since_epoch()).count();
+    std::time_t sec = static_cast<std::time_t>(ms_since_epoch / 1000);
 
-    std::tm tm{};
+    cache.ms = static_cast<int>(ms_since_epoch % 1000);
 
-    localtime_r(&t, &tm);
+    if (sec != cache.sec)
+    {
+        cache.sec = sec;
+        localtime_r(&sec, &cache.tm);
 
-    std::ostringstream oss;
-    oss << std::put_time(&tm, "%Y-%m-%d %H:%M:%S");
-    return oss.str();
+        strftime(cache.date_time, sizeof(cache.date_time), "%Y-%m-%d %H:%M:%S", &cache.tm);
+
+        memcpy(cache.date_time_ms, cache.date_time, 19);
+        cache.date_time_ms[19] = '.';
+        cache.date_time_ms[23] = '\0';
+    }
+
+    cache.date_time_ms[20] = static_cast<char>('0' + cache.ms / 100);
+    cache.date_time_ms[21] = static_cast<char>('0' + (cache.ms / 10) % 10);
+    cache.date_time_ms[22] = static_cast<char>('0' + cache.ms % 10);
+
+    return cache;
 }
+} // namespace
 
-std::string TimeUtility::now_ms()
+std::time_t WallClock::seconds(void)
 {
-    using namespace std::chrono;
-
-    auto now = system_clock::now();
-    auto ms = duration_cast<milliseconds>(now.time_since_epoch()) % 1000;
+    return wall_clock_refresh().sec;
+}
 
-    auto t = system_clock::to_time_t(now);
+std::tm WallClock::local_tm(std::time_t t)
+{
+    const WallClockCache &cache = wall_clock_cache;
+    if (t == cache.sec)
+    {
+        return cache.tm;
+    }
 
     std::tm tm{};
-
     localtime_r(&t, &tm);
+    return tm;
+}
+
+const char *WallClock::now(int *millisec)
+{
+    WallClockCache &cache = wall_clock_refresh();
+    if (millisec)
+    {
+        *millisec = cache.ms;
+    }
+    return cache.date_time;
+}
+
+const char *WallClock::now_ms(void)
+{
+    return wall_clock_refresh().date_time_ms;
+}
+
+const char *WallClock::time_ms(void)
+{
+    return wall_clock_refresh().date_time_ms + 11;
+}
 
-    std::ostringstream oss;
-    oss << std::put_time(&tm, "%Y-%m-%d %H:%M:%S");
-    oss << "." << std::setfill('0') << std::setw(3) << ms.count();
+std::string TimeUtility::now()
+{
+    return WallClock::now();
+}
 
-    return oss.str();
+std::string TimeUtility::now_ms()
+{
+    return WallClock::now_ms();
 }
 
 std::string Utility::mac_to_string_nocolon(const uint8_t *mac)